@@ -0,0 +1,39 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <QString>
+#include <QMetaType>
+
+// Request to copy the open database into a new file while it stays in use
+struct DatabaseBackup
+{
+    // always a file. An in-memory database lives only as long as the connection that holds it, while the explorar, the pooled connections, the
+    // validator and the dump reach a database through its path, so a copy in memory could neither be browsed nor outlive the backup
+    QString target;
+
+    // copy into an in-memory database first and write the file from there, see QueryWorker::backup. The copy in memory is only the snapshot the
+    // file is written from, it is closed once the file is complete
+    bool throughMemory = false;
+
+    // pages copied per step, and the pause between two steps that lets writers of other connections in
+    int pagesPerStep = 256;
+    int pauseMsecs = 5;
+};
+
+// Outcome of QueryWorker::backup
+struct BackupResult
+{
+    QString target;
+    int pages = 0;
+    qint64 elapsed = 0;
+
+    bool cancelled = false;
+
+    // non empty if the backup failed, the target file is removed then
+    QString error;
+};
+
+Q_DECLARE_METATYPE(DatabaseBackup)
+Q_DECLARE_METATYPE(BackupResult)
+
+#endif // BACKUP_H
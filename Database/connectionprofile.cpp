@@ -0,0 +1,122 @@
+#include "connectionprofile.h"
+
+#include <QSettings>
+#include <QObject>
+
+QStringList ConnectionProfile::pragmas(bool created) const
+{
+    QStringList statements;
+
+    // the page size must be set before anything is written, and switching to WAL already writes the header
+    if (created && pageSize > 0)
+        statements << QString("PRAGMA page_size = %1").arg(pageSize);
+    if (busyTimeout >= 0)
+        statements << QString("PRAGMA busy_timeout = %1").arg(busyTimeout);
+    if (!journalMode.isEmpty())
+        statements << QString("PRAGMA journal_mode = %1").arg(journalMode);
+    if (!synchronous.isEmpty())
+        statements << QString("PRAGMA synchronous = %1").arg(synchronous);
+    if (cacheSize >= 0)
+        statements << QString("PRAGMA cache_size = -%1").arg(cacheSize);
+    if (mmapSize >= 0)
+        statements << QString("PRAGMA mmap_size = %1").arg(mmapSize);
+    if (!tempStore.isEmpty())
+        statements << QString("PRAGMA temp_store = %1").arg(tempStore);
+    return statements;
+}
+
+bool ConnectionProfile::operator==(const ConnectionProfile &other) const
+{
+    return name == other.name && journalMode == other.journalMode && synchronous == other.synchronous && cacheSize == other.cacheSize
+            && mmapSize == other.mmapSize && tempStore == other.tempStore && busyTimeout == other.busyTimeout && pageSize == other.pageSize;
+}
+
+QVector<ConnectionProfile> ConnectionProfile::builtIn()
+{
+    QVector<ConnectionProfile> profiles;
+
+    ConnectionProfile defaults;
+    defaults.name = QObject::tr("Driver defaults");
+    profiles << defaults;
+
+    // durable writes that readers don't block
+    ConnectionProfile safe;
+    safe.name = QObject::tr("Safe");
+    safe.journalMode = "WAL";
+    safe.synchronous = "FULL";
+    safe.cacheSize = 16 * 1024;
+    safe.busyTimeout = 5000;
+    safe.pageSize = 4096;
+    profiles << safe;
+
+    // large imports: in WAL mode NORMAL only syncs at checkpoints, a power loss may lose the last transactions but can't corrupt the database
+    ConnectionProfile bulkLoad;
+    bulkLoad.name = QObject::tr("Bulk load");
+    bulkLoad.journalMode = "WAL";
+    bulkLoad.synchronous = "NORMAL";
+    bulkLoad.cacheSize = 256 * 1024;
+    bulkLoad.tempStore = "MEMORY";
+    bulkLoad.busyTimeout = 5000;
+    bulkLoad.pageSize = 4096;
+    profiles << bulkLoad;
+
+    // long scans and sorts over a database that is mostly read
+    ConnectionProfile analytics;
+    analytics.name = QObject::tr("Analytics read");
+    analytics.journalMode = "WAL";
+    analytics.synchronous = "NORMAL";
+    analytics.cacheSize = 512 * 1024;
+    analytics.mmapSize = qint64(1024) * 1024 * 1024;
+    analytics.tempStore = "MEMORY";
+    analytics.busyTimeout = 5000;
+    analytics.pageSize = 8192;
+    profiles << analytics;
+
+    return profiles;
+}
+
+/*
+ * Reads the profiles saved by write(), or returns the built in ones if none were saved.
+ */
+QVector<ConnectionProfile> ConnectionProfile::read(QSettings &settings)
+{
+    QVector<ConnectionProfile> profiles;
+    const int count = settings.beginReadArray("ConnectionProfiles");
+    for (int i = 0; i < count; ++i)
+    {
+        settings.setArrayIndex(i);
+        ConnectionProfile profile;
+        profile.name = settings.value("Name").toString();
+        profile.journalMode = settings.value("JournalMode").toString();
+        profile.synchronous = settings.value("Synchronous").toString();
+        profile.cacheSize = settings.value("CacheSize", -1).toInt();
+        profile.mmapSize = settings.value("MmapSize", -1).toLongLong();
+        profile.tempStore = settings.value("TempStore").toString();
+        profile.busyTimeout = settings.value("BusyTimeout", -1).toInt();
+        profile.pageSize = settings.value("PageSize", -1).toInt();
+        if (!profile.name.isEmpty())
+            profiles << profile;
+    }
+    settings.endArray();
+
+    return profiles.isEmpty() ? builtIn() : profiles;
+}
+
+void ConnectionProfile::write(QSettings &settings, const QVector<ConnectionProfile> &profiles)
+{
+    settings.beginWriteArray("ConnectionProfiles", profiles.size());
+    for (int i = 0; i < profiles.size(); ++i)
+    {
+        const ConnectionProfile& profile = profiles.at(i);
+        settings.setArrayIndex(i);
+        settings.setValue("Name", profile.name);
+        settings.setValue("JournalMode", profile.journalMode);
+        settings.setValue("Synchronous", profile.synchronous);
+        settings.setValue("CacheSize", profile.cacheSize);
+        settings.setValue("MmapSize", profile.mmapSize);
+        settings.setValue("TempStore", profile.tempStore);
+        settings.setValue("BusyTimeout", profile.busyTimeout);
+        settings.setValue("PageSize", profile.pageSize);
+    }
+    settings.endArray();
+}
@@ -0,0 +1,55 @@
+#ifndef CONNECTIONPROFILE_H
+#define CONNECTIONPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMetaType>
+
+QT_BEGIN_NAMESPACE
+class QSettings;
+QT_END_NAMESPACE
+
+// PRAGMA settings of a connection, applied by the QueryWorker every time it opens the database. Empty strings and negative numbers leave the
+// setting of the driver as it is.
+struct ConnectionProfile
+{
+    QString name;
+
+    // DELETE, TRUNCATE, PERSIST, MEMORY, WAL or OFF
+    QString journalMode;
+
+    // OFF, NORMAL, FULL or EXTRA
+    QString synchronous;
+
+    // page cache, in KiB
+    int cacheSize = -1;
+
+    // bytes of the file read through memory mapping, 0 turns memory mapping off
+    qint64 mmapSize = -1;
+
+    // DEFAULT, FILE or MEMORY
+    QString tempStore;
+
+    // milliseconds to wait for a lock held by another connection
+    int busyTimeout = -1;
+
+    // bytes per page, only applied to databases that are empty when they are opened
+    int pageSize = -1;
+
+    // the statements that apply the profile, in the order they must run
+    QStringList pragmas(bool created) const;
+
+    bool operator==(const ConnectionProfile& other) const;
+    bool operator!=(const ConnectionProfile& other) const { return !(*this == other); }
+
+    // the profiles offered when none were saved yet; the first one leaves every setting alone
+    static QVector<ConnectionProfile> builtIn();
+
+    static QVector<ConnectionProfile> read(QSettings& settings);
+    static void write(QSettings& settings, const QVector<ConnectionProfile>& profiles);
+};
+
+Q_DECLARE_METATYPE(ConnectionProfile)
+
+#endif // CONNECTIONPROFILE_H
@@ -0,0 +1,49 @@
+#ifndef CSVIMPORT_H
+#define CSVIMPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QMetaType>
+
+// Request to load a CSV file into a table, as set up by the import dialog
+struct CsvImport
+{
+    QString fileName;
+    QString table;
+    char separator = ',';
+    bool hasHeader = true;
+
+    // target columns in the order of the fields of a record, with the types the table is created with if it doesn't exist yet
+    QStringList columns;
+    QStringList types;
+
+    // records inserted per transaction
+    int batchSize = 100000;
+
+    bool emptyAsNull = true;
+
+    // synchronous = OFF and an in-memory journal while the import runs, the previous settings are restored afterwards
+    bool relaxDurability = false;
+};
+
+// Outcome of QueryWorker::importCsv
+struct CsvImportResult
+{
+    QString fileName;
+    QString table;
+
+    // records committed to the table, a failed or cancelled import keeps the batches committed before it stopped
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    qint64 elapsed = 0;
+
+    bool cancelled = false;
+
+    // non empty if the import stopped on an error
+    QString error;
+};
+
+Q_DECLARE_METATYPE(CsvImport)
+Q_DECLARE_METATYPE(CsvImportResult)
+
+#endif // CSVIMPORT_H
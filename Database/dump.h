@@ -0,0 +1,43 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <QString>
+#include <QMetaType>
+
+// Request to write the open database as a script of SQL statements, like the .dump command of the sqlite3 shell
+struct DatabaseDump
+{
+    QString target;
+
+    // read connections the tables are dumped over, 0 picks one per core up to four; only databases in WAL mode are dumped in parallel
+    int connections = 0;
+
+    // rows per INSERT statement
+    int rowsPerInsert = 500;
+};
+
+// Outcome of QueryWorker::dump
+struct DumpResult
+{
+    QString target;
+    int tables = 0;
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    qint64 elapsed = 0;
+
+    // read connections that were used
+    int connections = 1;
+
+    // all tables were read from the same snapshot of the database, which a parallel dump can't guarantee without sqlite3_snapshot_open
+    bool consistent = true;
+
+    bool cancelled = false;
+
+    // non empty if the dump failed, the target file is removed then
+    QString error;
+};
+
+Q_DECLARE_METATYPE(DatabaseDump)
+Q_DECLARE_METATYPE(DumpResult)
+
+#endif // DUMP_H
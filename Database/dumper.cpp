@@ -0,0 +1,420 @@
+#include "dumper.h"
+#include "Formats/resultwriter.h"
+#include "Libraries/sqllexer.h"
+
+#include <QObject>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+namespace
+{
+    // milliseconds between two progress reports
+    const int ProgressInterval = 100;
+
+    // the rows of a table are read by one connection, the tables of a parallel dump by several
+    class TableDumpTask : public QRunnable
+    {
+    public:
+        TableDumpTask(Dumper* dumper, Dumper::TableChunk* chunk) : dumper(dumper), chunk(chunk) {}
+        void run() Q_DECL_OVERRIDE { dumper->dumpTableOnNewConnection(*chunk); }
+
+    private:
+        Dumper* dumper;
+        Dumper::TableChunk* chunk;
+    };
+
+    struct SchemaEntry
+    {
+        QString type;
+        QString name;
+        QString sql;
+    };
+
+    bool exec(sqlite3* db, const char* sql, QString* error = nullptr)
+    {
+        char* message = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &message) == SQLITE_OK)
+            return true;
+        if (error)
+            *error = QString::fromUtf8(message);
+        sqlite3_free(message);
+        return false;
+    }
+
+    bool appendFile(QFile& target, const QString& fileName, QString& error)
+    {
+        QFile chunk(fileName);
+        if (!chunk.open(QIODevice::ReadOnly))
+        {
+            error = chunk.errorString();
+            return false;
+        }
+
+        QByteArray block;
+        while (!(block = chunk.read(1 << 20)).isEmpty())
+        {
+            if (target.write(block) != block.size())
+            {
+                error = target.errorString();
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+Dumper::Dumper(sqlite3 *handle, const QString &path, const QAtomicInt &cancelRequested) : handle(handle), path(path), cancelRequested(cancelRequested)
+{
+}
+
+/*
+ * Columns the rows are read from and inserted into. Generated columns are left out, sqlite computes them again when the rows are inserted.
+ */
+QStringList Dumper::columnsOf(const QString &table)
+{
+    QStringList columns;
+    for (const char* pragma : { "table_xinfo", "table_info" })
+    {
+        sqlite3_stmt* statement = nullptr;
+        const QByteArray sql = QString("PRAGMA %1(%2)").arg(pragma, SqlLexer::quoteIdentifier(table)).toUtf8();
+        if (sqlite3_prepare_v2(handle, sql.constData(), -1, &statement, nullptr) != SQLITE_OK)
+        {
+            sqlite3_finalize(statement);
+            continue;
+        }
+
+        const bool extended = sqlite3_column_count(statement) > 6;
+        while (sqlite3_step(statement) == SQLITE_ROW)
+        {
+            if (!extended || sqlite3_column_int(statement, 6) == 0)
+                columns << QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 1)));
+        }
+        sqlite3_finalize(statement);
+        break;
+    }
+    return columns;
+}
+
+/*
+ * Rough size of a table, the largest tables are handed to the read connections first so that they don't end up running alone at the end.
+ */
+qint64 Dumper::estimateRows(const QString &table)
+{
+    sqlite3_stmt* statement = nullptr;
+    const QByteArray sql = QString("SELECT max(rowid) FROM %1").arg(SqlLexer::quoteIdentifier(table)).toUtf8();
+    qint64 rows = 0;
+    if (sqlite3_prepare_v2(handle, sql.constData(), -1, &statement, nullptr) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW)
+        rows = sqlite3_column_int64(statement, 0);
+    sqlite3_finalize(statement);
+    return rows;
+}
+
+bool Dumper::dumpTable(sqlite3 *db, TableChunk &chunk)
+{
+    QStringList columns;
+    foreach (const QString& column, chunk.columns)
+        columns << SqlLexer::quoteIdentifier(column);
+
+    sqlite3_stmt* statement = nullptr;
+    const QByteArray sql = QString("SELECT %1 FROM %2").arg(columns.join(", "), SqlLexer::quoteIdentifier(chunk.table)).toUtf8();
+    if (sqlite3_prepare_v2(db, sql.constData(), -1, &statement, nullptr) != SQLITE_OK)
+    {
+        chunk.error = QString::fromUtf8(sqlite3_errmsg(db));
+        sqlite3_finalize(statement);
+        return false;
+    }
+
+    ResultWriter writer(ExportFormat::SqlInsert, chunk.fileName, false);
+    writer.setInsertOptions(rowsPerInsert, false);
+    bool ok = writer.open() && writer.writeHeader(statement, chunk.table);
+
+    int rc = SQLITE_DONE;
+    while (ok && !cancelRequested.load() && (rc = sqlite3_step(statement)) == SQLITE_ROW)
+    {
+        ok = writer.writeRow(statement);
+        ++chunk.rows;
+        rowsWritten.fetchAndAddRelaxed(1);
+    }
+
+    if (!ok)
+        chunk.error = writer.errorString();
+    else if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+        chunk.error = QString::fromUtf8(sqlite3_errmsg(db));
+    sqlite3_finalize(statement);
+
+    if (chunk.error.isEmpty() && !writer.finish())
+        chunk.error = writer.errorString();
+
+    tablesDone.fetchAndAddRelaxed(1);
+    return chunk.error.isEmpty();
+}
+
+void Dumper::dumpTableOnNewConnection(TableChunk &chunk)
+{
+    if (cancelRequested.load())
+        return;
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(QFile::encodeName(path).constData(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        chunk.error = QString::fromUtf8(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    exec(db, "BEGIN");
+    chunk.consistent = false;
+#ifdef SQLITE_ENABLE_SNAPSHOT
+    if (snapshot)
+        chunk.consistent = sqlite3_snapshot_open(db, "main", static_cast<sqlite3_snapshot*>(snapshot)) == SQLITE_OK;
+#endif
+
+    dumpTable(db, chunk);
+
+    exec(db, "COMMIT");
+    sqlite3_close(db);
+}
+
+/*
+ * The schema is read in a read transaction on the connection of the caller, which stays open until the last row is written: a sequential dump
+ * reads everything in it, a parallel one hands its snapshot to the other connections when sqlite was built with SQLITE_ENABLE_SNAPSHOT.
+ * Otherwise every table of a parallel dump is consistent on its own, but tables may come from different moments.
+ */
+bool Dumper::dump(const DatabaseDump &request, DumpResult &result, const Progress &progress)
+{
+    rowsPerInsert = qMax(1, request.rowsPerInsert);
+
+    QString error;
+    if (!exec(handle, "BEGIN", &error))
+    {
+        result.error = error;
+        return false;
+    }
+
+    // schema, in the order it was created in
+    QVector<SchemaEntry> tables, others;
+    QStringList virtualTables;
+    bool hasSequence = false;
+    {
+        sqlite3_stmt* statement = nullptr;
+        sqlite3_prepare_v2(handle, "SELECT type, name, sql FROM sqlite_master WHERE sql IS NOT NULL ORDER BY rowid", -1, &statement, nullptr);
+        while (sqlite3_step(statement) == SQLITE_ROW)
+        {
+            SchemaEntry entry;
+            entry.type = QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 0)));
+            entry.name = QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 1)));
+            entry.sql = QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 2)));
+
+            if (entry.name == "sqlite_sequence")
+                hasSequence = true;
+            else if (entry.name.startsWith("sqlite_", Qt::CaseInsensitive))
+                continue;
+            else if (entry.type == "table")
+            {
+                if (entry.sql.startsWith("CREATE VIRTUAL", Qt::CaseInsensitive))
+                    virtualTables << entry.name;
+                tables << entry;
+            }
+            else
+                others << entry;
+        }
+        sqlite3_finalize(statement);
+    }
+
+    // the shadow tables of virtual tables are filled by the virtual tables themselves. sqlite tells which tables are shadow tables since 3.37;
+    // an older one dumps every table with its rows like the .dump of the sqlite3 shell does, the virtual tables are then written straight into
+    // the schema, so that restoring them doesn't create their shadow tables a second time
+    QStringList shadowTables;
+    bool shadowTypeKnown = false;
+    {
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(handle, "SELECT name FROM pragma_table_list WHERE schema = 'main' AND type = 'shadow'", -1, &statement, nullptr)
+                == SQLITE_OK)
+        {
+            shadowTypeKnown = true;
+            while (sqlite3_step(statement) == SQLITE_ROW)
+                shadowTables << QString::fromUtf8(reinterpret_cast<const char*>(sqlite3_column_text(statement, 0)));
+        }
+        sqlite3_finalize(statement);
+    }
+
+    auto isShadow = [&](const QString& table)
+    {
+        return shadowTables.contains(table, Qt::CaseInsensitive);
+    };
+
+    // the rows of a virtual table are dumped through the table only when its shadow tables are left out
+    auto hasRows = [&](const QString& table)
+    {
+        return !isShadow(table) && (shadowTypeKnown || !virtualTables.contains(table, Qt::CaseInsensitive));
+    };
+
+    auto literal = [](QString text)
+    {
+        return "'" + text.replace("'", "''") + "'";
+    };
+
+    QTemporaryDir chunkDir(QFileInfo(request.target).absoluteDir().filePath("firelite-dump-XXXXXX"));
+    if (!chunkDir.isValid())
+    {
+        exec(handle, "COMMIT");
+        result.error = QObject::tr("No room for the temporary files next to %1").arg(request.target);
+        return false;
+    }
+
+    QVector<TableChunk> chunks;
+    foreach (const SchemaEntry& table, tables)
+    {
+        if (!hasRows(table.name))
+            continue;
+        TableChunk chunk;
+        chunk.table = table.name;
+        chunk.columns = columnsOf(table.name);
+        chunk.fileName = chunkDir.filePath(QString("%1.sql").arg(chunks.size()));
+        chunk.estimatedRows = estimateRows(table.name);
+        chunks << chunk;
+    }
+    if (hasSequence)
+    {
+        TableChunk chunk;
+        chunk.table = "sqlite_sequence";
+        chunk.columns << "name" << "seq";
+        chunk.fileName = chunkDir.filePath(QString("%1.sql").arg(chunks.size()));
+        chunks << chunk;
+    }
+
+    // WAL lets several connections read while the dump runs, other journal modes are read by the connection that holds the schema
+    QByteArray journalMode;
+    {
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(handle, "PRAGMA journal_mode", -1, &statement, nullptr) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW)
+            journalMode = reinterpret_cast<const char*>(sqlite3_column_text(statement, 0));
+        sqlite3_finalize(statement);
+    }
+
+    const int connections = request.connections > 0 ? request.connections : qBound(1, QThread::idealThreadCount(), 4);
+    result.connections = journalMode.toLower() == "wal" && chunks.size() > 1 ? qMin(connections, chunks.size()) : 1;
+
+    if (result.connections > 1)
+    {
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        sqlite3_snapshot* shared = nullptr;
+        if (sqlite3_snapshot_get(handle, "main", &shared) == SQLITE_OK)
+            snapshot = shared;
+#endif
+
+        QVector<TableChunk*> order;
+        for (TableChunk& chunk : chunks)
+            order << &chunk;
+        std::stable_sort(order.begin(), order.end(), [](const TableChunk* a, const TableChunk* b) { return a->estimatedRows > b->estimatedRows; });
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(result.connections);
+        foreach (TableChunk* chunk, order)
+            pool.start(new TableDumpTask(this, chunk));
+        while (!pool.waitForDone(ProgressInterval))
+            progress(tablesDone.load(), chunks.size(), rowsWritten.load());
+
+#ifdef SQLITE_ENABLE_SNAPSHOT
+        if (snapshot)
+            sqlite3_snapshot_free(static_cast<sqlite3_snapshot*>(snapshot));
+        snapshot = nullptr;
+#endif
+    }
+    else
+    {
+        for (TableChunk& chunk : chunks)
+        {
+            if (cancelRequested.load() || !dumpTable(handle, chunk))
+                break;
+            progress(tablesDone.load(), chunks.size(), rowsWritten.load());
+        }
+    }
+
+    exec(handle, "COMMIT");
+
+    result.tables = chunks.size();
+    result.rows = rowsWritten.load();
+    for (const TableChunk& chunk : chunks)
+    {
+        if (!chunk.error.isEmpty() && result.error.isEmpty())
+            result.error = QObject::tr("%1: %2").arg(chunk.table, chunk.error);
+        result.consistent = result.consistent && (result.connections == 1 || chunk.consistent);
+    }
+
+    if (cancelRequested.load())
+        result.cancelled = true;
+    if (result.cancelled || !result.error.isEmpty())
+        return false;
+
+    // merge
+    QFile target(request.target);
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        result.error = target.errorString();
+        return false;
+    }
+
+    auto write = [&](const QString& text)
+    {
+        const QByteArray bytes = text.toUtf8();
+        if (target.write(bytes) != bytes.size())
+            error = target.errorString();
+        return error.isEmpty();
+    };
+
+    bool ok = write("PRAGMA foreign_keys=OFF;\nBEGIN TRANSACTION;\n");
+    bool writableSchema = false;
+    foreach (const SchemaEntry& table, tables)
+    {
+        if (!ok || isShadow(table.name))
+            continue;
+
+        if (!shadowTypeKnown && virtualTables.contains(table.name, Qt::CaseInsensitive))
+        {
+            if (!writableSchema)
+                ok = write("PRAGMA writable_schema=ON;\n");
+            writableSchema = true;
+            ok = ok && write(QString("INSERT INTO sqlite_master(type,name,tbl_name,rootpage,sql) VALUES('table',%1,%1,0,%2);\n")
+                             .arg(literal(table.name), literal(table.sql)));
+        }
+        else
+            ok = write(table.sql + ";\n");
+    }
+    for (const TableChunk& chunk : chunks)
+    {
+        if (ok && chunk.table == "sqlite_sequence")
+            ok = write("DELETE FROM sqlite_sequence;\n");
+        ok = ok && appendFile(target, chunk.fileName, error);
+    }
+    foreach (const SchemaEntry& entry, others)
+    {
+        if (ok)
+            ok = write(entry.sql + ";\n");
+    }
+    if (writableSchema)
+        ok = ok && write("PRAGMA writable_schema=OFF;\n");
+    ok = ok && write("COMMIT;\n");
+
+    result.bytes = target.size();
+    target.close();
+
+    if (!ok)
+    {
+        result.error = error;
+        QFile::remove(request.target);
+        return false;
+    }
+
+    return true;
+}
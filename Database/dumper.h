@@ -0,0 +1,62 @@
+#ifndef DUMPER_H
+#define DUMPER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QAtomicInt>
+#include <functional>
+
+#include "Database/dump.h"
+
+struct sqlite3;
+
+/*
+ * Writes a database as a script that recreates it: the tables first, then their rows as multi-row INSERT statements, then the indexes, triggers
+ * and views, so that the indexes are built once over all the rows when the script runs. The rows of every table go into a chunk file of their
+ * own, which lets a database in WAL mode be dumped over several read connections at once; the chunks are merged into the target in schema order.
+ *
+ * Runs in the thread of the caller, which it blocks until the dump is done.
+ */
+class Dumper
+{
+public:
+    Dumper(sqlite3* handle, const QString& path, const QAtomicInt& cancelRequested);
+
+    // progress is called from the thread of the caller, with the tables dumped so far and the rows written
+    typedef std::function<void(int tablesDone, int tableCount, qint64 rows)> Progress;
+
+    bool dump(const DatabaseDump& request, DumpResult& result, const Progress& progress);
+
+    struct TableChunk
+    {
+        QString table;
+        QStringList columns;
+        QString fileName;
+        qint64 estimatedRows = 0;
+        qint64 rows = 0;
+        bool consistent = true;
+        QString error;
+    };
+
+    // writes the rows of a table into its chunk, on any connection
+    bool dumpTable(sqlite3* db, TableChunk& chunk);
+
+    // opens a read connection of its own for a table, in the snapshot of the dump when sqlite supports it
+    void dumpTableOnNewConnection(TableChunk& chunk);
+
+private:
+    sqlite3* handle;
+    QString path;
+    const QAtomicInt& cancelRequested;
+    int rowsPerInsert = 500;
+    void* snapshot = nullptr;
+
+    QAtomicInt tablesDone;
+    QAtomicInteger<qint64> rowsWritten;
+
+    QStringList columnsOf(const QString& table);
+    qint64 estimateRows(const QString& table);
+};
+
+#endif // DUMPER_H
@@ -0,0 +1,58 @@
+#ifndef KEYSET_H
+#define KEYSET_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QMetaType>
+
+#include "Database/resultpage.h"
+
+// Request for a page of a table, positioned by the key of a row rather than by an offset
+struct KeysetQuery
+{
+    enum Anchor
+    {
+        First,      // the first rows of the table
+        Last,       // the last rows of the table
+        After,      // the rows right after key
+        Before,     // the rows right before key
+        From,       // the rows starting at key, key may hold fewer values than the table has key columns
+        Fraction    // the rows at a relative position, key holds a single number between 0 and 1
+    };
+
+    QString table;
+    Anchor anchor = First;
+    QVariantList key;
+    int limit = 500;
+
+    // chosen by the requester to recognize the answer
+    QString cacheKey;
+};
+
+// A page of a table as read by QueryWorker::fetchKeysetPage
+struct KeysetPage
+{
+    QString table;
+    QString cacheKey;
+    QStringList columns;
+    ResultPage rows;
+
+    // key of every row, the first and last ones anchor the neighbouring pages
+    QVector<QVariantList> keys;
+
+    // no rows before the first one or after the last one
+    bool atStart = false;
+    bool atEnd = false;
+
+    // the table can be positioned by Fraction with a single seek
+    bool seekable = false;
+
+    // non empty if the page could not be read
+    QString error;
+};
+
+Q_DECLARE_METATYPE(KeysetQuery)
+Q_DECLARE_METATYPE(KeysetPage)
+
+#endif // KEYSET_H
@@ -0,0 +1,398 @@
+#include "queryengine.h"
+#include "queryworker.h"
+
+namespace
+{
+    // milliseconds between two checks for changes made to the open database by other connections
+    const int ChangePollInterval = 2000;
+}
+
+QueryEngine::QueryEngine(QObject *parent) : QObject(parent), worker(new QueryWorker)
+{
+    qRegisterMetaType<ExecutionResult>("ExecutionResult");
+    qRegisterMetaType<ScriptResult>("ScriptResult");
+    qRegisterMetaType<ResultPage>("ResultPage");
+    qRegisterMetaType<KeysetQuery>("KeysetQuery");
+    qRegisterMetaType<KeysetPage>("KeysetPage");
+    qRegisterMetaType<QueryPlan>("QueryPlan");
+    qRegisterMetaType<CsvImport>("CsvImport");
+    qRegisterMetaType<CsvImportResult>("CsvImportResult");
+    qRegisterMetaType<ResultExport>("ResultExport");
+    qRegisterMetaType<ResultExportResult>("ResultExportResult");
+    qRegisterMetaType<DatabaseBackup>("DatabaseBackup");
+    qRegisterMetaType<BackupResult>("BackupResult");
+    qRegisterMetaType<DatabaseDump>("DatabaseDump");
+    qRegisterMetaType<DumpResult>("DumpResult");
+    qRegisterMetaType<ScriptFileRun>("ScriptFileRun");
+    qRegisterMetaType<ScriptFileResult>("ScriptFileResult");
+    qRegisterMetaType<SchemaDelta>("SchemaDelta");
+    qRegisterMetaType<ConnectionProfile>("ConnectionProfile");
+    qRegisterMetaType<QVector<QVariantList>>("QVector<QVariantList>");
+
+    workerThread.setObjectName("QueryEngine");
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+
+    // requests (queued, since the worker lives in another thread)
+    connect(this, &QueryEngine::openRequested, worker, &QueryWorker::open);
+    connect(this, &QueryEngine::closeRequested, worker, &QueryWorker::close);
+    connect(this, &QueryEngine::closeDatabaseRequested, worker, &QueryWorker::closeDatabase);
+    connect(this, &QueryEngine::setConnectionProfileRequested, worker, &QueryWorker::setConnectionProfile);
+    connect(this, &QueryEngine::attachRequested, worker, &QueryWorker::attach);
+    connect(this, &QueryEngine::detachRequested, worker, &QueryWorker::detach);
+    connect(this, &QueryEngine::executeRequested, worker, &QueryWorker::execute);
+    connect(this, &QueryEngine::executeScriptRequested, worker, &QueryWorker::executeScript);
+    connect(this, &QueryEngine::executeBatchRequested, worker, &QueryWorker::executeBatch);
+    connect(this, &QueryEngine::fetchMoreRequested, worker, &QueryWorker::fetchMore);
+    connect(this, &QueryEngine::fetchPageRequested, worker, &QueryWorker::fetchPage);
+    connect(this, &QueryEngine::storePageRequested, worker, &QueryWorker::storePage);
+    connect(this, &QueryEngine::fetchKeysetPageRequested, worker, &QueryWorker::fetchKeysetPage);
+    connect(this, &QueryEngine::explainRequested, worker, &QueryWorker::explain);
+    connect(this, &QueryEngine::importCsvRequested, worker, &QueryWorker::importCsv);
+    connect(this, &QueryEngine::exportResultRequested, worker, &QueryWorker::exportResult);
+    connect(this, &QueryEngine::backupRequested, worker, &QueryWorker::backup);
+    connect(this, &QueryEngine::dumpRequested, worker, &QueryWorker::dump);
+    connect(this, &QueryEngine::runScriptFileRequested, worker, &QueryWorker::runScriptFile);
+    connect(this, &QueryEngine::refreshSchemaRequested, worker, &QueryWorker::refreshSchema);
+    connect(this, &QueryEngine::checkForChangesRequested, worker, &QueryWorker::checkForChanges);
+
+    // notifications
+    connect(worker, &QueryWorker::opened, this, [=](const QString& p, bool ok, const QString& error)
+    {
+        if (p == path)
+            connected = ok;
+        emit opened(p, ok, error);
+        if (ok)
+            refreshSchema();
+    });
+    connect(worker, &QueryWorker::schemaUpdated, this, &QueryEngine::schemaUpdated);
+    connect(worker, &QueryWorker::attachmentsChanged, this, &QueryEngine::attachmentsChanged);
+    connect(worker, &QueryWorker::attachFailed, this, &QueryEngine::attachFailed);
+    connect(worker, &QueryWorker::databaseChanged, this, &QueryEngine::databaseChanged);
+    connect(worker, &QueryWorker::started, this, &QueryEngine::started);
+    connect(worker, &QueryWorker::columnsReady, this, &QueryEngine::columnsReady);
+    connect(worker, &QueryWorker::pageFetched, this, &QueryEngine::pageFetched);
+    connect(worker, &QueryWorker::refetchUnavailable, this, &QueryEngine::refetchUnavailable);
+    connect(worker, &QueryWorker::keysetPageFetched, this, &QueryEngine::keysetPageFetched);
+    connect(worker, &QueryWorker::planReady, this, &QueryEngine::planReady);
+    connect(worker, &QueryWorker::importProgress, this, &QueryEngine::importProgress);
+    connect(worker, &QueryWorker::exportProgress, this, &QueryEngine::exportProgress);
+    connect(worker, &QueryWorker::backupProgress, this, &QueryEngine::backupProgress);
+    connect(worker, &QueryWorker::dumpProgress, this, &QueryEngine::dumpProgress);
+    connect(worker, &QueryWorker::dumpFinished, this, [=](const DumpResult& result)
+    {
+        setPending(pending - 1);
+        emit dumpFinished(result);
+    });
+    connect(worker, &QueryWorker::scriptFileProgress, this, &QueryEngine::scriptFileProgress);
+    connect(worker, &QueryWorker::scriptFileFinished, this, [=](const ScriptFileResult& result)
+    {
+        setPending(pending - 1);
+        emit scriptFileFinished(result);
+        refreshSchema();
+    });
+    connect(worker, &QueryWorker::backupFinished, this, [=](const BackupResult& result)
+    {
+        setPending(pending - 1);
+        emit backupFinished(result);
+    });
+    connect(worker, &QueryWorker::exportFinished, this, [=](const ResultExportResult& result)
+    {
+        setPending(pending - 1);
+        emit exportFinished(result);
+    });
+    connect(worker, &QueryWorker::importFinished, this, [=](const CsvImportResult& result)
+    {
+        setPending(pending - 1);
+        emit importFinished(result);
+        refreshSchema();
+    });
+    connect(worker, &QueryWorker::statisticsUpdated, this, &QueryEngine::statisticsUpdated);
+    connect(worker, &QueryWorker::statementCacheUpdated, this, &QueryEngine::statementCacheUpdated);
+    connect(worker, &QueryWorker::finished, this, [=](const ExecutionResult& result)
+    {
+        setPending(pending - 1);
+        emit finished(result);
+        refreshSchema();
+    });
+    connect(worker, &QueryWorker::failed, this, [=](const ExecutionResult& result, const QString& error)
+    {
+        setPending(pending - 1);
+        emit failed(result, error);
+    });
+    connect(worker, &QueryWorker::aborted, this, [=](const ExecutionResult& result)
+    {
+        setPending(pending - 1);
+        emit aborted(result);
+    });
+    connect(worker, &QueryWorker::scriptProgress, this, &QueryEngine::scriptProgress);
+    connect(worker, &QueryWorker::scriptFinished, this, [=](const ScriptResult& result)
+    {
+        setPending(pending - 1);
+        emit scriptFinished(result);
+        refreshSchema();
+    });
+
+    changeTimer.setInterval(ChangePollInterval);
+    connect(&changeTimer, &QTimer::timeout, this, [=]()
+    {
+        if (connected && !isBusy())
+            checkForChanges();
+    });
+
+    workerThread.start();
+    changeTimer.start();
+}
+
+QueryEngine::~QueryEngine()
+{
+    // the worker releases its connection in its destructor, which runs in the worker thread once the event loop quits
+    worker->cancel();
+    workerThread.quit();
+    workerThread.wait();
+}
+
+bool QueryEngine::isBusy() const
+{
+    return pending > 0;
+}
+
+bool QueryEngine::isOpen() const
+{
+    return connected;
+}
+
+QString QueryEngine::databasePath() const
+{
+    return path;
+}
+
+/*
+ * Stops the statement that is currently executing, the worker reports it through aborted().
+ */
+void QueryEngine::cancel()
+{
+    if (isBusy())
+        worker->cancel();
+}
+
+/*
+ * Interrupts statements that run longer than msecs milliseconds, zero disables the timeout.
+ */
+void QueryEngine::setTimeout(int msecs)
+{
+    worker->setTimeout(msecs);
+}
+
+/*
+ * Limits the number of databases whose connection the worker keeps open, the least recently used one is closed first.
+ */
+void QueryEngine::setPoolSize(int connections)
+{
+    worker->setPoolSize(connections);
+}
+
+int QueryEngine::poolSize() const
+{
+    return worker->poolSize();
+}
+
+/*
+ * Makes a database the active one. Its connection stays open when another database is opened afterwards, so switching back to it is cheap.
+ */
+void QueryEngine::open(const QString &p)
+{
+    if (p == path && connected)
+        return;
+
+    path = p;
+    connected = false;
+    emit openRequested(p);
+}
+
+/*
+ * Sets the pragmas the worker runs whenever it opens a database, such as the journal mode and the cache size. They are applied right away if the
+ * database is already open.
+ */
+void QueryEngine::setConnectionProfile(const QString &p, const ConnectionProfile &profile)
+{
+    emit setConnectionProfileRequested(p, profile);
+}
+
+/*
+ * Attaches another database file to the active database under a schema name, its tables are then reached as schema.table by the statements of
+ * the engine. attachmentsChanged() reports the databases attached afterwards, attachFailed() why sqlite refused.
+ */
+void QueryEngine::attach(const QString &p, const QString &schema)
+{
+    emit attachRequested(p, schema);
+}
+
+void QueryEngine::detach(const QString &schema)
+{
+    emit detachRequested(schema);
+}
+
+/*
+ * Closes the connections of every database.
+ */
+void QueryEngine::close()
+{
+    path.clear();
+    connected = false;
+    emit closeRequested();
+}
+
+/*
+ * Closes the connection of a single database, such as one removed from the explorar.
+ */
+void QueryEngine::closeDatabase(const QString &p)
+{
+    if (p == path)
+    {
+        path.clear();
+        connected = false;
+    }
+    emit closeDatabaseRequested(p);
+}
+
+void QueryEngine::execute(const QString &command, const QVariantList &values)
+{
+    setPending(pending + 1);
+    emit executeRequested(command, values);
+}
+
+/*
+ * Executes a statement with parameters once for every row of values, inside a single transaction. The outcome is reported through finished() with
+ * the total of the affected rows.
+ */
+void QueryEngine::executeBatch(const QString &statement, const QVector<QVariantList> &rows)
+{
+    setPending(pending + 1);
+    emit executeBatchRequested(statement, rows);
+}
+
+/*
+ * Executes every statement of the script, the worker splits it and reports through scriptProgress() and scriptFinished(). A script that holds
+ * a single statement is executed like execute() does.
+ */
+void QueryEngine::executeScript(const QString &script, bool useTransaction)
+{
+    setPending(pending + 1);
+    emit executeScriptRequested(script, useTransaction);
+}
+
+/*
+ * Asks for the next page of the active result set.
+ */
+void QueryEngine::fetchMore()
+{
+    emit fetchMoreRequested();
+}
+
+/*
+ * Asks for a page of the active result set that was already read once, the answer arrives through pageFetched().
+ */
+void QueryEngine::fetchPage(int resultId, int page)
+{
+    emit fetchPageRequested(resultId, page);
+}
+
+/*
+ * Hands a page the view dropped to the worker, which keeps it on disk until fetchPage() asks for it again.
+ */
+void QueryEngine::storePage(int resultId, int page, const ResultPage &rows)
+{
+    emit storePageRequested(resultId, page, rows);
+}
+
+/*
+ * Asks for a page of a table positioned by key, the answer arrives through keysetPageFetched(). Browsing doesn't count as busy, it runs between
+ * the statements of the editor.
+ */
+void QueryEngine::fetchKeysetPage(const KeysetQuery &request)
+{
+    emit fetchKeysetPageRequested(request);
+}
+
+/*
+ * Asks for the plan of a statement, the answer arrives through planReady(). The statement itself is not executed.
+ */
+void QueryEngine::explain(const QString &statement, bool bytecode)
+{
+    emit explainRequested(statement, bytecode);
+}
+
+/*
+ * Loads a CSV file into a table in the worker thread. Progress is reported through importProgress(), the outcome through importFinished(), and
+ * cancel() stops the import after the records committed so far.
+ */
+void QueryEngine::importCsv(const CsvImport &request)
+{
+    setPending(pending + 1);
+    emit importCsvRequested(request);
+}
+
+/*
+ * Writes the rows of a select statement into a file in the worker thread, reported through exportProgress() and exportFinished().
+ */
+void QueryEngine::exportResult(const ResultExport &request)
+{
+    setPending(pending + 1);
+    emit exportResultRequested(request);
+}
+
+/*
+ * Copies the open database into another file in the worker thread, reported through backupProgress() and backupFinished().
+ */
+void QueryEngine::backup(const DatabaseBackup &request)
+{
+    setPending(pending + 1);
+    emit backupRequested(request);
+}
+
+/*
+ * Writes the open database as an SQL script in the worker thread, reported through dumpProgress() and dumpFinished().
+ */
+void QueryEngine::dump(const DatabaseDump &request)
+{
+    setPending(pending + 1);
+    emit dumpRequested(request);
+}
+
+/*
+ * Executes an SQL script, such as a dump or a migration, straight from a file in the worker thread, reported through scriptFileProgress() and
+ * scriptFileFinished().
+ */
+void QueryEngine::runScriptFile(const ScriptFileRun &request)
+{
+    setPending(pending + 1);
+    emit runScriptFileRequested(request);
+}
+
+/*
+ * Asks the worker for the changes of the schema since it last reported them, the answer arrives through schemaUpdated() if there are any. The
+ * engine calls this itself once a database is opened and after every statement, script or import, since any of them may have changed the schema.
+ */
+void QueryEngine::refreshSchema()
+{
+    emit refreshSchemaRequested();
+}
+
+/*
+ * Asks the worker whether another connection, such as another process, committed to the open database since the last check. If so the worker
+ * reports it through databaseChanged(), and through schemaUpdated() if the schema changed too. The engine calls this itself every few seconds
+ * while it is idle.
+ */
+void QueryEngine::checkForChanges()
+{
+    emit checkForChangesRequested();
+}
+
+void QueryEngine::setPending(int count)
+{
+    const bool wasBusy = isBusy();
+    pending = qMax(0, count);
+    if (wasBusy != isBusy())
+        emit busyChanged(isBusy());
+}
@@ -0,0 +1,136 @@
+#ifndef QUERYENGINE_H
+#define QUERYENGINE_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+
+#include "Database/queryresult.h"
+#include "Database/resultpage.h"
+#include "Database/keyset.h"
+#include "Database/queryplan.h"
+#include "Database/csvimport.h"
+#include "Database/resultexport.h"
+#include "Database/backup.h"
+#include "Database/dump.h"
+#include "Database/scriptfile.h"
+#include "Database/schemainfo.h"
+#include "Database/connectionprofile.h"
+
+class QueryWorker;
+
+/*
+ * GUI side of the query execution engine. Owns a dedicated thread with a QueryWorker living in it, forwards requests to the worker through queued
+ * signals and re-emits the worker's notifications in the GUI thread. None of the public functions block.
+ */
+class QueryEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QueryEngine(QObject* parent = nullptr);
+    ~QueryEngine();
+
+    bool isBusy() const;
+    bool isOpen() const;
+    QString databasePath() const;
+
+    // thread safe, take effect immediately even while the worker is busy
+    void cancel();
+    void setTimeout(int msecs);
+    void setPoolSize(int connections);
+    int poolSize() const;
+
+public slots:
+    void open(const QString& path);
+    void close();
+    void closeDatabase(const QString& path);
+    void setConnectionProfile(const QString& path, const ConnectionProfile& profile);
+    void attach(const QString& path, const QString& schema);
+    void detach(const QString& schema);
+    void execute(const QString& command, const QVariantList& values = QVariantList());
+    void executeBatch(const QString& statement, const QVector<QVariantList>& rows);
+    void executeScript(const QString& script, bool useTransaction);
+    void fetchMore();
+    void fetchPage(int resultId, int page);
+    void storePage(int resultId, int page, const ResultPage& rows);
+    void fetchKeysetPage(const KeysetQuery& request);
+    void explain(const QString& statement, bool bytecode);
+    void importCsv(const CsvImport& request);
+    void exportResult(const ResultExport& request);
+    void backup(const DatabaseBackup& request);
+    void dump(const DatabaseDump& request);
+    void runScriptFile(const ScriptFileRun& request);
+    void refreshSchema();
+    void checkForChanges();
+
+signals:
+    // notifications from the worker thread
+    void opened(const QString& path, bool ok, const QString& error);
+    void started(const QString& command);
+    void columnsReady(int resultId, const QStringList& columns, bool refetchable);
+    void pageFetched(int resultId, int page, const ResultPage& rows, bool atEnd, bool failed);
+    void refetchUnavailable(int resultId);
+    void finished(const ExecutionResult& result);
+    void failed(const ExecutionResult& result, const QString& error);
+    void aborted(const ExecutionResult& result);
+    void scriptProgress(int executed, int count);
+    void scriptFinished(const ScriptResult& result);
+    void keysetPageFetched(const KeysetPage& page);
+    void planReady(const QueryPlan& plan);
+    void importProgress(qint64 rows, qint64 bytesRead, qint64 totalBytes);
+    void importFinished(const CsvImportResult& result);
+    void exportProgress(qint64 rows, qint64 bytes);
+    void exportFinished(const ResultExportResult& result);
+    void backupProgress(int remaining, int pageCount);
+    void backupFinished(const BackupResult& result);
+    void dumpProgress(int tablesDone, int tableCount, qint64 rows);
+    void dumpFinished(const DumpResult& result);
+    void scriptFileProgress(qint64 statements, qint64 bytesRead, qint64 totalBytes);
+    void scriptFileFinished(const ScriptFileResult& result);
+    void schemaUpdated(const SchemaDelta& delta);
+    void attachmentsChanged(const QString& path, const QVariantMap& databases);
+    void attachFailed(const QString& schema, const QString& error);
+    void databaseChanged(const QString& path);
+    void statisticsUpdated(const ExecutionResult& result);
+    void statementCacheUpdated(qint64 hits, qint64 misses, int size);
+    void busyChanged(bool busy);
+
+    // requests to the worker thread
+    void openRequested(const QString& path);
+    void closeRequested();
+    void closeDatabaseRequested(const QString& path);
+    void setConnectionProfileRequested(const QString& path, const ConnectionProfile& profile);
+    void attachRequested(const QString& path, const QString& schema);
+    void detachRequested(const QString& schema);
+    void executeRequested(const QString& command, const QVariantList& values);
+    void executeBatchRequested(const QString& statement, const QVector<QVariantList>& rows);
+    void executeScriptRequested(const QString& script, bool useTransaction);
+    void fetchMoreRequested();
+    void fetchPageRequested(int resultId, int page);
+    void storePageRequested(int resultId, int page, const ResultPage& rows);
+    void fetchKeysetPageRequested(const KeysetQuery& request);
+    void explainRequested(const QString& statement, bool bytecode);
+    void importCsvRequested(const CsvImport& request);
+    void exportResultRequested(const ResultExport& request);
+    void backupRequested(const DatabaseBackup& request);
+    void dumpRequested(const DatabaseDump& request);
+    void runScriptFileRequested(const ScriptFileRun& request);
+    void refreshSchemaRequested();
+    void checkForChangesRequested();
+
+private:
+    QThread workerThread;
+    QueryWorker* worker;
+
+    QString path;
+    bool connected = false;
+    int pending = 0;
+
+    // polls the open database for the commits of other connections while the engine is idle
+    QTimer changeTimer;
+
+    void setPending(int count);
+};
+
+#endif // QUERYENGINE_H
@@ -0,0 +1,41 @@
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QMetaType>
+
+// A step of the plan reported by EXPLAIN QUERY PLAN
+struct QueryPlanNode
+{
+    int id = 0;
+    int parent = 0;
+    QString detail;
+
+    // rows of the table a SCAN step reads, from sqlite_stat1 or the largest rowid, -1 if unknown
+    qint64 estimatedRows = -1;
+
+    // the step reads a large table from end to end or builds a temporary b-tree, hint says what to do about it
+    bool hotSpot = false;
+    QString hint;
+};
+
+// Plan of a statement as computed by QueryWorker::explain
+struct QueryPlan
+{
+    QString statement;
+    QVector<QueryPlanNode> nodes;
+
+    // the virtual machine program of EXPLAIN, only when it was asked for
+    QStringList bytecodeColumns;
+    QVector<QVariantList> bytecode;
+
+    // non empty if the statement could not be explained
+    QString error;
+};
+
+Q_DECLARE_METATYPE(QueryPlan)
+
+#endif // QUERYPLAN_H
@@ -0,0 +1,83 @@
+#ifndef QUERYRESULT_H
+#define QUERYRESULT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QMetaType>
+
+// Why a statement was stopped before it completed
+enum class AbortReason
+{
+    NotAborted,
+    Cancelled,
+    TimedOut
+};
+
+// Summary of a single statement that was executed by the QueryWorker
+struct ExecutionResult
+{
+    // the statement as it was sent to sqlite
+    QString command;
+
+    // true if the statement produced a result set
+    bool isSelect = false;
+
+    // rows affected by insert, update or delete statements
+    int rowsAffected = 0;
+
+    // rows of values the statement was executed with as a batch, 0 if it was executed once
+    int boundRows = 0;
+
+    // wall time spent executing the statement, in milliseconds
+    qint64 elapsed = 0;
+
+    // approximate number of virtual machine instructions executed, counted by the progress handler
+    qint64 progressSteps = 0;
+
+    // identifies the result set of a select statement, so that its statistics can be updated as more rows are fetched
+    int resultId = 0;
+
+    // milliseconds until the first row was available, -1 if the statement returned no rows
+    qint64 firstRowTime = -1;
+
+    // rows read from the result set so far
+    qint64 rowsReturned = 0;
+
+    // counters of the prepared statement, see sqlite3_stmt_status
+    qint64 vmSteps = 0;
+    qint64 fullScanSteps = 0;
+    qint64 sorts = 0;
+    qint64 autoIndexes = 0;
+
+    // page cache lookups of the connection while the statement ran, see sqlite3_db_status
+    qint64 cacheHits = 0;
+    qint64 cacheMisses = 0;
+
+    // set when the statement was interrupted by a cancel request or its timeout
+    AbortReason abortReason = AbortReason::NotAborted;
+
+    // position of the statement in the script it belongs to
+    int statementIndex = 0;
+    int statementCount = 1;
+    int line = 1;
+};
+
+// Summary of a script that was executed statement by statement
+struct ScriptResult
+{
+    // true if the script ran inside a single wrapping transaction
+    bool transaction = false;
+
+    // wall time spent on the whole script, in milliseconds
+    qint64 elapsed = 0;
+
+    // timing of every statement, in the order they were executed
+    QVector<ExecutionResult> statements;
+};
+
+Q_DECLARE_METATYPE(ExecutionResult)
+Q_DECLARE_METATYPE(ScriptResult)
+
+#endif // QUERYRESULT_H
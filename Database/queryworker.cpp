@@ -0,0 +1,2127 @@
+#include "queryworker.h"
+#include "sqlitehandle.h"
+#include "Libraries/sqllexer.h"
+#include "Libraries/csvreader.h"
+#include "Libraries/sqlscriptreader.h"
+#include "Formats/resultwriter.h"
+#include "Database/dumper.h"
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QMutexLocker>
+#include <QMap>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QDataStream>
+#include <QDir>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+
+namespace
+{
+    // number of virtual machine instructions between two calls of the progress handler
+    const int ProgressInterval = 1000;
+
+    // prepared statements kept per connection
+    const int StatementCacheSize = 128;
+
+    // databases whose connection is kept open, unless the GUI sets another limit
+    const int DefaultPoolSize = 8;
+
+    // tables with at least this many rows are too large to be read from end to end by a query plan
+    const qint64 LargeTableRows = 10000;
+
+    // minimum time between two progress reports of a running script, in milliseconds
+    const int ScriptProgressInterval = 100;
+
+    // an import or an export looks at the cancel flag and the clock once per this many records
+    const int ImportCheckInterval = 1024;
+    const int ImportProgressInterval = 250;
+
+    QByteArray attachStatement(const QString& path, const QString& schema)
+    {
+        return QString("ATTACH DATABASE '%1' AS %2").arg(QString(path).replace("'", "''"), SqlLexer::quoteIdentifier(schema)).toUtf8();
+    }
+}
+
+QueryWorker::QueryWorker(QObject *parent) : QObject(parent), maxPoolSize(DefaultPoolSize), statementCache(StatementCacheSize)
+{
+    // no connection is ever added under the prefix itself, so database() is invalid while no database is active
+    connectionPrefix = QString("firelite_worker_%1").arg(reinterpret_cast<quintptr>(this));
+    connectionName = connectionPrefix;
+}
+
+QueryWorker::~QueryWorker()
+{
+    close();
+}
+
+QSqlDatabase QueryWorker::database() const
+{
+    return QSqlDatabase::database(connectionName, false);
+}
+
+/*
+ * Whether the statement of the result set on screen can still run, on the connection of its database which may no longer be the active one.
+ */
+bool QueryWorker::canRerun() const
+{
+    return !resultSource.command.isEmpty() && pool.contains(resultSource.path);
+}
+
+/*
+ * Requests the running statement to stop. The progress handler notices the flag within a few thousand instructions, sqlite3_interrupt covers the
+ * cases where the statement is already on its way out of the virtual machine.
+ */
+void QueryWorker::cancel()
+{
+    cancelRequested.store(1);
+
+    QMutexLocker locker(&handleMutex);
+    if (handle)
+        sqlite3_interrupt(handle);
+}
+
+/*
+ * Sets the time a statement may run before it is interrupted, zero disables the timeout.
+ */
+void QueryWorker::setTimeout(int msecs)
+{
+    timeout.store(qMax(0, msecs));
+}
+
+/*
+ * Limits the number of databases whose connection is kept open, including the active one. Takes effect the next time a database is opened.
+ */
+void QueryWorker::setPoolSize(int connections)
+{
+    maxPoolSize.store(qMax(1, connections));
+}
+
+int QueryWorker::poolSize() const
+{
+    return maxPoolSize.load();
+}
+
+/*
+ * Called by sqlite every ProgressInterval instructions while a statement runs in the worker thread. Returning non zero aborts the statement
+ * with SQLITE_INTERRUPT.
+ */
+int QueryWorker::progressCallback(void *context)
+{
+    auto w = static_cast<QueryWorker*>(context);
+    w->progressSteps += ProgressInterval;
+
+    if (w->cancelRequested.load())
+    {
+        w->abortReason = AbortReason::Cancelled;
+        return 1;
+    }
+
+    const int t = w->timeout.load();
+    if (t > 0 && w->timeoutEnabled && w->runTimer.elapsed() > t)
+    {
+        w->abortReason = AbortReason::TimedOut;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Resets the cancellation state before the worker steps into sqlite again.
+ */
+void QueryWorker::beginRun(bool withTimeout)
+{
+    cancelRequested.store(0);
+    timeoutEnabled = withTimeout;
+    abortReason = AbortReason::NotAborted;
+    progressSteps = 0;
+    resetCacheCounters();
+    runTimer.start();
+}
+
+/*
+ * Starts counting the page cache lookups of the connection from zero.
+ */
+void QueryWorker::resetCacheCounters()
+{
+    if (!handle)
+        return;
+
+    int current = 0, highwater = 0;
+    sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 1);
+    sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+}
+
+/*
+ * Copies the counters of a statement into its result. The statement counters grow for as long as the statement lives, so they replace the previous
+ * values, while the page cache lookups since the last call are added and counted from zero again.
+ */
+void QueryWorker::collectStatistics(const QSqlQuery &query, ExecutionResult &result)
+{
+    if (sqlite3_stmt* stmt = sqliteStatement(query))
+    {
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+        result.vmSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0);
+#endif
+        result.fullScanSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+        result.sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 0);
+        result.autoIndexes = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0);
+    }
+
+    if (handle)
+    {
+        int current = 0, highwater = 0;
+        sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 1);
+        result.cacheHits += current;
+        sqlite3_db_status(handle, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+        result.cacheMisses += current;
+    }
+}
+
+/*
+ * Makes the given database document the active one. A database opened before still has its connection in the pool, so switching back to it
+ * costs no open, no schema parse and keeps its page cache; otherwise a connection is opened and the least recently used one is closed if the
+ * pool is full. Opening the document that is already active is a no-op, so the GUI can call this whenever the selection in the explorar changes.
+ */
+void QueryWorker::open(const QString &path)
+{
+    if (path == databasePath && database().isOpen())
+    {
+        emit opened(path, true, QString());
+        return;
+    }
+
+    deactivate();
+
+    auto it = pool.find(path);
+    if (it == pool.end())
+    {
+        PooledConnection connection;
+        connection.name = QString("%1_%2").arg(connectionPrefix).arg(++connectionCount);
+
+        // a document that is still empty gets the page size of its profile
+        const bool created = QFileInfo(path).size() == 0;
+
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection.name);
+        db.setDatabaseName(path);
+        if (!db.open())
+        {
+            const QString error = db.lastError().text();
+            db = QSqlDatabase();
+            QSqlDatabase::removeDatabase(connection.name);
+            emit opened(path, false, error);
+            return;
+        }
+
+        connection.handle = sqliteHandle(db);
+        if (connection.handle)
+        {
+            sqlite3_progress_handler(connection.handle, ProgressInterval, &QueryWorker::progressCallback, this);
+            applyProfile(connection.handle, profiles.value(path), created);
+
+            // the databases that were attached before the pool closed the connection
+            const QVariantMap attached = attachments.value(path);
+            for (auto i = attached.constBegin(); i != attached.constEnd(); ++i)
+                sqlite3_exec(connection.handle, attachStatement(i.value().toString(), i.key()).constData(), nullptr, nullptr, nullptr);
+        }
+        it = pool.insert(path, connection);
+    }
+
+    it->lastUsed = ++poolClock;
+    connectionName = it->name;
+    dataVersion = it->dataVersion;
+    {
+        QMutexLocker locker(&handleMutex);
+        handle = it->handle;
+    }
+
+    databasePath = path;
+    trimPool();
+    emit opened(path, true, QString());
+    syncAttachments();
+
+    // commits of other connections since the database was last active are reported now, the first time this sets the version to compare with
+    checkForChanges();
+}
+
+/*
+ * Closes every connection of the pool. Must run in the worker thread.
+ */
+void QueryWorker::close()
+{
+    deactivate();
+    foreach (const QString& path, pool.keys())
+        closeConnection(path);
+}
+
+/*
+ * Closes the connection of a database that was removed from the explorar, whether it is the active one or not.
+ */
+void QueryWorker::closeDatabase(const QString &path)
+{
+    if (path == databasePath)
+        deactivate();
+    closeConnection(path);
+    schemaCache.remove(path);
+    attachments.remove(path);
+}
+
+/*
+ * Sets the pragma settings of a database. They are applied every time the database is opened, and right away if its connection is open.
+ */
+void QueryWorker::setConnectionProfile(const QString &path, const ConnectionProfile &profile)
+{
+    profiles.insert(path, profile);
+
+    const auto it = pool.constFind(path);
+    if (it != pool.constEnd() && it->handle)
+        applyProfile(it->handle, profile, false);
+}
+
+/*
+ * Runs the pragmas of a profile on a connection. A pragma sqlite refuses, such as WAL on a file system without shared memory, leaves that
+ * setting as it was and doesn't keep the others from being applied.
+ */
+void QueryWorker::applyProfile(sqlite3 *connection, const ConnectionProfile &profile, bool created)
+{
+    foreach (const QString& pragma, profile.pragmas(created))
+        sqlite3_exec(connection, pragma.toUtf8().constData(), nullptr, nullptr, nullptr);
+}
+
+/*
+ * Attaches another database file to the active connection under a schema name, so that a statement can join the tables of both and sqlite runs
+ * it in one pass. The attachment belongs to the connection of the active database and is made again whenever that connection is reopened.
+ */
+void QueryWorker::attach(const QString &path, const QString &schema)
+{
+    if (!database().isOpen())
+    {
+        emit attachFailed(schema, tr("Please select a database first before attaching another one to it."));
+        return;
+    }
+
+    QString error;
+    if (!execNative(attachStatement(path, schema).constData(), &error))
+        emit attachFailed(schema, error);
+    syncAttachments();
+}
+
+void QueryWorker::detach(const QString &schema)
+{
+    if (!database().isOpen())
+        return;
+
+    // the active result set may still read from the attached database, which keeps it from being detached
+    releaseResultSet();
+
+    QString error;
+    if (!execNative(QString("DETACH DATABASE %1").arg(SqlLexer::quoteIdentifier(schema)).toUtf8().constData(), &error))
+        emit attachFailed(schema, error);
+    syncAttachments();
+}
+
+/*
+ * Reads the databases attached to the active connection, by attach() as well as by ATTACH statements of the user, keeps them for when the
+ * connection is reopened and reports them. The cached statements are dropped when they changed, since a name may now resolve to another schema.
+ */
+void QueryWorker::syncAttachments()
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+        return;
+
+    QVariantMap databases;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (query.exec("PRAGMA database_list"))
+    {
+        while (query.next())
+        {
+            const QString schema = query.value(1).toString();
+            if (schema != "main" && schema != "temp")
+                databases.insert(schema, query.value(2).toString());
+        }
+    }
+    query.finish();
+
+    if (databases != attachments.value(databasePath))
+        statementCache.clear();
+    attachments.insert(databasePath, databases);
+    emit attachmentsChanged(databasePath, databases);
+}
+
+/*
+ * Leaves the active database, its connection stays open in the pool. The cursor and the prepared statements belong to the connection and must
+ * go, the schema and the data version are kept for when the database is active again.
+ */
+void QueryWorker::deactivate()
+{
+    releaseResultSet();
+    clearStatementCache();
+
+    if (databasePath.isEmpty())
+        return;
+
+    auto it = pool.find(databasePath);
+    if (it != pool.end())
+        it->dataVersion = dataVersion;
+    if (schemaReported)
+        schemaCache.insert(databasePath, knownSchema);
+
+    {
+        QMutexLocker locker(&handleMutex);
+        handle = nullptr;
+    }
+
+    knownSchema = KnownSchema();
+    schemaReported = false;
+    dataVersion = -1;
+    connectionName = connectionPrefix;
+    databasePath.clear();
+}
+
+/*
+ * Closes the pooled connection of a database that is not the active one.
+ */
+void QueryWorker::closeConnection(const QString &path)
+{
+    auto it = pool.find(path);
+    if (it == pool.end() || path == databasePath)
+        return;
+
+    const QString name = it->name;
+    if (it->handle)
+        sqlite3_progress_handler(it->handle, 0, nullptr, nullptr);
+    pool.erase(it);
+
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+
+    // without the connection and without the spill the dropped pages are gone, the view has to keep the ones it has
+    if (path == resultSource.path && spillFailed)
+        emit refetchUnavailable(resultSource.resultId);
+}
+
+/*
+ * Closes the least recently used connections until the pool fits its size. The active connection is never closed.
+ */
+void QueryWorker::trimPool()
+{
+    while (pool.size() > maxPoolSize.load())
+    {
+        QString oldest;
+        quint64 lastUsed = 0;
+        for (auto it = pool.cbegin(); it != pool.cend(); ++it)
+        {
+            if (it.key() != databasePath && (oldest.isEmpty() || it->lastUsed < lastUsed))
+            {
+                oldest = it.key();
+                lastUsed = it->lastUsed;
+            }
+        }
+
+        if (oldest.isEmpty())
+            return;
+        closeConnection(oldest);
+    }
+}
+
+/*
+ * Checks the cancellation state between two statements of a script, where the progress handler may not have run at all.
+ */
+bool QueryWorker::isInterrupted()
+{
+    const int t = timeout.load();
+    if (cancelRequested.load())
+        abortReason = AbortReason::Cancelled;
+    else if (t > 0 && timeoutEnabled && runTimer.elapsed() > t)
+        abortReason = AbortReason::TimedOut;
+
+    return abortReason != AbortReason::NotAborted;
+}
+
+/*
+ * Reports a statement that did not complete, either because sqlite rejected it or because it was interrupted.
+ */
+void QueryWorker::reportFailure(QSqlQuery *query, ExecutionResult &result)
+{
+    if (abortReason == AbortReason::NotAborted && cancelRequested.load())
+        abortReason = AbortReason::Cancelled;
+
+    result.elapsed = runTimer.elapsed();
+    result.progressSteps = progressSteps;
+    if (query)
+        collectStatistics(*query, result);
+
+    if (abortReason != AbortReason::NotAborted)
+    {
+        result.abortReason = abortReason;
+        emit aborted(result);
+    }
+    else
+        emit failed(result, query ? query->lastError().text() : QString());
+}
+
+/*
+ * Executes a statement into query. Selects and data changes go through the prepared statement cache, under their text with the layout normalized,
+ * so that re-running a query, or a statement with parameters for other values, compiles it once. The literals stay in the statement, see
+ * SqlLexer::normalize. Everything else is prepared from scratch. shape receives the cache key, to hand the statement back through recycle().
+ * values are bound to the parameters of the statement, in the order sqlite numbers them.
+ */
+bool QueryWorker::run(QScopedPointer<QSqlQuery> &query, const QString &command, QString &shape, const QVariantList &values)
+{
+    const QString keyword = SqlLexer::firstKeyword(command);
+    const bool cacheable = keyword == "SELECT" || keyword == "INSERT" || keyword == "UPDATE" || keyword == "DELETE" || keyword == "REPLACE"
+            || keyword == "WITH" || keyword == "VALUES";
+
+    shape.clear();
+    if (!cacheable)
+    {
+        query.reset(new QSqlQuery(database()));
+        query->setForwardOnly(true);
+        if (values.isEmpty())
+            return query->exec(command);
+
+        if (!query->prepare(command))
+            return false;
+        for (int i = 0; i < values.size(); ++i)
+            query->bindValue(i, values.at(i));
+        return query->exec();
+    }
+
+    shape = SqlLexer::normalize(command);
+    checkSchemaVersion();
+
+    if (QSqlQuery* cached = statementCache.take(shape))
+    {
+        ++statementCacheHits;
+        query.reset(cached);
+    }
+    else
+    {
+        ++statementCacheMisses;
+        query.reset(new QSqlQuery(database()));
+        query->setForwardOnly(true);
+        if (!query->prepare(shape))
+        {
+            shape.clear();
+            return false;
+        }
+    }
+
+    for (int i = 0; i < values.size(); ++i)
+        query->bindValue(i, values.at(i));
+
+    return query->exec();
+}
+
+/*
+ * Hands a statement that is done back to the prepared statement cache, or finalizes it if it did not come from there.
+ */
+void QueryWorker::recycle(QScopedPointer<QSqlQuery> &query, const QString &shape)
+{
+    if (!query)
+        return;
+
+    if (shape.isEmpty())
+    {
+        query.reset();
+        return;
+    }
+
+    // resetting the statement releases its read lock on the document
+    query->finish();
+    statementCache.insert(shape, query.take());
+}
+
+/*
+ * Drops the cached statements when the schema changed since they were prepared, whether by this connection or by another one. The version is read
+ * by a statement of its own, which is prepared once.
+ */
+void QueryWorker::checkSchemaVersion()
+{
+    if (!schemaVersionQuery)
+    {
+        schemaVersionQuery.reset(new QSqlQuery(database()));
+        schemaVersionQuery->setForwardOnly(true);
+        schemaVersionQuery->prepare("PRAGMA schema_version");
+    }
+
+    if (!schemaVersionQuery->exec() || !schemaVersionQuery->next())
+        return;
+
+    const int version = schemaVersionQuery->value(0).toInt();
+    schemaVersionQuery->finish();
+
+    if (version != schemaVersion)
+    {
+        statementCache.clear();
+        schemaVersion = version;
+    }
+}
+
+/*
+ * Finalizes every cached statement, they must be gone before their connection is closed.
+ */
+void QueryWorker::clearStatementCache()
+{
+    statementCache.clear();
+    schemaVersionQuery.reset();
+    schemaVersion = -1;
+    statementCacheHits = 0;
+    statementCacheMisses = 0;
+    emit statementCacheUpdated(0, 0, 0);
+}
+
+/*
+ * Makes the result set of the given select statement the active one, and hands its columns and first page of rows to the GUI. Every result set gets
+ * a new id, so pages that arrive late for an older result set can be told apart by the view.
+ */
+void QueryWorker::keepResultSet(QScopedPointer<QSqlQuery> &query, const QString &shape, ExecutionResult &result, const QVariantList &values)
+{
+    const QString& command = result.command;
+    const QSqlRecord record = query->record();
+    QStringList columns;
+    for (int i = 0; i < record.count(); ++i)
+        columns << record.fieldName(i);
+
+    const QString keyword = SqlLexer::firstKeyword(command);
+    const bool refetchable = keyword == "SELECT" || keyword == "WITH" || keyword == "VALUES";
+    activeColumnCount = record.count();
+    activeResultId++;
+
+    // the pages of the previous result set are not asked for anymore
+    resultSource = ResultSource();
+    spill.reset();
+    spilledPages.clear();
+    spillFailed = false;
+    if (refetchable)
+    {
+        resultSource.resultId = activeResultId;
+        resultSource.path = databasePath;
+        resultSource.command = SqlLexer::normalize(command);
+        resultSource.values = values;
+        resultSource.columnCount = activeColumnCount;
+    }
+    nextPage = 0;
+    activeQuery.swap(query);
+    activeShape = shape;
+    activeResult = result;
+    activeResult.resultId = activeResultId;
+
+    emit columnsReady(activeResultId, columns, refetchable);
+    fetchRows();
+    result = activeResult;
+}
+
+/*
+ * Drops the cursor of the active result set. Its rows stay on screen, so what is needed to read dropped pages again is kept in resultSource.
+ */
+void QueryWorker::releaseResultSet()
+{
+    // any statement may change the schema, so the key columns are looked up again
+    keyColumns.clear();
+
+    recycle(activeQuery, activeShape);
+    activeShape.clear();
+    activeResult = ExecutionResult();
+    activeColumnCount = 0;
+}
+
+/*
+ * Executes a single statement, binding values to its parameters if it has any. For select statements only the first page of rows is fetched, the
+ * rest is pulled by the view through fetchMore().
+ */
+void QueryWorker::execute(const QString &command, const QVariantList &values)
+{
+    // Finish the previous result set first, otherwise it keeps its read lock on the document
+    releaseResultSet();
+
+    emit started(command);
+
+    ExecutionResult result;
+    result.command = command;
+
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+    {
+        emit failed(result, tr("Please select a database first before executing statements."));
+        return;
+    }
+
+    beginRun(true);
+
+    QScopedPointer<QSqlQuery> query;
+    QString shape;
+    if (!run(query, command, shape, values))
+    {
+        reportFailure(query.data(), result);
+        return;
+    }
+
+    result.isSelect = query->isSelect();
+    result.rowsAffected = query->numRowsAffected();
+
+    if (result.isSelect)
+        keepResultSet(query, shape, result, values);
+    else
+    {
+        collectStatistics(*query, result);
+        recycle(query, shape);
+    }
+
+    // the timeout or a cancel request may also hit while the first rows are stepped
+    if (abortReason != AbortReason::NotAborted)
+    {
+        reportFailure(nullptr, result);
+        return;
+    }
+
+    const QString keyword = SqlLexer::firstKeyword(command);
+    if (keyword == "ATTACH" || keyword == "DETACH")
+        syncAttachments();
+
+    result.elapsed = runTimer.elapsed();
+    result.progressSteps = progressSteps;
+    emit statementCacheUpdated(statementCacheHits, statementCacheMisses, statementCache.size());
+    emit finished(result);
+}
+
+/*
+ * Executes a statement once for every row of values, through QSqlQuery::execBatch, so the statement is compiled once and only rebound and stepped
+ * for each row. Unless a transaction is already open, the rows are executed inside one, so that they are written to the document once.
+ */
+void QueryWorker::executeBatch(const QString &statement, const QVector<QVariantList> &rows)
+{
+    const QStringList parameters = SqlLexer::parameters(statement);
+    if (parameters.isEmpty() || rows.size() < 2)
+    {
+        execute(statement, rows.value(0));
+        return;
+    }
+
+    releaseResultSet();
+
+    emit started(statement);
+
+    ExecutionResult result;
+    result.command = statement;
+    result.boundRows = rows.size();
+
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+    {
+        emit failed(result, tr("Please select a database first before executing statements."));
+        return;
+    }
+
+    beginRun(true);
+
+    const QString shape = SqlLexer::normalize(statement);
+    checkSchemaVersion();
+
+    QScopedPointer<QSqlQuery> query(statementCache.take(shape));
+    if (query)
+        ++statementCacheHits;
+    else
+    {
+        ++statementCacheMisses;
+        query.reset(new QSqlQuery(db));
+        query->setForwardOnly(true);
+        if (!query->prepare(shape))
+        {
+            reportFailure(query.data(), result);
+            return;
+        }
+    }
+
+    // execBatch takes the values column by column
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        QVariantList column;
+        column.reserve(rows.size());
+        foreach (const QVariantList& row, rows)
+            column << row.value(i);
+        query->bindValue(i, column);
+    }
+
+    const bool wrap = handle && sqlite3_get_autocommit(handle);
+    if (wrap && !db.transaction())
+    {
+        emit failed(result, db.lastError().text());
+        return;
+    }
+
+    const int changesBefore = handle ? sqlite3_total_changes(handle) : 0;
+    if (!query->execBatch())
+    {
+        reportFailure(query.data(), result);
+        query.reset();
+        if (wrap)
+            db.rollback();
+        return;
+    }
+
+    result.rowsAffected = handle ? sqlite3_total_changes(handle) - changesBefore : query->numRowsAffected();
+    collectStatistics(*query, result);
+    recycle(query, shape);
+
+    if (wrap && !db.commit())
+    {
+        const QString error = db.lastError().text();
+        db.rollback();
+        emit failed(result, error);
+        return;
+    }
+
+    result.elapsed = runTimer.elapsed();
+    result.progressSteps = progressSteps;
+    emit statementCacheUpdated(statementCacheHits, statementCacheMisses, statementCache.size());
+    emit finished(result);
+}
+
+/*
+ * Splits the script into statements and executes them one after the other, optionally inside a single transaction so that thousands of small
+ * statements don't pay for a transaction each. The first statement that fails stops the script, and rolls back the wrapping transaction. If the
+ * last statement is a select, its rows are shown like the ones of a single select statement.
+ */
+void QueryWorker::executeScript(const QString &script, bool useTransaction)
+{
+    const QVector<SqlStatement> statements = SqlLexer::splitStatements(script);
+    if (statements.size() < 2)
+    {
+        execute(statements.isEmpty() ? script : statements.first().text, QVariantList());
+        return;
+    }
+
+    releaseResultSet();
+
+    emit started(script);
+
+    const int count = statements.size();
+    ExecutionResult scriptFailure;
+    scriptFailure.command = script;
+    scriptFailure.statementCount = count;
+    scriptFailure.statementIndex = -1;
+
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+    {
+        emit failed(scriptFailure, tr("Please select a database first before executing statements."));
+        return;
+    }
+
+    // a script that controls transactions by itself cannot be nested into ours, and sqlite refuses to attach or detach inside a transaction
+    bool wrap = useTransaction;
+    bool attaching = false;
+    foreach (const SqlStatement& statement, statements)
+    {
+        if (statement.keyword == "BEGIN" || statement.keyword == "COMMIT" || statement.keyword == "END" || statement.keyword == "ROLLBACK")
+            wrap = false;
+        if (statement.keyword == "ATTACH" || statement.keyword == "DETACH")
+        {
+            wrap = false;
+            attaching = true;
+        }
+    }
+
+    beginRun(true);
+
+    if (wrap && !db.transaction())
+    {
+        emit failed(scriptFailure, db.lastError().text());
+        return;
+    }
+
+    ScriptResult scriptResult;
+    scriptResult.transaction = wrap;
+    scriptResult.statements.reserve(count);
+
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    for (int i = 0; i < count; ++i)
+    {
+        const SqlStatement& statement = statements.at(i);
+
+        ExecutionResult result;
+        result.command = statement.text;
+        result.statementIndex = i;
+        result.statementCount = count;
+        result.line = statement.line;
+
+        const qint64 startedAt = runTimer.elapsed();
+        const qint64 stepsBefore = progressSteps;
+
+        QScopedPointer<QSqlQuery> query;
+        QString shape;
+        if (isInterrupted() || !run(query, statement.text, shape))
+        {
+            reportFailure(query.data(), result);
+            query.reset();
+            if (wrap)
+                db.rollback();
+            return;
+        }
+
+        result.isSelect = query->isSelect();
+        result.rowsAffected = query->numRowsAffected();
+
+        // only the rows of the last statement are shown, the selects before it are executed and dropped
+        if (result.isSelect && i == count - 1)
+            keepResultSet(query, shape, result);
+        else
+        {
+            collectStatistics(*query, result);
+            recycle(query, shape);
+        }
+
+        result.elapsed = runTimer.elapsed() - startedAt;
+        result.progressSteps = progressSteps - stepsBefore;
+        scriptResult.statements << result;
+
+        if (progressTimer.elapsed() >= ScriptProgressInterval)
+        {
+            emit scriptProgress(i + 1, count);
+            progressTimer.restart();
+        }
+    }
+
+    if (abortReason != AbortReason::NotAborted)
+    {
+        ExecutionResult last = scriptResult.statements.last();
+        reportFailure(nullptr, last);
+        releaseResultSet();
+        if (wrap)
+            db.rollback();
+        return;
+    }
+
+    if (wrap && !db.commit())
+    {
+        const QString error = db.lastError().text();
+        releaseResultSet();
+        db.rollback();
+        emit failed(scriptFailure, error);
+        return;
+    }
+
+    if (attaching)
+        syncAttachments();
+
+    scriptResult.elapsed = runTimer.elapsed();
+    emit scriptProgress(count, count);
+    emit statementCacheUpdated(statementCacheHits, statementCacheMisses, statementCache.size());
+    emit scriptFinished(scriptResult);
+}
+
+void QueryWorker::fetchMore()
+{
+    if (!activeQuery)
+        return;
+
+    // the view may ask for more rows long after the statement started, so the timeout does not apply here
+    beginRun(false);
+    fetchRows();
+    emit statisticsUpdated(activeResult);
+}
+
+/*
+ * Reads a page of the result set on screen again, after the view dropped it to stay within its memory budget. A page the view handed over through
+ * storePage() is read back from the spill. Any other page is read by running the statement again, on the connection of its database, skipping
+ * the rows before it; its values are bound ahead of LIMIT and OFFSET. When neither works the view is told the page failed.
+ */
+void QueryWorker::fetchPage(int resultId, int page)
+{
+    if (resultId != resultSource.resultId)
+        return;
+
+    const auto spilled = spilledPages.constFind(page);
+    if (spilled != spilledPages.constEnd() && spill->seek(*spilled))
+    {
+        QDataStream stream(spill.data());
+        ResultPage rows;
+        stream >> rows;
+        if (stream.status() == QDataStream::Ok)
+        {
+            emit pageFetched(resultId, page, rows, false, false);
+            return;
+        }
+    }
+
+    const int columnCount = resultSource.columnCount;
+    ResultPage rows(columnCount);
+    bool ok = canRerun();
+    if (ok)
+    {
+        QSqlQuery query(QSqlDatabase::database(pool.value(resultSource.path).name, false));
+        query.setForwardOnly(true);
+        ok = query.prepare(QString("SELECT * FROM (%1) LIMIT ? OFFSET ?").arg(resultSource.command));
+
+        const int count = resultSource.values.size();
+        for (int i = 0; i < count; ++i)
+            query.bindValue(i, resultSource.values.at(i));
+        query.bindValue(count, int(ResultPage::Rows));
+        query.bindValue(count + 1, qint64(page) * ResultPage::Rows);
+
+        beginRun(false);
+        ok = ok && query.exec();
+
+        QVariantList row;
+        while (ok && query.next())
+        {
+            row.clear();
+            for (int i = 0; i < columnCount; ++i)
+                row << query.value(i);
+            rows.appendRow(row);
+        }
+
+        // next() also stops when the statement was interrupted half way, the page is incomplete then
+        ok = ok && !query.lastError().isValid() && abortReason == AbortReason::NotAborted;
+    }
+
+    emit pageFetched(resultId, page, ok ? rows : ResultPage(columnCount), false, !ok);
+}
+
+/*
+ * Keeps a page the view dropped, appended to the spill file of the result set, so fetchPage() can read it back without running the statement
+ * again. If the file can't be written the pages are read with LIMIT and OFFSET only, and once that isn't possible either the view keeps its pages.
+ */
+void QueryWorker::storePage(int resultId, int page, const ResultPage &rows)
+{
+    if (resultId != resultSource.resultId || spillFailed || spilledPages.contains(page))
+        return;
+
+    if (!spill)
+    {
+        spill.reset(new QTemporaryFile(QDir::temp().filePath("firelite-result-XXXXXX")));
+        spillFailed = !spill->open();
+    }
+
+    const qint64 offset = spill->size();
+    if (!spillFailed && spill->seek(offset))
+    {
+        QDataStream stream(spill.data());
+        stream << rows;
+        spillFailed = stream.status() != QDataStream::Ok;
+    }
+    else
+        spillFailed = true;
+
+    if (!spillFailed)
+        spilledPages.insert(page, offset);
+    else if (!canRerun())
+        emit refetchUnavailable(resultId);
+}
+
+/*
+ * Steps the active cursor for at most a page of rows and hands them to the GUI. The cursor is released as soon as the result set is exhausted, or
+ * when it was interrupted half way.
+ */
+void QueryWorker::fetchRows()
+{
+    ResultPage rows(activeColumnCount);
+    QVariantList row;
+
+    bool atEnd = false;
+    while (rows.rowCount() < ResultPage::Rows)
+    {
+        if (!activeQuery->next())
+        {
+            atEnd = true;
+            break;
+        }
+
+        if (activeResult.firstRowTime < 0)
+            activeResult.firstRowTime = runTimer.elapsed();
+
+        row.clear();
+        for (int i = 0; i < activeColumnCount; ++i)
+            row << activeQuery->value(i);
+        rows.appendRow(row);
+    }
+
+    activeResult.rowsReturned += rows.rowCount();
+    collectStatistics(*activeQuery, activeResult);
+
+    // the columns are still needed to read dropped pages again
+    if (atEnd)
+    {
+        recycle(activeQuery, activeShape);
+        activeShape.clear();
+    }
+
+    emit pageFetched(activeResultId, nextPage++, rows, atEnd, false);
+}
+
+/*
+ * Returns the columns that order the rows of a table for keyset paging: the rowid when the table has one, otherwise the primary key. Views have
+ * neither and get an empty list, they are paged by offset instead.
+ */
+QStringList QueryWorker::keyColumnsFor(const QString &table)
+{
+    auto it = keyColumns.constFind(table);
+    if (it != keyColumns.constEnd())
+        return it.value();
+
+    QSqlDatabase db = database();
+    const QString quoted = SqlLexer::quoteIdentifier(table);
+    QStringList keys;
+
+    QSqlQuery type(db);
+    type.prepare("SELECT type FROM sqlite_master WHERE name = ?");
+    type.addBindValue(table);
+    const bool isView = type.exec() && type.next() && type.value(0).toString() == "view";
+
+    if (!isView)
+    {
+        QSqlQuery probe(db);
+        if (probe.exec(QString("SELECT rowid FROM %1 LIMIT 0").arg(quoted)))
+            keys << "rowid";
+        else
+        {
+            // WITHOUT ROWID tables always have a primary key
+            QMap<int, QString> primaryKey;
+            QSqlQuery info(db);
+            info.exec(QString("PRAGMA table_info(%1)").arg(quoted));
+            while (info.next())
+            {
+                const int position = info.value(5).toInt();
+                if (position > 0)
+                    primaryKey.insert(position, info.value(1).toString());
+            }
+            keys = primaryKey.values();
+        }
+    }
+
+    keyColumns.insert(table, keys);
+    return keys;
+}
+
+/*
+ * Reads a page of a table positioned by the key of its neighbouring rows (keyset pagination). Every page, wherever it is in the table, costs a single
+ * seek into the rowid or primary key b-tree instead of stepping over all the rows before it like OFFSET does. One row more than the page holds is
+ * read to find out whether the table continues in that direction.
+ */
+void QueryWorker::fetchKeysetPage(const KeysetQuery &request)
+{
+    KeysetPage page;
+    page.table = request.table;
+    page.cacheKey = request.cacheKey;
+
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+    {
+        page.error = tr("Please select a database first before executing statements.");
+        emit keysetPageFetched(page);
+        return;
+    }
+
+    beginRun(false);
+
+    const QString table = SqlLexer::quoteIdentifier(request.table);
+    const QStringList keys = keyColumnsFor(request.table);
+    const bool byOffset = keys.isEmpty();
+    page.seekable = byOffset || keys == QStringList("rowid");
+
+    QStringList quotedKeys;
+    foreach (const QString& key, keys)
+        quotedKeys << (key == "rowid" ? key : SqlLexer::quoteIdentifier(key));
+
+    KeysetQuery::Anchor anchor = request.anchor;
+    QVariantList anchorKey = request.key;
+
+    // a relative position becomes a key, min() and max() of the rowid are a single seek at each end of the b-tree
+    if (anchor == KeysetQuery::Fraction && !byOffset)
+    {
+        QSqlQuery range(db);
+        if (range.exec(QString("SELECT min(rowid), max(rowid) FROM %1").arg(table)) && range.next())
+        {
+            const qint64 low = range.value(0).toLongLong();
+            const qint64 high = range.value(1).toLongLong();
+            const double fraction = qBound(0.0, anchorKey.value(0).toDouble(), 1.0);
+            anchorKey = QVariantList() << qint64(low + (high - low) * fraction);
+        }
+        anchor = KeysetQuery::From;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    bool descending = false;
+    qint64 offset = 0;
+
+    if (byOffset)
+    {
+        // views have no key, their pages are read by position
+        auto rowCount = [&]()
+        {
+            QSqlQuery count(db);
+            return count.exec(QString("SELECT count(*) FROM %1").arg(table)) && count.next() ? count.value(0).toLongLong() : 0;
+        };
+
+        const qint64 position = anchorKey.value(0).toLongLong();
+        switch (anchor)
+        {
+        case KeysetQuery::After:    offset = position + 1; break;
+        case KeysetQuery::Before:   offset = position - request.limit; break;
+        case KeysetQuery::From:     offset = position; break;
+        case KeysetQuery::Last:     offset = rowCount() - request.limit; break;
+        case KeysetQuery::Fraction: offset = qint64(rowCount() * qBound(0.0, anchorKey.value(0).toDouble(), 1.0)); break;
+        case KeysetQuery::First:    offset = 0; break;
+        }
+        offset = qMax<qint64>(0, offset);
+
+        query.prepare(QString("SELECT * FROM %1 LIMIT ? OFFSET ?").arg(table));
+        query.addBindValue(request.limit + 1);
+        query.addBindValue(offset);
+    }
+    else
+    {
+        descending = anchor == KeysetQuery::Before || anchor == KeysetQuery::Last;
+
+        QString where;
+        if (anchor == KeysetQuery::After || anchor == KeysetQuery::Before || anchor == KeysetQuery::From)
+        {
+            // row values compare column by column, so a partial key positions on its leading columns
+            const int n = qBound(1, anchorKey.size(), keys.size());
+            const QStringList columns = quotedKeys.mid(0, n);
+            QStringList placeholders;
+            for (int i = 0; i < n; ++i)
+                placeholders << "?";
+
+            const QString op = anchor == KeysetQuery::After ? ">" : anchor == KeysetQuery::Before ? "<" : ">=";
+            where = n > 1 ? QString(" WHERE (%1) %2 (%3)").arg(columns.join(", "), op, placeholders.join(", "))
+                          : QString(" WHERE %1 %2 ?").arg(columns.first(), op);
+        }
+
+        QStringList order;
+        foreach (const QString& key, quotedKeys)
+            order << (descending ? key + " DESC" : key);
+
+        query.prepare(QString("SELECT %1, * FROM %2%3 ORDER BY %4 LIMIT ?").arg(quotedKeys.join(", "), table, where, order.join(", ")));
+        if (!where.isEmpty())
+        {
+            for (int i = 0; i < qBound(1, anchorKey.size(), keys.size()); ++i)
+                query.addBindValue(anchorKey.value(i));
+        }
+        query.addBindValue(request.limit + 1);
+    }
+
+    if (!query.exec())
+    {
+        page.error = query.lastError().text();
+        emit keysetPageFetched(page);
+        return;
+    }
+
+    const int keyCount = keys.size();
+    const QSqlRecord record = query.record();
+    for (int i = keyCount; i < record.count(); ++i)
+        page.columns << record.fieldName(i);
+
+    QVector<QVariantList> rows;
+    bool more = false;
+    while (query.next())
+    {
+        if (rows.size() == request.limit)
+        {
+            more = true;
+            break;
+        }
+
+        QVariantList row;
+        for (int i = 0; i < record.count(); ++i)
+            row << query.value(i);
+        rows << row;
+    }
+
+    if (descending)
+        std::reverse(rows.begin(), rows.end());
+
+    page.rows = ResultPage(page.columns.size());
+    for (int r = 0; r < rows.size(); ++r)
+    {
+        const QVariantList& row = rows.at(r);
+        page.keys << (byOffset ? QVariantList() << qint64(offset + r) : row.mid(0, keyCount));
+        page.rows.appendRow(row.mid(keyCount));
+    }
+
+    switch (anchor)
+    {
+    case KeysetQuery::First:
+        page.atStart = true;
+        page.atEnd = !more;
+        break;
+    case KeysetQuery::Last:
+        page.atStart = !more;
+        page.atEnd = true;
+        break;
+    case KeysetQuery::Before:
+        page.atStart = !more;
+        break;
+    default:
+        page.atStart = byOffset && offset == 0;
+        page.atEnd = !more;
+        break;
+    }
+
+    emit keysetPageFetched(page);
+}
+
+/*
+ * Estimates the rows of a table without counting them: from the statistics ANALYZE stored in sqlite_stat1, or else from the largest rowid, which
+ * is a single seek to the end of the table. Returns -1 for views, subqueries and aliases.
+ */
+qint64 QueryWorker::estimateRows(const QString &table)
+{
+    QSqlDatabase db = database();
+
+    QSqlQuery stat(db);
+    stat.prepare("SELECT stat FROM sqlite_stat1 WHERE tbl = ? LIMIT 1");
+    stat.addBindValue(table);
+    if (stat.exec() && stat.next())
+        return stat.value(0).toString().section(QLatin1Char(' '), 0, 0).toLongLong();
+
+    QSqlQuery rowid(db);
+    if (rowid.exec(QString("SELECT max(rowid) FROM %1").arg(SqlLexer::quoteIdentifier(table))) && rowid.next() && !rowid.value(0).isNull())
+        return rowid.value(0).toLongLong();
+
+    return -1;
+}
+
+/*
+ * Computes the plan of a statement with EXPLAIN QUERY PLAN, without running it, and points out the steps that usually mean an index is missing:
+ * scans of large tables, temporary b-trees built to sort or group rows, and automatic indexes that sqlite builds again on every execution.
+ * With bytecode, the virtual machine program of the statement is added too.
+ */
+void QueryWorker::explain(const QString &statement, bool bytecode)
+{
+    QueryPlan plan;
+    plan.statement = statement;
+
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+    {
+        plan.error = tr("Please select a database first before executing statements.");
+        emit planReady(plan);
+        return;
+    }
+
+    beginRun(false);
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("EXPLAIN QUERY PLAN " + statement))
+    {
+        plan.error = query.lastError().text();
+        emit planReady(plan);
+        return;
+    }
+
+    // before 3.24 the plan is flat, its first column is the number of the select instead of the id of the step
+    const bool isTree = query.record().fieldName(0) == "id";
+    while (query.next())
+    {
+        QueryPlanNode node;
+        node.id = isTree ? query.value(0).toInt() : plan.nodes.size() + 1;
+        node.parent = isTree ? query.value(1).toInt() : 0;
+        node.detail = query.value(3).toString();
+        plan.nodes << node;
+    }
+    query.finish();
+
+    QHash<QString, qint64> tableRows;
+    for (QueryPlanNode& node : plan.nodes)
+    {
+        const QString& detail = node.detail;
+
+        if (detail.startsWith("SCAN "))
+        {
+            // SCAN t, SCAN TABLE t before 3.36, possibly followed by USING [COVERING] INDEX i
+            QStringList words = detail.split(QLatin1Char(' '), QString::SkipEmptyParts);
+            words.removeFirst();
+            if (!words.isEmpty() && words.first() == "TABLE")
+                words.removeFirst();
+            if (words.isEmpty() || words.first() == "CONSTANT" || words.first() == "SUBQUERY" || words.first().startsWith(QLatin1Char('(')))
+                continue;
+
+            const QString table = words.first();
+            if (!tableRows.contains(table))
+                tableRows.insert(table, estimateRows(table));
+            node.estimatedRows = tableRows.value(table);
+
+            const bool coveringIndex = detail.contains("COVERING INDEX");
+            if (node.estimatedRows >= LargeTableRows)
+            {
+                node.hotSpot = true;
+                node.hint = coveringIndex ? tr("Reads the whole index of %1 rows, an index on the columns of the WHERE clause would seek instead").arg(node.estimatedRows)
+                                          : tr("Reads all %1 rows of the table, an index on the columns of the WHERE clause or the join would seek instead").arg(node.estimatedRows);
+            }
+            else
+                node.hint = tr("Reads every row of the table");
+        }
+        else if (detail.startsWith("USE TEMP B-TREE"))
+        {
+            node.hotSpot = true;
+            node.hint = tr("Sorts the rows in a temporary b-tree, an index on the %1 columns would deliver them in order")
+                    .arg(detail.mid(detail.indexOf("FOR ") + 4));
+        }
+        else if (detail.contains("AUTOMATIC"))
+        {
+            node.hotSpot = true;
+            node.hint = tr("Builds a temporary index on every execution, it is worth creating it for good");
+        }
+    }
+
+    if (bytecode)
+    {
+        QSqlQuery program(db);
+        program.setForwardOnly(true);
+        if (program.exec("EXPLAIN " + statement))
+        {
+            const QSqlRecord record = program.record();
+            for (int i = 0; i < record.count(); ++i)
+                plan.bytecodeColumns << record.fieldName(i);
+
+            while (program.next())
+            {
+                QVariantList row;
+                for (int i = 0; i < record.count(); ++i)
+                    row << program.value(i);
+                plan.bytecode << row;
+            }
+        }
+    }
+
+    emit planReady(plan);
+}
+
+/*
+ * Executes a statement straight on the native connection, for the transaction and pragma statements of an import which don't need a QSqlQuery.
+ */
+bool QueryWorker::execNative(const char *sql, QString *error)
+{
+    char* message = nullptr;
+    if (sqlite3_exec(handle, sql, nullptr, nullptr, &message) == SQLITE_OK)
+        return true;
+
+    if (error)
+        *error = QString::fromUtf8(message);
+    sqlite3_free(message);
+    return false;
+}
+
+/*
+ * Loads a CSV file into a table, creating the table first if it doesn't exist. The file is memory mapped and parsed in place, and unquoted fields
+ * are bound straight out of the mapping to a single prepared insert, so a record costs no allocation at all. The records are committed in batches
+ * of batchSize, a failure or a cancel request rolls back the current batch only.
+ */
+void QueryWorker::importCsv(const CsvImport &request)
+{
+    releaseResultSet();
+
+    CsvImportResult result;
+    result.fileName = request.fileName;
+    result.table = request.table;
+
+    QSqlDatabase db = database();
+    if (!db.isOpen() || !handle)
+    {
+        result.error = tr("Please select a database first before importing files.");
+        emit importFinished(result);
+        return;
+    }
+
+    QFile file(request.fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        result.error = file.errorString();
+        emit importFinished(result);
+        return;
+    }
+
+    const qint64 size = file.size();
+    result.bytes = size;
+    uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (size > 0 && !mapped)
+    {
+        result.error = tr("The file could not be mapped into memory: %1").arg(file.errorString());
+        emit importFinished(result);
+        return;
+    }
+
+#ifdef Q_OS_UNIX
+    // the file is read once from front to back, the kernel may read ahead aggressively and drop the pages behind
+    if (mapped)
+        posix_madvise(mapped, size_t(size), POSIX_MADV_SEQUENTIAL);
+#endif
+
+    beginRun(false);
+
+    // table
+    QStringList definitions, names, placeholders;
+    for (int i = 0; i < request.columns.size(); ++i)
+    {
+        const QString name = SqlLexer::quoteIdentifier(request.columns.at(i));
+        definitions << QString("%1 %2").arg(name, request.types.value(i, "TEXT"));
+        names << name;
+        placeholders << "?";
+    }
+
+    const QString table = SqlLexer::quoteIdentifier(request.table);
+    QString error;
+    if (!execNative(QString("CREATE TABLE IF NOT EXISTS %1 (%2)").arg(table, definitions.join(", ")).toUtf8().constData(), &error))
+    {
+        result.error = error;
+        file.unmap(mapped);
+        emit importFinished(result);
+        return;
+    }
+
+    sqlite3_stmt* insert = nullptr;
+    const QByteArray insertSql = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(table, names.join(", "), placeholders.join(", ")).toUtf8();
+    if (sqlite3_prepare_v2(handle, insertSql.constData(), -1, &insert, nullptr) != SQLITE_OK)
+    {
+        result.error = QString::fromUtf8(sqlite3_errmsg(handle));
+        file.unmap(mapped);
+        emit importFinished(result);
+        return;
+    }
+
+    // durability only matters for the data that was there before, a crash in the middle leaves a half imported table either way
+    QByteArray previousSynchronous, previousJournalMode;
+    if (request.relaxDurability)
+    {
+        QSqlQuery pragma(db);
+        if (pragma.exec("PRAGMA synchronous") && pragma.next())
+            previousSynchronous = pragma.value(0).toString().toUtf8();
+        if (pragma.exec("PRAGMA journal_mode") && pragma.next())
+            previousJournalMode = pragma.value(0).toString().toUtf8();
+        pragma.finish();
+
+        execNative("PRAGMA synchronous = OFF");
+        execNative("PRAGMA journal_mode = MEMORY");
+    }
+
+    const char* data = reinterpret_cast<const char*>(mapped);
+    CsvReader reader(data, size, request.separator);
+    QVector<QByteArray> fields;
+    qint64 records = 0;
+    if (request.hasHeader && reader.readFields(fields))
+        ++records;
+
+    const int columns = request.columns.size();
+    const int batchSize = qMax(1, request.batchSize);
+    qint64 rows = 0;
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    execNative("BEGIN");
+    while (reader.readFields(fields))
+    {
+        ++records;
+
+        // blank lines, usually the one at the end of the file
+        if (fields.size() == 1 && fields.first().isEmpty())
+            continue;
+
+        for (int i = 0; i < columns; ++i)
+        {
+            if (i < fields.size() && !(request.emptyAsNull && fields.at(i).isEmpty()))
+                sqlite3_bind_text(insert, i + 1, fields.at(i).constData(), fields.at(i).size(), SQLITE_STATIC);
+            else
+                sqlite3_bind_null(insert, i + 1);
+        }
+
+        const int rc = sqlite3_step(insert);
+        if (rc != SQLITE_DONE)
+        {
+            if (cancelRequested.load())
+                result.cancelled = true;
+            else
+                result.error = tr("Record %1: %2").arg(records).arg(QString::fromUtf8(sqlite3_errmsg(handle)));
+            sqlite3_reset(insert);
+            break;
+        }
+        sqlite3_reset(insert);
+        ++rows;
+
+        if (rows % batchSize == 0)
+        {
+            if (!execNative("COMMIT", &error))
+            {
+                result.error = error;
+                break;
+            }
+            result.rows = rows;
+            execNative("BEGIN");
+        }
+
+        if (rows % ImportCheckInterval == 0)
+        {
+            if (cancelRequested.load())
+            {
+                result.cancelled = true;
+                break;
+            }
+
+            if (progressTimer.elapsed() >= ImportProgressInterval)
+            {
+                emit importProgress(rows, reader.position(), size);
+                progressTimer.restart();
+            }
+        }
+    }
+
+    sqlite3_finalize(insert);
+
+    if (result.cancelled || !result.error.isEmpty())
+        execNative("ROLLBACK");
+    else if (execNative("COMMIT", &error))
+        result.rows = rows;
+    else
+    {
+        result.error = error;
+        execNative("ROLLBACK");
+    }
+
+    if (request.relaxDurability)
+    {
+        if (!previousJournalMode.isEmpty())
+            execNative(("PRAGMA journal_mode = " + previousJournalMode).constData());
+        if (!previousSynchronous.isEmpty())
+            execNative(("PRAGMA synchronous = " + previousSynchronous).constData());
+    }
+
+    file.unmap(mapped);
+
+    result.elapsed = runTimer.elapsed();
+    emit importProgress(result.rows, size, size);
+    emit importFinished(result);
+}
+
+/*
+ * Executes a select statement again and streams its rows into a file, without a QSqlQuery or a page in between: every row goes from the
+ * statement straight into the buffer of the writer. Memory use stays the same whatever the number of rows, and a cancel request stops the
+ * statement and removes the half written file.
+ */
+void QueryWorker::exportResult(const ResultExport &request)
+{
+    releaseResultSet();
+
+    ResultExportResult result;
+    result.fileName = request.fileName;
+
+    if (!database().isOpen() || !handle)
+    {
+        result.error = tr("Please select a database first before exporting results.");
+        emit exportFinished(result);
+        return;
+    }
+
+    beginRun(false);
+
+    sqlite3_stmt* statement = nullptr;
+    const QByteArray sql = request.statement.toUtf8();
+    if (sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &statement, nullptr) != SQLITE_OK)
+    {
+        result.error = QString::fromUtf8(sqlite3_errmsg(handle));
+        emit exportFinished(result);
+        return;
+    }
+
+    if (sqlite3_column_count(statement) == 0)
+    {
+        sqlite3_finalize(statement);
+        result.error = tr("The statement doesn't return rows.");
+        emit exportFinished(result);
+        return;
+    }
+
+    // the statement runs again, so one that writes, such as a DELETE with RETURNING or a pragma that changes a setting, would write twice
+    if (!sqlite3_stmt_readonly(statement))
+    {
+        sqlite3_finalize(statement);
+        result.error = tr("The statement changes the database, only statements that read can be exported.");
+        emit exportFinished(result);
+        return;
+    }
+
+    // values of the parameter panel, bound as text like everywhere else
+    for (int i = 0; i < request.values.size(); ++i)
+    {
+        const QVariant& value = request.values.at(i);
+        if (value.isNull())
+            sqlite3_bind_null(statement, i + 1);
+        else
+        {
+            const QByteArray text = value.toString().toUtf8();
+            sqlite3_bind_text(statement, i + 1, text.constData(), text.size(), SQLITE_TRANSIENT);
+        }
+    }
+
+    ResultWriter writer(request.format, request.fileName, request.gzip);
+    bool ok = writer.open() && writer.writeHeader(statement, request.table);
+
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(statement)) == SQLITE_ROW)
+    {
+        ok = writer.writeRow(statement);
+        ++result.rows;
+
+        if (result.rows % ImportCheckInterval == 0 && progressTimer.elapsed() >= ImportProgressInterval)
+        {
+            emit exportProgress(result.rows, writer.bytesWritten());
+            progressTimer.restart();
+        }
+    }
+
+    if (!ok)
+        result.error = writer.errorString();
+    else if (rc != SQLITE_DONE)
+    {
+        if (cancelRequested.load())
+            result.cancelled = true;
+        else
+            result.error = QString::fromUtf8(sqlite3_errmsg(handle));
+    }
+    sqlite3_finalize(statement);
+
+    if (result.error.isEmpty() && !result.cancelled && !writer.finish())
+        result.error = writer.errorString();
+
+    if (result.cancelled || !result.error.isEmpty())
+        writer.discard();
+    else
+        result.bytes = writer.bytesWritten();
+
+    result.elapsed = runTimer.elapsed();
+    emit exportFinished(result);
+}
+
+/*
+ * Drives a sqlite3_backup from source to destination a few pages at a time. Between two steps the worker sleeps for a moment, so writers on other
+ * connections get the lock; when they change the source, sqlite restarts the copy by itself. Busy and locked steps are retried after the same
+ * pause. Returns false if the copy failed or was cancelled.
+ */
+bool QueryWorker::copyDatabase(sqlite3 *source, sqlite3 *destination, const DatabaseBackup &request, bool reportProgress, BackupResult &result)
+{
+    sqlite3_backup* backup = sqlite3_backup_init(destination, "main", source, "main");
+    if (!backup)
+    {
+        result.error = QString::fromUtf8(sqlite3_errmsg(destination));
+        return false;
+    }
+
+    // a negative number of pages copies the whole database in one step
+    const int pagesPerStep = request.pagesPerStep < 0 ? -1 : qMax(1, request.pagesPerStep);
+    int rc = SQLITE_OK;
+    while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+    {
+        if (cancelRequested.load())
+        {
+            result.cancelled = true;
+            break;
+        }
+
+        rc = sqlite3_backup_step(backup, pagesPerStep);
+        if (reportProgress)
+            emit backupProgress(sqlite3_backup_remaining(backup), sqlite3_backup_pagecount(backup));
+
+        if (rc != SQLITE_DONE && request.pauseMsecs > 0)
+            QThread::msleep(ulong(request.pauseMsecs));
+    }
+
+    result.pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+
+    if (!result.cancelled && rc != SQLITE_DONE)
+        result.error = QString::fromUtf8(sqlite3_errstr(rc));
+
+    return !result.cancelled && rc == SQLITE_DONE;
+}
+
+/*
+ * Copies the open database into a new file with the online backup API, page by page, while the database stays in use: the copy is consistent
+ * even if other connections write to it meanwhile. Through memory, the database is first copied into an in-memory database, which is fast enough
+ * that writers hardly get the chance to restart it, and the file is written from that snapshot afterwards.
+ */
+void QueryWorker::backup(const DatabaseBackup &request)
+{
+    releaseResultSet();
+
+    BackupResult result;
+    result.target = request.target;
+
+    if (!database().isOpen() || !handle)
+    {
+        result.error = tr("Please select a database first before backing it up.");
+        emit backupFinished(result);
+        return;
+    }
+
+    beginRun(false);
+
+    sqlite3* snapshot = nullptr;
+    sqlite3* source = handle;
+    if (request.throughMemory)
+    {
+        if (sqlite3_open(":memory:", &snapshot) != SQLITE_OK)
+        {
+            result.error = QString::fromUtf8(sqlite3_errmsg(snapshot));
+            sqlite3_close(snapshot);
+            emit backupFinished(result);
+            return;
+        }
+
+        // one large step, the source is only read while the pages are copied into memory
+        DatabaseBackup inMemory = request;
+        inMemory.pagesPerStep = -1;
+        if (!copyDatabase(handle, snapshot, inMemory, false, result))
+        {
+            sqlite3_close(snapshot);
+            emit backupFinished(result);
+            return;
+        }
+        source = snapshot;
+    }
+
+    sqlite3* destination = nullptr;
+    bool ok = sqlite3_open_v2(QFile::encodeName(request.target).constData(), &destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) == SQLITE_OK;
+    if (!ok)
+        result.error = QString::fromUtf8(sqlite3_errmsg(destination));
+    else
+        ok = copyDatabase(source, destination, request, true, result);
+
+    sqlite3_close(destination);
+    sqlite3_close(snapshot);
+
+    if (!ok)
+        QFile::remove(request.target);
+
+    result.elapsed = runTimer.elapsed();
+    emit backupFinished(result);
+}
+
+/*
+ * Writes the open database as a script of SQL statements, see Dumper.
+ */
+void QueryWorker::dump(const DatabaseDump &request)
+{
+    releaseResultSet();
+
+    DumpResult result;
+    result.target = request.target;
+
+    if (!database().isOpen() || !handle || databasePath.isEmpty())
+    {
+        result.error = tr("Please select a database first before dumping it.");
+        emit dumpFinished(result);
+        return;
+    }
+
+    beginRun(false);
+
+    Dumper dumper(handle, databasePath, cancelRequested);
+    dumper.dump(request, result, [this](int tablesDone, int tableCount, qint64 rows)
+    {
+        emit dumpProgress(tablesDone, tableCount, rows);
+    });
+
+    result.elapsed = runTimer.elapsed();
+    emit dumpFinished(result);
+}
+
+/*
+ * Executes a script from a file without reading it as a whole: SqlScriptReader splits it a chunk at a time and every statement runs as soon as it
+ * is complete, so memory stays flat whatever the size of the file. Unless the request keeps the transactions of the script, they are replaced by
+ * batches of statementsPerTransaction, and statements that can't run inside a transaction (pragmas, VACUUM, ATTACH, DETACH) run between two
+ * batches. The first statement that fails stops the script and rolls back the current batch.
+ */
+void QueryWorker::runScriptFile(const ScriptFileRun &request)
+{
+    releaseResultSet();
+
+    ScriptFileResult result;
+    result.fileName = request.fileName;
+
+    if (!database().isOpen() || !handle)
+    {
+        result.error = tr("Please select a database first before running a script against it.");
+        emit scriptFileFinished(result);
+        return;
+    }
+
+    QFile file(request.fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        result.error = file.errorString();
+        emit scriptFileFinished(result);
+        return;
+    }
+
+    beginRun(false);
+
+    const qint64 size = file.size();
+    const bool batched = request.statementsPerTransaction > 0;
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    SqlScriptReader reader(&file);
+    SqlStatement statement;
+    bool inTransaction = false;
+    int batchStatements = 0;
+    QString error;
+
+    while (reader.next(statement))
+    {
+        if (batched)
+        {
+            if (statement.keyword == "BEGIN" || statement.keyword == "COMMIT" || statement.keyword == "END" || statement.keyword == "ROLLBACK")
+                continue;
+
+            const bool outside = statement.keyword == "PRAGMA" || statement.keyword == "VACUUM" || statement.keyword == "ATTACH"
+                    || statement.keyword == "DETACH";
+            if (outside && inTransaction)
+            {
+                if (!execNative("COMMIT", &error))
+                    break;
+                inTransaction = false;
+            }
+            else if (!outside && !inTransaction)
+            {
+                if (!execNative("BEGIN", &error))
+                    break;
+                inTransaction = true;
+                batchStatements = 0;
+            }
+        }
+
+        const QByteArray sql = statement.text.toUtf8();
+        sqlite3_stmt* prepared = nullptr;
+        if (sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &prepared, nullptr) != SQLITE_OK)
+        {
+            error = QString::fromUtf8(sqlite3_errmsg(handle));
+            break;
+        }
+
+        int rc = SQLITE_DONE;
+        if (prepared)
+        {
+            while ((rc = sqlite3_step(prepared)) == SQLITE_ROW)
+                ;
+            sqlite3_finalize(prepared);
+        }
+        if (rc != SQLITE_DONE)
+        {
+            error = QString::fromUtf8(sqlite3_errmsg(handle));
+            break;
+        }
+
+        ++result.statements;
+        if (inTransaction && ++batchStatements >= request.statementsPerTransaction)
+        {
+            if (!execNative("COMMIT", &error))
+                break;
+            inTransaction = false;
+        }
+
+        if (cancelRequested.load())
+            break;
+
+        if (progressTimer.elapsed() >= ImportProgressInterval)
+        {
+            emit scriptFileProgress(result.statements, reader.bytesRead(), size);
+            progressTimer.restart();
+        }
+    }
+
+    result.cancelled = cancelRequested.load();
+    if (!result.cancelled && !error.isEmpty())
+    {
+        result.error = error;
+        result.line = statement.line;
+    }
+
+    if (inTransaction)
+    {
+        if (result.cancelled || !result.error.isEmpty())
+            execNative("ROLLBACK");
+        else if (!execNative("COMMIT", &error))
+            result.error = error;
+    }
+
+    // a script that keeps its own transactions may stop inside one of them, or leave one open
+    if (!batched && !sqlite3_get_autocommit(handle))
+    {
+        if (result.cancelled || !result.error.isEmpty())
+            execNative("ROLLBACK");
+        else if (!execNative("COMMIT", &error))
+            result.error = error;
+    }
+
+    result.bytes = reader.bytesRead();
+    result.elapsed = runTimer.elapsed();
+    emit scriptFileProgress(result.statements, result.bytes, size);
+    emit scriptFileFinished(result);
+}
+
+/*
+ * Reports the changes of the schema since the last call, for the completion of the editor and the explorar. It is cheap when nothing changed:
+ * the schema version is compared first, and only when it moved is sqlite_master read again. Then only the objects whose definition changed have
+ * their columns read, so a schema of thousands of tables is loaded once and kept up to date after every DDL statement.
+ *
+ * The schema of a database that was closed is kept. When the database is opened again its first report, which holds every object, comes from
+ * that copy if the schema version is still the same, and otherwise only the objects that changed meanwhile have their columns read again.
+ */
+void QueryWorker::refreshSchema()
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+        return;
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("PRAGMA schema_version") || !query.next())
+        return;
+
+    const int version = query.value(0).toInt();
+    query.finish();
+    if (schemaReported && version == knownSchema.version)
+        return;
+
+    SchemaDelta delta;
+    delta.path = databasePath;
+    delta.reset = !schemaReported;
+
+    if (delta.reset)
+    {
+        knownSchema = schemaCache.take(databasePath);
+        if (knownSchema.version == version)
+        {
+            delta.changed.reserve(knownSchema.objects.size());
+            foreach (const SchemaObject& object, knownSchema.objects)
+                delta.changed << object;
+            delta.functions = knownSchema.functions;
+            schemaReported = true;
+            emit schemaUpdated(delta);
+            return;
+        }
+    }
+
+    if (!query.exec("SELECT type, name, tbl_name, sql FROM sqlite_master WHERE substr(name, 1, 7) <> 'sqlite_'"))
+        return;
+
+    KnownSchema schema;
+    schema.version = version;
+    schema.functions = knownSchema.functions;
+
+    // objects whose definition changed, their columns are read once the catalog is
+    QVector<SchemaObject> changed;
+    while (query.next())
+    {
+        SchemaObject object;
+        object.type = query.value(0).toString();
+        object.name = query.value(1).toString();
+        object.table = query.value(2).toString();
+
+        const QString definition = object.type + QLatin1Char(' ') + query.value(3).toString();
+        schema.definitions.insert(object.name, definition);
+
+        const auto known = knownSchema.objects.constFind(object.name);
+        if (known != knownSchema.objects.constEnd() && knownSchema.definitions.value(object.name) == definition)
+        {
+            schema.objects.insert(object.name, *known);
+            if (delta.reset)
+                delta.changed << *known;
+        }
+        else
+        {
+            changed << object;
+        }
+    }
+    query.finish();
+
+    foreach (const QString& name, knownSchema.definitions.keys())
+    {
+        if (!schema.definitions.contains(name))
+            delta.removed << name;
+    }
+
+    QSqlQuery columns(db);
+    columns.setForwardOnly(true);
+    for (SchemaObject& object : changed)
+    {
+        if (object.type == "table" || object.type == "view")
+        {
+            if (columns.exec(QString("PRAGMA table_info(%1)").arg(SqlLexer::quoteIdentifier(object.name))))
+            {
+                while (columns.next())
+                    object.columns << columns.value(1).toString();
+            }
+            columns.finish();
+        }
+
+        schema.objects.insert(object.name, object);
+        delta.changed << object;
+    }
+
+    // the function list is there since sqlite 3.30, older versions complete the built in names of the word list only
+    if (delta.reset && schema.functions.isEmpty() && query.exec("SELECT DISTINCT name FROM pragma_function_list"))
+    {
+        while (query.next())
+            schema.functions << query.value(0).toString();
+    }
+    if (delta.reset)
+        delta.functions = schema.functions;
+
+    knownSchema = schema;
+    schemaReported = true;
+
+    if (!delta.isEmpty())
+        emit schemaUpdated(delta);
+}
+
+/*
+ * Notices the commits of other connections, such as those of another process writing to the same file. PRAGMA data_version only moves when
+ * another connection changed the database, so it is cheap enough to be polled, and the statements of this connection don't trigger it. When it
+ * moved, the key columns are looked up again and the schema is checked, which reads the catalog only if the schema version moved too.
+ */
+void QueryWorker::checkForChanges()
+{
+    QSqlDatabase db = database();
+    if (!db.isOpen())
+        return;
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("PRAGMA data_version") || !query.next())
+        return;
+
+    const qint64 version = query.value(0).toLongLong();
+    query.finish();
+
+    const bool changed = dataVersion >= 0 && version != dataVersion;
+    dataVersion = version;
+    if (!changed)
+        return;
+
+    keyColumns.clear();
+    emit databaseChanged(databasePath);
+    refreshSchema();
+}
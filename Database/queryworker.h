@@ -0,0 +1,235 @@
+#ifndef QUERYWORKER_H
+#define QUERYWORKER_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QSqlDatabase>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QHash>
+#include <QCache>
+
+#include "Database/queryresult.h"
+#include "Database/resultpage.h"
+#include "Database/keyset.h"
+#include "Database/queryplan.h"
+#include "Database/csvimport.h"
+#include "Database/resultexport.h"
+#include "Database/backup.h"
+#include "Database/dump.h"
+#include "Database/scriptfile.h"
+#include "Database/schemainfo.h"
+#include "Database/connectionprofile.h"
+
+QT_BEGIN_NAMESPACE
+class QSqlQuery;
+class QTemporaryFile;
+QT_END_NAMESPACE
+
+struct sqlite3;
+
+/*
+ * Owns private sqlite connections and executes statements against the active one. The worker is moved into the thread of a QueryEngine, so every
+ * slot runs away from the GUI thread and the results are handed back through queued signals. The connections are created lazily by open() in the
+ * worker thread, since a QSqlDatabase may only be used from the thread that created it, and kept open per database up to the size of the pool.
+ */
+class QueryWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QueryWorker(QObject* parent = nullptr);
+    ~QueryWorker();
+
+    // thread safe, these are called directly from the GUI thread
+    void cancel();
+    void setTimeout(int msecs);
+    void setPoolSize(int connections);
+    int poolSize() const;
+
+public slots:
+    void open(const QString& path);
+    void close();
+    void closeDatabase(const QString& path);
+    void setConnectionProfile(const QString& path, const ConnectionProfile& profile);
+    void attach(const QString& path, const QString& schema);
+    void detach(const QString& schema);
+    void execute(const QString& command, const QVariantList& values = QVariantList());
+    void executeBatch(const QString& statement, const QVector<QVariantList>& rows);
+    void executeScript(const QString& script, bool useTransaction);
+    void fetchMore();
+    void fetchPage(int resultId, int page);
+    void storePage(int resultId, int page, const ResultPage& rows);
+    void fetchKeysetPage(const KeysetQuery& request);
+    void explain(const QString& statement, bool bytecode);
+    void importCsv(const CsvImport& request);
+    void exportResult(const ResultExport& request);
+    void backup(const DatabaseBackup& request);
+    void dump(const DatabaseDump& request);
+    void runScriptFile(const ScriptFileRun& request);
+    void refreshSchema();
+    void checkForChanges();
+
+signals:
+    void opened(const QString& path, bool ok, const QString& error);
+    void started(const QString& command);
+    void columnsReady(int resultId, const QStringList& columns, bool refetchable);
+    void pageFetched(int resultId, int page, const ResultPage& rows, bool atEnd, bool failed);
+    void refetchUnavailable(int resultId);
+    void finished(const ExecutionResult& result);
+    void failed(const ExecutionResult& result, const QString& error);
+    void aborted(const ExecutionResult& result);
+    void scriptProgress(int executed, int count);
+    void scriptFinished(const ScriptResult& result);
+    void keysetPageFetched(const KeysetPage& page);
+    void planReady(const QueryPlan& plan);
+    void importProgress(qint64 rows, qint64 bytesRead, qint64 totalBytes);
+    void importFinished(const CsvImportResult& result);
+    void exportProgress(qint64 rows, qint64 bytes);
+    void exportFinished(const ResultExportResult& result);
+    void backupProgress(int remaining, int pageCount);
+    void backupFinished(const BackupResult& result);
+    void dumpProgress(int tablesDone, int tableCount, qint64 rows);
+    void dumpFinished(const DumpResult& result);
+    void scriptFileProgress(qint64 statements, qint64 bytesRead, qint64 totalBytes);
+    void scriptFileFinished(const ScriptFileResult& result);
+    void schemaUpdated(const SchemaDelta& delta);
+
+    // the databases attached to a database, the file of each by its schema name
+    void attachmentsChanged(const QString& path, const QVariantMap& databases);
+    void attachFailed(const QString& schema, const QString& error);
+
+    // another connection, possibly of another process, committed changes to the database
+    void databaseChanged(const QString& path);
+
+    // the statistics of the active result set changed, because more of its rows were fetched
+    void statisticsUpdated(const ExecutionResult& result);
+
+    // lookups in the prepared statement cache so far, and the number of statements it holds
+    void statementCacheUpdated(qint64 hits, qint64 misses, int size);
+
+private:
+    // name of the connection of the active database, and the prefix of the names of the pooled ones
+    QString connectionName;
+    QString connectionPrefix;
+    QString databasePath;
+
+    // connections kept open by path, the active one included, so that switching back to a database keeps its page cache warm. When there are
+    // more than poolSize, the least recently used one is closed.
+    struct PooledConnection
+    {
+        QString name;
+        sqlite3* handle = nullptr;
+        qint64 dataVersion = -1;
+        quint64 lastUsed = 0;
+    };
+    QHash<QString, PooledConnection> pool;
+    QAtomicInt maxPoolSize;
+    quint64 poolClock = 0;
+    int connectionCount = 0;
+
+    void deactivate();
+    void closeConnection(const QString& path);
+    void trimPool();
+
+    // pragma settings by database path, applied whenever a connection to the database is opened
+    QHash<QString, ConnectionProfile> profiles;
+    void applyProfile(sqlite3* connection, const ConnectionProfile& profile, bool created);
+
+    // databases attached to each database by path, attached again whenever the connection of the database is reopened
+    QHash<QString, QVariantMap> attachments;
+    void syncAttachments();
+
+    // the last select statement, kept open so that rows can be fetched on demand
+    QScopedPointer<QSqlQuery> activeQuery;
+    int activeColumnCount = 0;
+    int activeResultId = 0;
+    int nextPage = 0;
+
+    // statistics of the active result set, completed while its rows are fetched
+    ExecutionResult activeResult;
+
+    // key of the active statement in the prepared statement cache, empty if it does not go back to the cache
+    QString activeShape;
+
+    // the result set on screen, whose dropped pages the view may ask for again. It outlives the cursor, which every statement that needs the
+    // connection releases while the rows stay on screen. Dropped pages are spilled to a temporary file so reading one again is a seek wherever
+    // it is; a page that isn't there is read by running the statement again with its values, LIMIT and OFFSET, which works for plain selects only
+    struct ResultSource
+    {
+        int resultId = -1;
+        QString path;
+        QString command;
+        QVariantList values;
+        int columnCount = 0;
+    };
+    ResultSource resultSource;
+    QScopedPointer<QTemporaryFile> spill;
+    QHash<int, qint64> spilledPages;
+    bool spillFailed = false;
+    bool canRerun() const;
+
+    // native connection, guarded because cancel() interrupts it from the GUI thread
+    QMutex handleMutex;
+    sqlite3* handle = nullptr;
+
+    // cancellation and timeout state, checked by the progress handler
+    QAtomicInt cancelRequested;
+    QAtomicInt timeout;
+    QElapsedTimer runTimer;
+    bool timeoutEnabled = false;
+    qint64 progressSteps = 0;
+    AbortReason abortReason = AbortReason::NotAborted;
+
+    static int progressCallback(void* context);
+    void beginRun(bool withTimeout);
+    bool isInterrupted();
+    void reportFailure(QSqlQuery* query, ExecutionResult& result);
+    void keepResultSet(QScopedPointer<QSqlQuery>& query, const QString& shape, ExecutionResult& result, const QVariantList& values = QVariantList());
+    void resetCacheCounters();
+    void collectStatistics(const QSqlQuery& query, ExecutionResult& result);
+
+    // key columns of the tables browsed with fetchKeysetPage, empty for views which are paged by offset
+    QHash<QString, QStringList> keyColumns;
+    QStringList keyColumnsFor(const QString& table);
+
+    // prepared statements by their normalized SQL, the least recently used ones are finalized first
+    QCache<QString, QSqlQuery> statementCache;
+    QScopedPointer<QSqlQuery> schemaVersionQuery;
+    int schemaVersion = -1;
+    qint64 statementCacheHits = 0;
+    qint64 statementCacheMisses = 0;
+
+    bool run(QScopedPointer<QSqlQuery>& query, const QString& command, QString& shape, const QVariantList& values = QVariantList());
+    void recycle(QScopedPointer<QSqlQuery>& query, const QString& shape);
+    void checkSchemaVersion();
+    void clearStatementCache();
+
+    // the schema as last reported by refreshSchema: the definition and the columns of every object, and the schema version they were read at
+    struct KnownSchema
+    {
+        int version = -1;
+        QHash<QString, QString> definitions;
+        QHash<QString, SchemaObject> objects;
+        QStringList functions;
+    };
+    KnownSchema knownSchema;
+    bool schemaReported = false;
+
+    // schemas of the databases opened before, by path, so that reopening one whose schema version didn't move reads no catalog at all
+    QHash<QString, KnownSchema> schemaCache;
+
+    // data version of the connection, it moves when another connection commits to the database
+    qint64 dataVersion = -1;
+
+    qint64 estimateRows(const QString& table);
+    bool execNative(const char* sql, QString* error = nullptr);
+    bool copyDatabase(sqlite3* source, sqlite3* destination, const DatabaseBackup& request, bool reportProgress, BackupResult& result);
+
+    QSqlDatabase database() const;
+    void fetchRows();
+    void releaseResultSet();
+};
+
+#endif // QUERYWORKER_H
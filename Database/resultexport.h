@@ -0,0 +1,49 @@
+#ifndef RESULTEXPORT_H
+#define RESULTEXPORT_H
+
+#include <QString>
+#include <QVariant>
+#include <QMetaType>
+
+enum class ExportFormat
+{
+    Csv,
+    Tsv,
+    JsonLines,
+    SqlInsert
+};
+
+// Request to write the rows of a select statement into a file
+struct ResultExport
+{
+    QString statement;
+    QVariantList values;
+
+    QString fileName;
+    ExportFormat format = ExportFormat::Csv;
+    bool gzip = false;
+
+    // table named by the INSERT statements of the SqlInsert format
+    QString table;
+};
+
+// Outcome of QueryWorker::exportResult
+struct ResultExportResult
+{
+    QString fileName;
+    qint64 rows = 0;
+
+    // bytes written to the file, after compression
+    qint64 bytes = 0;
+    qint64 elapsed = 0;
+
+    bool cancelled = false;
+
+    // non empty if the export stopped on an error, the file is removed then
+    QString error;
+};
+
+Q_DECLARE_METATYPE(ResultExport)
+Q_DECLARE_METATYPE(ResultExportResult)
+
+#endif // RESULTEXPORT_H
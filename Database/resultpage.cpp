@@ -0,0 +1,132 @@
+#include "resultpage.h"
+
+#include <QDataStream>
+
+#include <cstring>
+
+ResultPage::ResultPage(int columnCount) : columns(columnCount)
+{
+    for (Column& column : columns)
+    {
+        column.types.reserve(Rows);
+        column.values.reserve(Rows);
+    }
+}
+
+void ResultPage::appendRow(const QVariantList &values)
+{
+    for (int i = 0; i < columns.size(); ++i)
+    {
+        Column& column = columns[i];
+        const QVariant v = i < values.size() ? values.at(i) : QVariant();
+
+        if (v.isNull())
+        {
+            column.types << Null;
+            column.values << 0;
+            continue;
+        }
+
+        switch (v.type())
+        {
+        case QVariant::Bool:
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QVariant::ULongLong:
+            column.types << Integer;
+            column.values << v.toLongLong();
+            break;
+
+        case QVariant::Double:
+        {
+            const double d = v.toDouble();
+            qint64 bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            column.types << Real;
+            column.values << bits;
+            break;
+        }
+
+        case QVariant::ByteArray:
+        {
+            const QByteArray bytes = v.toByteArray();
+            column.types << Blob;
+            column.values << ((qint64(column.heap.size()) << 32) | quint32(bytes.size()));
+            column.heap.append(bytes);
+            break;
+        }
+
+        default:
+        {
+            const QByteArray text = v.toString().toUtf8();
+            column.types << Text;
+            column.values << ((qint64(column.heap.size()) << 32) | quint32(text.size()));
+            column.heap.append(text);
+            break;
+        }
+        }
+    }
+
+    ++rows;
+}
+
+QVariant ResultPage::value(int row, int column) const
+{
+    if (row < 0 || row >= rows || column < 0 || column >= columns.size())
+        return QVariant();
+
+    const Column& c = columns.at(column);
+    const qint64 v = c.values.at(row);
+
+    switch (c.types.at(row))
+    {
+    case Integer:
+        return v;
+
+    case Real:
+    {
+        double d;
+        std::memcpy(&d, &v, sizeof(d));
+        return d;
+    }
+
+    case Text:
+        return QString::fromUtf8(c.heap.constData() + (v >> 32), int(v & 0xffffffff));
+
+    case Blob:
+        return c.heap.mid(int(v >> 32), int(v & 0xffffffff));
+
+    default:
+        return QVariant();
+    }
+}
+
+qint64 ResultPage::memoryUsage() const
+{
+    qint64 bytes = sizeof(ResultPage);
+    for (const Column& column : columns)
+        bytes += sizeof(Column) + column.types.capacity() + column.values.capacity() * sizeof(qint64) + column.heap.capacity();
+    return bytes;
+}
+
+QDataStream &operator<<(QDataStream &stream, const ResultPage &page)
+{
+    stream << qint32(page.rows) << qint32(page.columns.size());
+    for (const ResultPage::Column& column : page.columns)
+        stream << column.types << column.values << column.heap;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, ResultPage &page)
+{
+    qint32 rows = 0;
+    qint32 columnCount = 0;
+    stream >> rows >> columnCount;
+
+    page = ResultPage(qMax(0, columnCount));
+    for (ResultPage::Column& column : page.columns)
+        stream >> column.types >> column.values >> column.heap;
+    page.rows = rows;
+    return stream;
+}
@@ -0,0 +1,64 @@
+#ifndef RESULTPAGE_H
+#define RESULTPAGE_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QVariant>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QDataStream;
+QT_END_NAMESPACE
+
+/*
+ * A page of consecutive rows of a result set, stored column by column in typed arrays instead of one QVariant per value. Integers and reals live
+ * in a single 64 bit slot, text and blobs are appended to a per column byte heap. A page of a few hundred rows costs a handful of allocations and
+ * roughly the size of its data, which keeps the result view usable with millions of rows.
+ */
+class ResultPage
+{
+public:
+    // number of rows in a full page
+    enum { Rows = 512 };
+
+    explicit ResultPage(int columnCount = 0);
+
+    int rowCount() const { return rows; }
+    int columnCount() const { return columns.size(); }
+
+    // appends a row, values must hold one entry per column
+    void appendRow(const QVariantList& values);
+
+    QVariant value(int row, int column) const;
+
+    // approximate number of bytes the page occupies
+    qint64 memoryUsage() const;
+
+    // the page as it is spilled to disk and read back
+    friend QDataStream& operator<<(QDataStream& stream, const ResultPage& page);
+    friend QDataStream& operator>>(QDataStream& stream, ResultPage& page);
+
+private:
+    enum ValueType : quint8
+    {
+        Null,
+        Integer,
+        Real,
+        Text,
+        Blob
+    };
+
+    struct Column
+    {
+        QVector<quint8> types;
+        QVector<qint64> values;     // the integer, the bits of the real, or offset << 32 | length into the heap
+        QByteArray heap;
+    };
+
+    QVector<Column> columns;
+    int rows = 0;
+};
+
+Q_DECLARE_METATYPE(ResultPage)
+
+#endif // RESULTPAGE_H
@@ -0,0 +1,45 @@
+#ifndef SCHEMAINFO_H
+#define SCHEMAINFO_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMetaType>
+
+// A table, view, index or trigger of a database, as listed in sqlite_master
+struct SchemaObject
+{
+    // table, view, index or trigger
+    QString type;
+    QString name;
+
+    // the table an index or a trigger belongs to, the object itself for tables and views
+    QString table;
+
+    // columns of tables and views
+    QStringList columns;
+};
+
+// Changes of the schema of a database since the previous delta, see QueryWorker::refreshSchema
+struct SchemaDelta
+{
+    QString path;
+
+    // the first delta after opening a database, it holds every object and the functions
+    bool reset = false;
+
+    // objects that were created or whose definition changed
+    QVector<SchemaObject> changed;
+
+    // names of the objects that were dropped
+    QStringList removed;
+
+    // names of the sql functions of the connection, only in the first delta
+    QStringList functions;
+
+    bool isEmpty() const { return !reset && changed.isEmpty() && removed.isEmpty(); }
+};
+
+Q_DECLARE_METATYPE(SchemaDelta)
+
+#endif // SCHEMAINFO_H
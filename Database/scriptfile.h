@@ -0,0 +1,34 @@
+#ifndef SCRIPTFILE_H
+#define SCRIPTFILE_H
+
+#include <QString>
+#include <QMetaType>
+
+// Request to execute an SQL script straight from a file, a statement at a time, without loading it into the editor
+struct ScriptFileRun
+{
+    QString fileName;
+
+    // statements committed together; the transaction statements of the script are skipped then. 0 keeps the transactions of the script as written
+    int statementsPerTransaction = 10000;
+};
+
+// Outcome of QueryWorker::runScriptFile
+struct ScriptFileResult
+{
+    QString fileName;
+    qint64 statements = 0;
+    qint64 bytes = 0;
+    qint64 elapsed = 0;
+
+    bool cancelled = false;
+
+    // non empty if a statement failed, line is the line of the script it starts on; the batches committed before it stay in the database
+    QString error;
+    int line = 0;
+};
+
+Q_DECLARE_METATYPE(ScriptFileRun)
+Q_DECLARE_METATYPE(ScriptFileResult)
+
+#endif // SCRIPTFILE_H
@@ -0,0 +1,40 @@
+#include "sqlitehandle.h"
+
+#include <QAtomicInt>
+
+namespace
+{
+    QAtomicInt connectionsOpened;
+
+    int countConnection(sqlite3*, const char**, const sqlite3_api_routines*)
+    {
+        connectionsOpened.ref();
+        return SQLITE_OK;
+    }
+}
+
+/*
+ * An automatic extension registered with the linked library runs for every connection that library opens, so it runs for a connection of the
+ * driver only when the driver opened it through the same library.
+ */
+bool sqliteLibraryShared()
+{
+    typedef void (*Entry)(void);
+    const Entry entry = reinterpret_cast<Entry>(&countConnection);
+    if (sqlite3_auto_extension(entry) != SQLITE_OK)
+        return false;
+
+    const int before = connectionsOpened.load();
+    const QString name = "firelite_library_check";
+    bool shared = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(":memory:");
+        shared = db.open() && connectionsOpened.load() != before;
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+
+    sqlite3_cancel_auto_extension(entry);
+    return shared;
+}
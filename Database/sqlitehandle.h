@@ -0,0 +1,50 @@
+#ifndef SQLITEHANDLE_H
+#define SQLITEHANDLE_H
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlResult>
+#include <QVariant>
+
+#include <sqlite3.h>
+
+/*
+ * Returns the native sqlite3 connection behind a QSQLITE database, or nullptr if the database is not open or uses another driver. The handle is
+ * owned by the driver, so it must not be closed and is only valid while the QSqlDatabase stays open.
+ */
+inline sqlite3* sqliteHandle(const QSqlDatabase& db)
+{
+    if (!db.isOpen() || !db.driver())
+        return nullptr;
+
+    const QVariant v = db.driver()->handle();
+    if (!v.isValid() || qstrcmp(v.typeName(), "sqlite3*") != 0)
+        return nullptr;
+
+    return *static_cast<sqlite3* const*>(v.data());
+}
+
+/*
+ * Returns the native prepared statement behind a QSqlQuery on a QSQLITE database, or nullptr if the query was never prepared. The statement is
+ * owned by the query and is only valid until the query is executed again or destroyed.
+ */
+inline sqlite3_stmt* sqliteStatement(const QSqlQuery& query)
+{
+    if (!query.result())
+        return nullptr;
+
+    const QVariant v = query.result()->handle();
+    if (!v.isValid() || qstrcmp(v.typeName(), "sqlite3_stmt*") != 0)
+        return nullptr;
+
+    return *static_cast<sqlite3_stmt* const*>(v.data());
+}
+
+/*
+ * Tells whether the QSQLITE driver runs on the sqlite library Firelite is linked with. The native calls above act on connections the driver
+ * opened, which is undefined when the driver carries a copy of sqlite of its own, as the Qt builds that compile sqlite into the plugin do.
+ */
+bool sqliteLibraryShared();
+
+#endif // SQLITEHANDLE_H
@@ -0,0 +1,170 @@
+#include "sqlvalidator.h"
+#include "validationworker.h"
+
+namespace
+{
+    // statements the cache holds at most, it is simply emptied when it grows past this
+    const int CacheSize = 10000;
+
+    // statements that may create, change or drop the objects the statements after them refer to
+    bool changesSchema(const QString& keyword)
+    {
+        return keyword == "CREATE" || keyword == "ALTER" || keyword == "DROP" || keyword == "ATTACH" || keyword == "DETACH";
+    }
+}
+
+SqlValidator::SqlValidator(QObject *parent) : QObject(parent), worker(new ValidationWorker)
+{
+    qRegisterMetaType<ValidationItem>("ValidationItem");
+    qRegisterMetaType<QVector<ValidationItem>>("QVector<ValidationItem>");
+    qRegisterMetaType<SqlDiagnostic>("SqlDiagnostic");
+    qRegisterMetaType<QVector<SqlDiagnostic>>("QVector<SqlDiagnostic>");
+
+    workerThread.setObjectName("SqlValidator");
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+
+    connect(this, &SqlValidator::setDatabaseRequested, worker, &ValidationWorker::setDatabase);
+    connect(this, &SqlValidator::setAttachedDatabasesRequested, worker, &ValidationWorker::setAttachedDatabases);
+    connect(this, &SqlValidator::prepareRequested, worker, &ValidationWorker::prepare);
+    connect(worker, &ValidationWorker::prepared, this, &SqlValidator::onPrepared);
+
+    workerThread.start();
+}
+
+SqlValidator::~SqlValidator()
+{
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void SqlValidator::setDatabase(const QString &p)
+{
+    if (p == path)
+        return;
+
+    path = p;
+    attached.clear();
+    clearCache();
+    statements.clear();
+    items.clear();
+    ++generation;
+    emit setDatabaseRequested(p);
+    emit diagnosticsReady(QVector<SqlDiagnostic>());
+}
+
+/*
+ * Attaches the databases attached to the connection of the query engine, the outcome of a statement may depend on them.
+ */
+void SqlValidator::setAttachedDatabases(const QVariantMap &databases)
+{
+    if (databases == attached)
+        return;
+
+    attached = databases;
+    clearCache();
+    emit setAttachedDatabasesRequested(databases);
+}
+
+void SqlValidator::clearCache()
+{
+    cache.clear();
+}
+
+void SqlValidator::validate(const QVector<SqlStatement> &s)
+{
+    statements = s;
+    items.clear();
+    items.reserve(statements.size());
+    ++generation;
+
+    if (path.isEmpty())
+    {
+        emit diagnosticsReady(QVector<SqlDiagnostic>());
+        return;
+    }
+
+    QVector<ValidationItem> pending;
+    bool lenient = false;
+    foreach (const SqlStatement& statement, statements)
+    {
+        ValidationItem item;
+        item.text = statement.text;
+        item.lenient = lenient;
+        item.key = qHash(statement.text) ^ (lenient ? 0x9e3779b9u : 0u);
+
+        const auto cached = cache.constFind(item.key);
+        if (cached != cache.constEnd() && cached->text == item.text && cached->lenient == lenient)
+            item = *cached;
+        else
+            pending << item;
+
+        items << item;
+        lenient = lenient || changesSchema(statement.keyword);
+    }
+
+    if (pending.isEmpty())
+        report();
+    else
+        emit prepareRequested(generation, pending);
+}
+
+/*
+ * Caches what the worker found, and reports the errors if the statements are still the ones of the last validate() call.
+ */
+void SqlValidator::onPrepared(int g, const QVector<ValidationItem> &prepared)
+{
+    if (cache.size() + prepared.size() > CacheSize)
+        cache.clear();
+
+    QHash<uint, ValidationItem> byKey;
+    foreach (const ValidationItem& item, prepared)
+    {
+        if (!item.checked)
+            continue;
+        cache.insert(item.key, item);
+        byKey.insert(item.key, item);
+    }
+
+    if (g != generation)
+        return;
+
+    for (ValidationItem& item : items)
+    {
+        const auto it = byKey.constFind(item.key);
+        if (it != byKey.constEnd() && it->text == item.text)
+            item = *it;
+    }
+    report();
+}
+
+/*
+ * Turns the errors into positions of the document: the token the error is at, or the whole statement if sqlite doesn't tell.
+ */
+void SqlValidator::report()
+{
+    QVector<SqlDiagnostic> diagnostics;
+    for (int i = 0; i < items.size() && i < statements.size(); ++i)
+    {
+        const ValidationItem& item = items.at(i);
+        if (item.error.isEmpty())
+            continue;
+
+        const SqlStatement& statement = statements.at(i);
+        SqlDiagnostic diagnostic;
+        diagnostic.message = item.error;
+        diagnostic.start = statement.start;
+        diagnostic.length = statement.text.size();
+
+        if (item.offset >= 0 && item.offset < statement.text.size())
+        {
+            SqlLexer lexer(statement.text.constData() + item.offset, statement.text.size() - item.offset);
+            SqlToken token;
+            diagnostic.start = statement.start + item.offset;
+            diagnostic.length = lexer.next(token) ? qMax(1, token.length) : 1;
+        }
+        diagnostics << diagnostic;
+    }
+
+    emit diagnosticsReady(diagnostics);
+}
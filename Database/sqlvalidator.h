@@ -0,0 +1,60 @@
+#ifndef SQLVALIDATOR_H
+#define SQLVALIDATOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QVariantMap>
+
+#include "Database/validation.h"
+#include "Libraries/sqllexer.h"
+
+class ValidationWorker;
+
+/*
+ * GUI side of the validation of the editor. Statements are compiled by a ValidationWorker in a thread of its own; the outcome of every statement
+ * is cached by the hash of its text, so statements that didn't change since the last check are never compiled again. The cache is dropped when
+ * the schema changes, since that may change the outcome.
+ */
+class SqlValidator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SqlValidator(QObject* parent = nullptr);
+    ~SqlValidator();
+
+public slots:
+    void setDatabase(const QString& path);
+    void setAttachedDatabases(const QVariantMap& databases);
+    void clearCache();
+
+    // checks the statements, whose start is their position in the document; the errors arrive through diagnosticsReady()
+    void validate(const QVector<SqlStatement>& statements);
+
+signals:
+    void diagnosticsReady(const QVector<SqlDiagnostic>& diagnostics);
+
+    // requests to the worker thread
+    void setDatabaseRequested(const QString& path);
+    void setAttachedDatabasesRequested(const QVariantMap& databases);
+    void prepareRequested(int generation, const QVector<ValidationItem>& items);
+
+private:
+    QThread workerThread;
+    ValidationWorker* worker;
+
+    QString path;
+    QVariantMap attached;
+    QHash<uint, ValidationItem> cache;
+
+    // the statements of the last validate() call, and their items
+    int generation = 0;
+    QVector<SqlStatement> statements;
+    QVector<ValidationItem> items;
+
+    void onPrepared(int generation, const QVector<ValidationItem>& prepared);
+    void report();
+};
+
+#endif // SQLVALIDATOR_H
@@ -0,0 +1,38 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+// A statement to check, and once checked, what sqlite said about it; see ValidationWorker::prepare
+struct ValidationItem
+{
+    // hash of the text and of lenient, the key of the cache of SqlValidator
+    uint key = 0;
+    QString text;
+
+    // a statement that follows a CREATE, ALTER or DROP of the same script may refer to objects that don't exist until the script runs, so
+    // unknown tables and columns are not reported for it
+    bool lenient = false;
+
+    // false if the statement could not be checked, because the schema was locked
+    bool checked = false;
+
+    // empty if the statement compiles; offset is the character of the text the error is at, -1 if sqlite doesn't tell
+    QString error;
+    int offset = -1;
+};
+
+// An error of a statement in the editor, positions are relative to the document
+struct SqlDiagnostic
+{
+    int start = 0;
+    int length = 0;
+    QString message;
+};
+
+Q_DECLARE_METATYPE(ValidationItem)
+Q_DECLARE_METATYPE(SqlDiagnostic)
+
+#endif // VALIDATION_H
@@ -0,0 +1,100 @@
+#include "validationworker.h"
+#include "Libraries/sqllexer.h"
+
+#include <QFile>
+
+#include <sqlite3.h>
+
+ValidationWorker::ValidationWorker(QObject *parent) : QObject(parent)
+{
+}
+
+ValidationWorker::~ValidationWorker()
+{
+    setDatabase(QString());
+}
+
+void ValidationWorker::setDatabase(const QString &path)
+{
+    if (handle)
+    {
+        sqlite3_close(handle);
+        handle = nullptr;
+    }
+
+    attached.clear();
+    if (path.isEmpty())
+        return;
+
+    if (sqlite3_open_v2(QFile::encodeName(path).constData(), &handle, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        sqlite3_close(handle);
+        handle = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(handle, 100);
+}
+
+/*
+ * Attaches the databases the query engine attached to its connection, under the same schema names. They are opened read only as well.
+ */
+void ValidationWorker::setAttachedDatabases(const QVariantMap &databases)
+{
+    if (!handle || databases == attached)
+        return;
+
+    for (auto i = attached.constBegin(); i != attached.constEnd(); ++i)
+        sqlite3_exec(handle, QString("DETACH DATABASE %1").arg(SqlLexer::quoteIdentifier(i.key())).toUtf8().constData(), nullptr, nullptr, nullptr);
+
+    attached = databases;
+    for (auto i = attached.constBegin(); i != attached.constEnd(); ++i)
+    {
+        const QString sql = QString("ATTACH DATABASE '%1' AS %2").arg(i.value().toString().replace("'", "''"), SqlLexer::quoteIdentifier(i.key()));
+        sqlite3_exec(handle, sql.toUtf8().constData(), nullptr, nullptr, nullptr);
+    }
+}
+
+/*
+ * Compiles every statement and fills in its error. Reading the schema version first makes sqlite notice DDL of other connections, so that the
+ * statements are checked against the current schema.
+ */
+void ValidationWorker::prepare(int generation, const QVector<ValidationItem> &items)
+{
+    QVector<ValidationItem> result = items;
+    if (!handle)
+    {
+        emit prepared(generation, QVector<ValidationItem>());
+        return;
+    }
+
+    sqlite3_exec(handle, "PRAGMA schema_version", nullptr, nullptr, nullptr);
+
+    for (ValidationItem& item : result)
+    {
+        const QByteArray sql = item.text.toUtf8();
+        sqlite3_stmt* statement = nullptr;
+        const int rc = sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &statement, nullptr);
+        sqlite3_finalize(statement);
+
+        // a locked schema says nothing about the statement
+        if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+            continue;
+
+        item.checked = true;
+        if (rc == SQLITE_OK)
+            continue;
+
+        const QString error = QString::fromUtf8(sqlite3_errmsg(handle));
+        if (item.lenient && error.startsWith("no such "))
+            continue;
+
+        item.error = error;
+#if SQLITE_VERSION_NUMBER >= 3038000
+        const int offset = sqlite3_error_offset(handle);
+        if (offset >= 0 && offset <= sql.size())
+            item.offset = QString::fromUtf8(sql.constData(), offset).size();
+#endif
+    }
+
+    emit prepared(generation, result);
+}
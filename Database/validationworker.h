@@ -0,0 +1,39 @@
+#ifndef VALIDATIONWORKER_H
+#define VALIDATIONWORKER_H
+
+#include <QObject>
+#include <QVector>
+#include <QVariantMap>
+
+#include "Database/validation.h"
+
+struct sqlite3;
+
+/*
+ * Compiles statements with sqlite3_prepare_v2 without stepping them, on a read only connection of its own, so that checking the editor never
+ * waits for a statement of the query engine and never changes the database. Lives in the thread of a SqlValidator.
+ */
+class ValidationWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ValidationWorker(QObject* parent = nullptr);
+    ~ValidationWorker();
+
+public slots:
+    void setDatabase(const QString& path);
+    void setAttachedDatabases(const QVariantMap& databases);
+    void prepare(int generation, const QVector<ValidationItem>& items);
+
+signals:
+    void prepared(int generation, const QVector<ValidationItem>& items);
+
+private:
+    sqlite3* handle = nullptr;
+
+    // the databases attached to the one of the query engine, by schema name, so that statements that use them compile here too
+    QVariantMap attached;
+};
+
+#endif // VALIDATIONWORKER_H
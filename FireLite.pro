@@ -23,17 +23,78 @@ SOURCES     += main.cpp\
             Widgets/textedit.cpp \
             Widgets/solutiontreewidget.cpp \
             Formats/formatstream.cpp \
-            Widgets/tblgenerator.cpp
+            Formats/highlightbenchmark.cpp \
+            Formats/resultwriter.cpp \
+            Libraries/sqllexer.cpp \
+            Libraries/sqlscriptreader.cpp \
+            Libraries/csvreader.cpp \
+            Libraries/completionindex.cpp \
+            Libraries/sqlcompletion.cpp \
+            Widgets/tblgenerator.cpp \
+            Widgets/tablebrowser.cpp \
+            Widgets/parameterpanel.cpp \
+            Widgets/planview.cpp \
+            Widgets/csvimportdialog.cpp \
+            Widgets/connectionsettingsdialog.cpp \
+            Database/queryworker.cpp \
+            Database/queryengine.cpp \
+            Database/validationworker.cpp \
+            Database/sqlvalidator.cpp \
+            Database/resultpage.cpp \
+            Database/dumper.cpp \
+            Database/sqlitehandle.cpp \
+            Database/connectionprofile.cpp \
+            Models/resultmodel.cpp \
+            Models/schemamodel.cpp
 
 HEADERS     += Views/mainwindow.h \
             Libraries/viewmodel.h \
+            Libraries/sqllexer.h \
+            Libraries/sqlscriptreader.h \
+            Libraries/csvreader.h \
+            Libraries/completionindex.h \
+            Libraries/sqlcompletion.h \
             Widgets/textedit.h \
             Widgets/solutiontreewidget.h \
             Formats/formatstream.h \
-            Widgets/tblgenerator.h
+            Formats/highlightbenchmark.h \
+            Formats/resultwriter.h \
+            Widgets/tblgenerator.h \
+            Widgets/tablebrowser.h \
+            Widgets/parameterpanel.h \
+            Widgets/planview.h \
+            Widgets/csvimportdialog.h \
+            Widgets/connectionsettingsdialog.h \
+            Database/queryresult.h \
+            Database/keyset.h \
+            Database/queryplan.h \
+            Database/csvimport.h \
+            Database/resultexport.h \
+            Database/backup.h \
+            Database/dump.h \
+            Database/dumper.h \
+            Database/scriptfile.h \
+            Database/schemainfo.h \
+            Database/connectionprofile.h \
+            Database/sqlitehandle.h \
+            Database/queryworker.h \
+            Database/queryengine.h \
+            Database/validation.h \
+            Database/validationworker.h \
+            Database/sqlvalidator.h \
+            Database/resultpage.h \
+            Models/resultmodel.h \
+            Models/schemamodel.h
 
 FORMS       += Views/mainwindow.ui
 
+# the native sqlite api is used for interrupting, statistics and backups, on the connections of the QSQLITE driver too. The driver must use
+# this same library, so Qt has to be configured with -system-sqlite; main() refuses to start otherwise
+LIBS        += -lsqlite3
+
+# gzip compression of exported results
+LIBS        += -lz
+
 RESOURCES   += Resources/resources.qrc
 
 # object files
@@ -1,272 +1,174 @@
 #include "formatstream.h"
+#include "Libraries/sqllexer.h"
 
-FormatStream::FormatStream(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
-{
-    HighlightingRule rule;
-
-    keywordFormat.setForeground(QColor::fromRgb(0,0,255));
-    keywordFormat.setFontWeight(QFont::Bold);
-
-    QStringList keywordPatterns;
-    keywordPatterns << "\\babort\\b"
-                    << "\\baction\\b"
-                    << "\\badd\\b"
-                    << "\\bafter\\b"
-                    << "\\ball\\b"
-                    << "\\balter\\b"
-                    << "\\banalyze\\b"
-                    << "\\band\\b"
-                    << "\\bas\\b"
-                    << "\\basc\\b"
-                    << "\\battach\\b"
-                    << "\\bautoincrement\\b"
-
-                       //! Letter B
-                    << "\\bbefore\\b"
-                    << "\\bbegin\\b"
-                    << "\\bbetween\\b"
-                    << "\\bbinary\\b"
-                    << "\\bblob\\b"
-                    << "\\bby\\b"
-
-                       //! Letter C
-                    << "\\bcascade\\b"
-                    << "\\bcase\\b"
-                    << "\\bcast\\b"
-                    << "\\bcheck\\b"
-                    << "\\bcollate\\b"
-                    << "\\bcolumn\\b"
-                    << "\\bcommit\\b"
-                    << "\\bconflict\\b"
-                    << "\\bconstraint\\b"
-                    << "\\bcreate\\b"
-                    << "\\bcross\\b"
-                    << "\\bcurrency\\b"
-                    << "\\bcurrent_date\\b"
-                    << "\\bcurrent_time\\b"
-                    << "\\bcurrent_timestamp\\b"
-
-                       //! Letter D
-                    << "\\bdatabase\\b"
-                    << "\\bdefault\\b"
-                    << "\\bdeferrable\\b"
-                    << "\\bdeferred\\b"
-                    << "\\bdelete\\b"
-                    << "\\bdesc\\b"
-                    << "\\bdetach\\b"
-                    << "\\bdistinct\\b"
-                    << "\\bdrop\\b"
-
-                       //! Letter E
-                    << "\\beach\\b"
-                    << "\\belse\\b"
-                    << "\\bend\\b"
-                    << "\\bescape\\b"
-                    << "\\bexcept\\b"
-                    << "\\bexclusive\\b"
-                    << "\\bexists\\b"
-                    << "\\bexplain\\b"
-
-                       //! Letter F
-                    << "\\bfail\\b"
-                    << "\\bfor\\b"
-                    << "\\bforeign\\b"
-                    << "\\bfrom\\b"
-                    << "\\bfloat\\b"
-                    << "\\bfull\\b"
-
-                       //! Letter G
-                    << "\\bglob\\b"
-                    << "\\bgroup\\b"
-
-                       //! Letter H
-                    << "\\bhaving\\b"
+#include <QTextDocument>
+#include <QTextBlock>
 
-                       //! Letter I
-                    << "\\bif\\b"
-                    << "\\bignore\\b"
-                    << "\\bimmediate\\b"
-                    << "\\bin\\b"
-                    << "\\bindex\\b"
-                    << "\\bindexed\\b"
-                    << "\\binitially\\b"
-                    << "\\binner\\b"
-                    << "\\binsert\\b"
-                    << "\\binstead\\b"
-                    << "\\bintersect\\b"
-                    << "\\binto\\b"
-                    << "\\bis\\b"
-                    << "\\bisnull\\b"
+#include <algorithm>
+#include <cstring>
 
-                       //! Letter J
-                    << "\\bjoin\\b"
-
-                       //! Letter K
-                    << "\\bkey\\b"
-
-                       //! Letter L
-                    << "\\bleft\\b"
-                    << "\\blike\\b"
-                    << "\\blimit\\b"
-
-                       //! Letter M
-                    << "\\bmatch\\b"
-
-                       //! Letter N
-                    << "\\bnatural\\b"
-                    << "\\bno\\b"
-                    << "\\bnot\\b"
-                    << "\\bnotnull\\b"
-                    << "\\bnull\\b"
-
-                       //! Letter O
-                    << "\\bof\\b"
-                    << "\\boffset\\b"
-                    << "\\bon\\b"
-                    << "\\bor\\b"
-                    << "\\border\\b"
-                    << "\\bouter\\b"
-
-                       //! Letter P
-                    << "\\bplan\\b"
-                    << "\\bpragma\\b"
-                    << "\\bprimary\\b"
-
-                       //! Letter Q
-                    << "\\bquery\\b"
-
-                       //! Letter R
-                    << "\\braise\\b"
-                    << "\\breal\\b"
-                    << "\\breferences\\b"
-                    << "\\bregexp\\b"
-                    << "\\breindex\\b"
-                    << "\\brelease\\b"
-                    << "\\brename\\b"
-                    << "\\breplace\\b"
-                    << "\\brestrict\\b"
-                    << "\\bright\\b"
-                    << "\\brollback\\b"
-                    << "\\brow\\b"
-
-                       //! Letter S
-                    << "\\bsavepoint\\b"
-                    << "\\bselect\\b"
-                    << "\\bset\\b"
-                    << "\\bsmallint\\b"
-
-                       //! Letter T
-                    << "\\btable\\b"
-                    << "\\btemp\\b"
-                    << "\\btemporary\\b"
-                    << "\\bthen\\b"
-                    << "\\btime\\b"
-                    << "\\btimestamp\\b"
-                    << "\\bto\\b"
-                    << "\\btransaction\\b"
-                    << "\\btrigger\\b"
+namespace
+{
+    // keywords and type names that are highlighted, upper case and sorted so that they can be binary searched
+    const char* const Keywords[] =
+    {
+        "ABORT", "ACTION", "ADD", "AFTER", "ALL", "ALTER", "ALWAYS", "ANALYZE", "AND", "AS", "ASC", "ATTACH", "AUTOINCREMENT", "BEFORE", "BEGIN",
+        "BETWEEN", "BINARY", "BLOB", "BOOL", "BOOLEAN", "BY", "CASCADE", "CASE", "CAST", "CHAR", "CHECK", "COLLATE", "COLUMN", "COMMIT", "CONFLICT",
+        "CONSTRAINT", "CREATE", "CROSS", "CURRENCY", "CURRENT", "CURRENT_DATE", "CURRENT_TIME", "CURRENT_TIMESTAMP", "DATABASE", "DATE", "DEFAULT",
+        "DEFERRABLE", "DEFERRED", "DELETE", "DESC", "DETACH", "DISTINCT", "DO", "DOUBLE", "DROP", "EACH", "ELSE", "END", "ESCAPE", "EXCEPT",
+        "EXCLUDE", "EXCLUSIVE", "EXISTS", "EXPLAIN", "FAIL", "FILTER", "FIRST", "FLOAT", "FOLLOWING", "FOR", "FOREIGN", "FROM", "FULL", "GENERATED",
+        "GLOB", "GROUP", "GROUPS", "HAVING", "IF", "IGNORE", "IMMEDIATE", "IN", "INDEX", "INDEXED", "INITIALLY", "INNER", "INSERT", "INSTEAD", "INT",
+        "INTEGER", "INTERSECT", "INTO", "IS", "ISNULL", "JOIN", "KEY", "LAST", "LEFT", "LIKE", "LIMIT", "MATCH", "MATERIALIZED", "NATURAL", "NO",
+        "NOT", "NOTHING", "NOTNULL", "NULL", "NULLS", "NUMERIC", "OF", "OFFSET", "ON", "OR", "ORDER", "OTHERS", "OUTER", "OVER", "PARTITION", "PLAN",
+        "PRAGMA", "PRECEDING", "PRIMARY", "QUERY", "RAISE", "RANGE", "REAL", "RECURSIVE", "REFERENCES", "REGEXP", "REINDEX", "RELEASE", "RENAME",
+        "REPLACE", "RESTRICT", "RETURNING", "RIGHT", "ROLLBACK", "ROW", "ROWS", "SAVEPOINT", "SELECT", "SET", "SMALLINT", "TABLE", "TEMP",
+        "TEMPORARY", "TEXT", "THEN", "TIES", "TIME", "TIMESTAMP", "TO", "TRANSACTION", "TRIGGER", "UNBOUNDED", "UNION", "UNIQUE", "UPDATE", "USING",
+        "VACUUM", "VALUES", "VARCHAR", "VIEW", "VIRTUAL", "WHEN", "WHERE", "WINDOW", "WITH", "WITHOUT"
+    };
+
+    const int KeywordCount = int(sizeof(Keywords) / sizeof(Keywords[0]));
+
+    // no keyword is longer than CURRENT_TIMESTAMP
+    const int MaxKeywordLength = 17;
+
+    bool keywordLess(const char* a, const char* b)
+    {
+        return std::strcmp(a, b) < 0;
+    }
 
-                       //! Letter U
-                    << "\\bunion\\b"
-                    << "\\bunique\\b"
-                    << "\\bupdate\\b"
-                    << "\\busing\\b"
+    /*
+     * True if the identifier token is one of the Keywords. The token is upper cased into a small buffer first, so that identifiers which can't
+     * be keywords, because they are too long or not plain ascii, are rejected without searching.
+     */
+    bool isKeyword(const QChar* data, const SqlToken& token)
+    {
+        if (token.length > MaxKeywordLength)
+            return false;
 
-                       //! Letter V
-                    << "\\bvacuum\\b"
-                    << "\\bvalues\\b"
-                    << "\\bview\\b"
-                    << "\\bvirtual\\b"
+        char word[MaxKeywordLength + 1];
+        for (int i = 0; i < token.length; ++i)
+        {
+            ushort c = data[token.start + i].unicode();
+            if (c >= 'a' && c <= 'z')
+                c -= 'a' - 'A';
+            else if (c > 0x7f)
+                return false;
+            word[i] = char(c);
+        }
+        word[token.length] = '\0';
 
-                       //! Letter W
-                    << "\\bwhen\\b"
-                    << "\\bwhere\\b"
+        const char* const* end = Keywords + KeywordCount;
+        const char* const* found = std::lower_bound(Keywords, end, static_cast<const char*>(word), keywordLess);
+        return found != end && std::strcmp(*found, word) == 0;
+    }
+}
 
-                       //! Data Types
-                    << "\\bint\\b"
-                    << "\\binteger\\b"
-                    << "\\bchar\\b"
-                    << "\\bvarchar\\b"
-                    << "\\btext\\b"
-                    << "\\bbool\\b"
-                    << "\\bboolean\\b"
-                    << "\\bdouble\\b"
-                    << "\\bdate\\b"
-                    << "\\bMayura\\b";
+FormatStream::FormatStream(QTextDocument *parent)
+    : QSyntaxHighlighter(parent)
+{
+    Q_ASSERT(std::is_sorted(Keywords, Keywords + KeywordCount, keywordLess));
 
-    foreach (const QString& pattern, keywordPatterns)
-    {
-        rule.pattern=QRegExp(pattern,Qt::CaseInsensitive);
-        rule.format=keywordFormat;
-        highlightingRules.append(rule);
-    }
+    keywordFormat.setForeground(QColor::fromRgb(0,0,255));
+    keywordFormat.setFontWeight(QFont::Bold);
 
     multiLineCommentFormat.setForeground(QColor::fromRgb(0,128,0));
-
     numberFormat.setForeground(QColor::fromRgb(255,130,0));
-    rule.pattern = QRegExp("[0-9]");
-    rule.format = numberFormat;
-    highlightingRules.append(rule);
-
     quotationFormat.setForeground(Qt::darkGreen);
-    rule.pattern = QRegExp("\".*\"");
-    rule.format = quotationFormat;
-    highlightingRules.append(rule);
-
     singleQuatationFormat.setForeground(Qt::darkGray);
-    rule.pattern = QRegExp("\'.*\'");
-    rule.format = singleQuatationFormat;
-    highlightingRules.append(rule);
 
     functionFormat.setFontItalic(true);
     functionFormat.setForeground(Qt::blue);
-    rule.pattern = QRegExp("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = functionFormat;
-    highlightingRules.append(rule);
 
     singleLineCommentFormat.setForeground(Qt::darkGreen);
-    rule.pattern = QRegExp("--.*");
-    rule.format = singleLineCommentFormat;
-    highlightingRules.append(rule);
+}
+
+/*
+ * Called by the editor whenever other blocks come into view. Blocks that came within the margin and were only scanned so far are highlighted now.
+ */
+void FormatStream::setVisibleBlocks(int first, int last)
+{
+    firstHighlighted = qMax(0, first - VisibleMargin);
+    lastHighlighted = last + VisibleMargin;
 
-    commentStartExpression = QRegExp("/\\*");
-    commentEndExpression = QRegExp("\\*/");
+    for (QTextBlock block = document()->findBlockByNumber(firstHighlighted); block.isValid() && block.blockNumber() <= lastHighlighted;
+         block = block.next())
+    {
+        if (block.userState() != -1 && (block.userState() & Deferred))
+            rehighlightBlock(block);
+    }
 }
 
+/*
+ * Highlights a block in a single pass of the SqlLexer. The block state is the state the lexer ends the block in, so comments, strings and
+ * quoted names that span lines go on in the next block.
+ */
 void FormatStream::highlightBlock(const QString &text)
 {
-    foreach (const HighlightingRule& rule, highlightingRules)
+    const int previousState = previousBlockState() == -1 ? SqlLexer::Normal : previousBlockState() & ~Deferred;
+    SqlLexer lexer(text, SqlLexer::State(previousState));
+    SqlToken token;
+
+    // out of view, only the state at the end of the block is needed by the blocks below it
+    const int number = currentBlock().blockNumber();
+    if (number < firstHighlighted || number > lastHighlighted)
     {
-        QRegExp expression(rule.pattern);
-        int index = expression.indexIn(text);
-        while (index >= 0)
-        {
-            int length = expression.matchedLength();
-            setFormat(index, length, rule.format);
-            index = expression.indexIn(text, index + length);
-        }
+        while (lexer.next(token))
+            ;
+        setCurrentBlockState(lexer.state() | Deferred);
+        return;
     }
 
-    setCurrentBlockState(0);
+    const QChar* data = text.constData();
+    const QTextCharFormat* format;
 
-    int startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = commentStartExpression.indexIn(text);
+    // an identifier is a function when it is directly followed by an opening parenthesis, which is only known once the next token is read
+    SqlToken identifier;
+    identifier.length = 0;
 
-    while (startIndex >= 0)
+    while (lexer.next(token))
     {
-        int endIndex = commentEndExpression.indexIn(text, startIndex);
-        int commentLength;
-        if (endIndex == -1)
+        if (identifier.length > 0)
+        {
+            if (token.type == SqlToken::Operator && data[token.start] == QLatin1Char('('))
+                setFormat(identifier.start, identifier.length, functionFormat);
+            identifier.length = 0;
+        }
+
+        switch (token.type)
         {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
+        case SqlToken::LineComment:
+            format = &singleLineCommentFormat;
+            break;
+        case SqlToken::BlockComment:
+            format = &multiLineCommentFormat;
+            break;
+        case SqlToken::String:
+        case SqlToken::Blob:
+            format = &singleQuatationFormat;
+            break;
+        case SqlToken::QuotedIdentifier:
+            format = &quotationFormat;
+            break;
+        case SqlToken::Number:
+            format = &numberFormat;
+            break;
+        case SqlToken::Identifier:
+            if (isKeyword(data, token))
+                format = &keywordFormat;
+            else
+            {
+                identifier = token;
+                format = nullptr;
+            }
+            break;
+        default:
+            format = nullptr;
+            break;
         }
-        else
-            commentLength = endIndex - startIndex + commentEndExpression.matchedLength();
 
-        setFormat(startIndex, commentLength, multiLineCommentFormat);
-        startIndex = commentStartExpression.indexIn(text, startIndex + commentLength);
+        if (format)
+            setFormat(token.start, token.length, *format);
     }
+
+    setCurrentBlockState(lexer.state());
 }
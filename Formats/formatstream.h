@@ -8,6 +8,11 @@ QT_BEGIN_NAMESPACE
 class QTextDocument;
 QT_END_NAMESPACE
 
+/*
+ * Highlights the sql of the editor with the SqlLexer: a single scan of each block, with the keywords looked up in a sorted table, and the state
+ * of the lexer carried from block to block. Only the blocks in view, and a margin of VisibleMargin blocks around them, are highlighted; the
+ * others are only scanned for the state they end in and highlighted once they are scrolled into view.
+ */
 class FormatStream : public QSyntaxHighlighter
 {
     Q_OBJECT
@@ -15,12 +20,24 @@ class FormatStream : public QSyntaxHighlighter
 public:
     FormatStream(QTextDocument *parent = nullptr);
 
+    // blocks above and below the visible ones that are highlighted in advance
+    static const int VisibleMargin = 50;
+
+public slots:
+    void setVisibleBlocks(int first, int last);
+
 protected:
     void highlightBlock(const QString&) Q_DECL_OVERRIDE;
 
 private:
-    QRegExp commentStartExpression;
-    QRegExp commentEndExpression;
+    // block states are SqlLexer::State values, Deferred marks blocks that are waiting to be highlighted
+    enum BlockState
+    {
+        Deferred = 0x100
+    };
+
+    int firstHighlighted = 0;
+    int lastHighlighted = 2 * VisibleMargin;
 
     QTextCharFormat keywordFormat;
     QTextCharFormat numberFormat;
@@ -29,14 +46,6 @@ private:
     QTextCharFormat quotationFormat;
     QTextCharFormat singleQuatationFormat;
     QTextCharFormat functionFormat;
-
-    struct HighlightingRule
-    {
-        QRegExp pattern;
-        QTextCharFormat format;
-    };
-
-    QVector<HighlightingRule> highlightingRules;
 };
 
 #endif // FORMATSTREAM_H
@@ -0,0 +1,62 @@
+#include "highlightbenchmark.h"
+#include "formatstream.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QTextDocument>
+#include <QElapsedTimer>
+
+namespace
+{
+    // best time of a number of rehighlight() passes, in nanoseconds
+    qint64 measure(FormatStream& highlighter, int runs)
+    {
+        qint64 best = -1;
+        for (int i = 0; i < runs; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            highlighter.rehighlight();
+            const qint64 elapsed = timer.nsecsElapsed();
+            if (best < 0 || elapsed < best)
+                best = elapsed;
+        }
+        return best;
+    }
+}
+
+int benchmarkHighlighting(const QString &fileName, int runs)
+{
+    QTextStream out(stdout);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        out << "cannot open " << fileName << ": " << file.errorString() << '\n';
+        return 1;
+    }
+
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+    QTextDocument document;
+    document.setPlainText(in.readAll());
+
+    const int blocks = qMax(1, document.blockCount());
+    const qint64 characters = document.characterCount();
+    FormatStream highlighter(&document);
+
+    // every block in view, the work done for the blocks around the viewport
+    highlighter.setVisibleBlocks(0, blocks);
+    const qint64 full = measure(highlighter, runs);
+
+    // no block in view, the work done for the rest of the document
+    highlighter.setVisibleBlocks(-2 * FormatStream::VisibleMargin, -FormatStream::VisibleMargin - 1);
+    const qint64 deferred = measure(highlighter, runs);
+
+    out << fileName << ": " << blocks << " blocks, " << characters << " characters, best of " << runs << " runs\n";
+    out << "highlighted: " << full / 1000000.0 << " ms, " << full / blocks << " ns per block, "
+        << (full > 0 ? characters * 1000.0 / full : 0.0) << " M characters/s\n";
+    out << "deferred:    " << deferred / 1000000.0 << " ms, " << deferred / blocks << " ns per block, "
+        << (deferred > 0 ? characters * 1000.0 / deferred : 0.0) << " M characters/s\n";
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef HIGHLIGHTBENCHMARK_H
+#define HIGHLIGHTBENCHMARK_H
+
+#include <QString>
+
+/*
+ * Measures the cost of highlighting a script with FormatStream, run as "firelite --benchmark-highlighting script.sql". Prints the time per block
+ * of a full highlighting pass and of a pass over deferred blocks, the best of a few runs, and returns the exit code of the program.
+ */
+int benchmarkHighlighting(const QString& fileName, int runs = 5);
+
+#endif // HIGHLIGHTBENCHMARK_H
@@ -0,0 +1,434 @@
+#include "resultwriter.h"
+#include "Libraries/sqllexer.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QtNumeric>
+
+#include <sqlite3.h>
+#include <zlib.h>
+
+namespace
+{
+    // the buffer goes to the file once it holds this many bytes
+    const int FlushSize = 1 << 20;
+
+    const char HexDigits[] = "0123456789abcdef";
+
+    void appendHex(QByteArray& buffer, const void* data, int size)
+    {
+        const uchar* bytes = static_cast<const uchar*>(data);
+        for (int i = 0; i < size; ++i)
+        {
+            buffer += HexDigits[bytes[i] >> 4];
+            buffer += HexDigits[bytes[i] & 0xf];
+        }
+    }
+
+    // text of an integer or a real column, doubles with enough digits to be read back exactly
+    QByteArray numberText(sqlite3_stmt* statement, int column)
+    {
+        if (sqlite3_column_type(statement, column) == SQLITE_INTEGER)
+            return QByteArray::number(sqlite3_column_int64(statement, column));
+
+        // a whole real keeps its decimal point, so that it reads back as a real
+        QByteArray text = QByteArray::number(sqlite3_column_double(statement, column), 'g', 17);
+        if (!text.contains('.') && !text.contains('e'))
+            text += ".0";
+        return text;
+    }
+}
+
+ResultWriter::ResultWriter(ExportFormat format, const QString &fileName, bool gzip) : format(format), fileName(fileName), gzip(gzip), file(fileName)
+{
+    buffer.reserve(FlushSize + FlushSize / 4);
+}
+
+ResultWriter::~ResultWriter()
+{
+    if (gzipFile)
+        gzclose(static_cast<gzFile>(gzipFile));
+}
+
+void ResultWriter::setInsertOptions(int rows, bool wrapInTransaction)
+{
+    rowsPerInsert = qMax(1, rows);
+    transaction = wrapInTransaction;
+}
+
+bool ResultWriter::open()
+{
+    if (gzip)
+    {
+        gzipFile = gzopen(QFile::encodeName(fileName).constData(), "wb6");
+        if (!gzipFile)
+        {
+            error = QObject::tr("The file could not be created for writing");
+            return false;
+        }
+        gzbuffer(static_cast<gzFile>(gzipFile), 1 << 17);
+        return true;
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ResultWriter::writeHeader(sqlite3_stmt *statement, const QString &table)
+{
+    columnCount = sqlite3_column_count(statement);
+
+    switch (format)
+    {
+    case ExportFormat::Csv:
+    case ExportFormat::Tsv:
+        for (int i = 0; i < columnCount; ++i)
+        {
+            if (i > 0)
+                buffer += format == ExportFormat::Csv ? ',' : '\t';
+
+            const QByteArray name = sqlite3_column_name(statement, i);
+            if (format == ExportFormat::Csv && (name.contains(',') || name.contains('"')))
+                buffer += '"' + QByteArray(name).replace('"', "\"\"") + '"';
+            else
+                buffer += name;
+        }
+        buffer += '\n';
+        break;
+
+    case ExportFormat::JsonLines:
+        keys.clear();
+        for (int i = 0; i < columnCount; ++i)
+        {
+            const char* name = sqlite3_column_name(statement, i);
+            QByteArray key;
+            appendJsonString(key, name, int(qstrlen(name)));
+            keys << key + ':';
+        }
+        break;
+
+    case ExportFormat::SqlInsert:
+    {
+        QStringList columns;
+        for (int i = 0; i < columnCount; ++i)
+            columns << SqlLexer::quoteIdentifier(QString::fromUtf8(sqlite3_column_name(statement, i)));
+        insertPrefix = QString("INSERT INTO %1 (%2) VALUES (").arg(SqlLexer::quoteIdentifier(table), columns.join(", ")).toUtf8();
+
+        // a single transaction, so that running the file back doesn't sync once per row
+        if (transaction)
+            buffer += "BEGIN TRANSACTION;\n";
+        break;
+    }
+    }
+
+    return buffer.size() < FlushSize || flush();
+}
+
+bool ResultWriter::writeRow(sqlite3_stmt *statement)
+{
+    switch (format)
+    {
+    case ExportFormat::Csv:
+        for (int i = 0; i < columnCount; ++i)
+        {
+            if (i > 0)
+                buffer += ',';
+            appendCsvField(statement, i, ',');
+        }
+        buffer += '\n';
+        break;
+
+    case ExportFormat::Tsv:
+        for (int i = 0; i < columnCount; ++i)
+        {
+            if (i > 0)
+                buffer += '\t';
+            appendTsvField(statement, i);
+        }
+        buffer += '\n';
+        break;
+
+    case ExportFormat::JsonLines:
+        buffer += '{';
+        for (int i = 0; i < columnCount; ++i)
+        {
+            if (i > 0)
+                buffer += ',';
+            buffer += keys.at(i);
+            appendJsonValue(statement, i);
+        }
+        buffer += "}\n";
+        break;
+
+    case ExportFormat::SqlInsert:
+        buffer += rowsInInsert == 0 ? insertPrefix : QByteArray(",\n(");
+        for (int i = 0; i < columnCount; ++i)
+        {
+            if (i > 0)
+                buffer += ", ";
+            appendSqlValue(statement, i);
+        }
+        buffer += ')';
+
+        // the statement ends once it holds enough rows, or grew large enough on its own
+        if (++rowsInInsert >= rowsPerInsert || buffer.size() >= FlushSize)
+        {
+            buffer += ";\n";
+            rowsInInsert = 0;
+        }
+        break;
+    }
+
+    return buffer.size() < FlushSize || flush();
+}
+
+bool ResultWriter::finish()
+{
+    if (rowsInInsert > 0)
+        buffer += ";\n";
+    if (format == ExportFormat::SqlInsert && transaction)
+        buffer += "COMMIT;\n";
+
+    if (!flush())
+        return false;
+
+    if (gzip)
+    {
+        const int result = gzclose(static_cast<gzFile>(gzipFile));
+        gzipFile = nullptr;
+        if (result != Z_OK)
+        {
+            error = QObject::tr("The compressed file could not be completed");
+            return false;
+        }
+        return true;
+    }
+
+    file.close();
+    if (file.error() != QFileDevice::NoError)
+    {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void ResultWriter::discard()
+{
+    if (gzipFile)
+    {
+        gzclose(static_cast<gzFile>(gzipFile));
+        gzipFile = nullptr;
+    }
+    file.close();
+    QFile::remove(fileName);
+}
+
+qint64 ResultWriter::bytesWritten() const
+{
+    if (gzip)
+        return gzipFile ? qint64(gzoffset(static_cast<gzFile>(gzipFile))) : QFile(fileName).size();
+    return file.isOpen() ? file.pos() : file.size();
+}
+
+bool ResultWriter::flush()
+{
+    if (buffer.isEmpty())
+        return true;
+
+    if (gzip)
+    {
+        if (gzwrite(static_cast<gzFile>(gzipFile), buffer.constData(), unsigned(buffer.size())) != buffer.size())
+        {
+            int code = Z_OK;
+            error = QString::fromUtf8(gzerror(static_cast<gzFile>(gzipFile), &code));
+            return false;
+        }
+    }
+    else if (file.write(buffer) != buffer.size())
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    buffer.resize(0);
+    return true;
+}
+
+/*
+ * RFC 4180: fields holding the separator, a quote or a line break are quoted, with their quotes doubled. NULL is an empty field, blobs are
+ * written as hex.
+ */
+void ResultWriter::appendCsvField(sqlite3_stmt *statement, int column, char separator)
+{
+    switch (sqlite3_column_type(statement, column))
+    {
+    case SQLITE_NULL:
+        return;
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+        buffer += numberText(statement, column);
+        return;
+    case SQLITE_BLOB:
+        appendHex(buffer, sqlite3_column_blob(statement, column), sqlite3_column_bytes(statement, column));
+        return;
+    }
+
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+    const int size = sqlite3_column_bytes(statement, column);
+
+    bool quote = false;
+    for (int i = 0; i < size && !quote; ++i)
+        quote = text[i] == separator || text[i] == '"' || text[i] == '\n' || text[i] == '\r';
+
+    if (!quote)
+    {
+        buffer.append(text, size);
+        return;
+    }
+
+    buffer += '"';
+    for (int i = 0; i < size; ++i)
+    {
+        if (text[i] == '"')
+            buffer += '"';
+        buffer += text[i];
+    }
+    buffer += '"';
+}
+
+/*
+ * Tab separated values as most databases read them: tabs, line breaks and backslashes are escaped with a backslash, NULL is \N.
+ */
+void ResultWriter::appendTsvField(sqlite3_stmt *statement, int column)
+{
+    switch (sqlite3_column_type(statement, column))
+    {
+    case SQLITE_NULL:
+        buffer += "\\N";
+        return;
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+        buffer += numberText(statement, column);
+        return;
+    case SQLITE_BLOB:
+        appendHex(buffer, sqlite3_column_blob(statement, column), sqlite3_column_bytes(statement, column));
+        return;
+    }
+
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+    const int size = sqlite3_column_bytes(statement, column);
+    for (int i = 0; i < size; ++i)
+    {
+        switch (text[i])
+        {
+        case '\t': buffer += "\\t"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\r': buffer += "\\r"; break;
+        case '\\': buffer += "\\\\"; break;
+        default: buffer += text[i];
+        }
+    }
+}
+
+/*
+ * Numbers stay numbers, except the infinite ones JSON has no notation for. Blobs become base64 strings.
+ */
+void ResultWriter::appendJsonValue(sqlite3_stmt *statement, int column)
+{
+    switch (sqlite3_column_type(statement, column))
+    {
+    case SQLITE_NULL:
+        buffer += "null";
+        return;
+    case SQLITE_INTEGER:
+        buffer += numberText(statement, column);
+        return;
+    case SQLITE_FLOAT:
+    {
+        const double value = sqlite3_column_double(statement, column);
+        buffer += qIsFinite(value) ? numberText(statement, column) : QByteArray("null");
+        return;
+    }
+    case SQLITE_BLOB:
+    {
+        const QByteArray blob = QByteArray::fromRawData(static_cast<const char*>(sqlite3_column_blob(statement, column)), sqlite3_column_bytes(statement, column));
+        buffer += '"' + blob.toBase64() + '"';
+        return;
+    }
+    }
+
+    appendJsonString(buffer, reinterpret_cast<const char*>(sqlite3_column_text(statement, column)), sqlite3_column_bytes(statement, column));
+}
+
+void ResultWriter::appendJsonString(QByteArray &out, const char *text, int size)
+{
+    out += '"';
+    for (int i = 0; i < size; ++i)
+    {
+        const uchar c = uchar(text[i]);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20)
+            {
+                out += "\\u00";
+                out += HexDigits[c >> 4];
+                out += HexDigits[c & 0xf];
+            }
+            else
+                out += char(c);
+        }
+    }
+    out += '"';
+}
+
+/*
+ * SQL literals that read back to the same values: quoted text with doubled quotes, X'' blobs, NULL.
+ */
+void ResultWriter::appendSqlValue(sqlite3_stmt *statement, int column)
+{
+    switch (sqlite3_column_type(statement, column))
+    {
+    case SQLITE_NULL:
+        buffer += "NULL";
+        return;
+    case SQLITE_INTEGER:
+        buffer += numberText(statement, column);
+        return;
+    case SQLITE_FLOAT:
+    {
+        const double value = sqlite3_column_double(statement, column);
+        if (qIsFinite(value))
+            buffer += numberText(statement, column);
+        else
+            buffer += qIsNaN(value) ? "NULL" : value > 0 ? "9e999" : "-9e999";
+        return;
+    }
+    case SQLITE_BLOB:
+        buffer += "X'";
+        appendHex(buffer, sqlite3_column_blob(statement, column), sqlite3_column_bytes(statement, column));
+        buffer += '\'';
+        return;
+    }
+
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(statement, column));
+    const int size = sqlite3_column_bytes(statement, column);
+    buffer += '\'';
+    for (int i = 0; i < size; ++i)
+    {
+        if (text[i] == '\'')
+            buffer += '\'';
+        buffer += text[i];
+    }
+    buffer += '\'';
+}
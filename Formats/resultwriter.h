@@ -0,0 +1,73 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+
+#include "Database/resultexport.h"
+
+struct sqlite3_stmt;
+
+/*
+ * Writes the rows of a prepared statement into a file in one of the export formats, one row at a time straight from the columns of the
+ * statement. The rows are formatted into a buffer that is handed to the file, or to gzip, a megabyte at a time, so the memory used doesn't
+ * depend on the number of rows.
+ */
+class ResultWriter
+{
+public:
+    ResultWriter(ExportFormat format, const QString& fileName, bool gzip);
+    ~ResultWriter();
+
+    // SqlInsert only: rows per INSERT statement, and whether the statements are wrapped in a transaction; one row and a transaction by default
+    void setInsertOptions(int rowsPerInsert, bool transaction);
+
+    bool open();
+
+    // once, before the first row: the header line of CSV and TSV, the keys of JSON Lines, the INSERT prefix of SQL
+    bool writeHeader(sqlite3_stmt* statement, const QString& table);
+
+    // the current row of the statement, as stepped by the caller
+    bool writeRow(sqlite3_stmt* statement);
+
+    // flushes the buffer and closes the file
+    bool finish();
+
+    // removes the half written file of a failed or cancelled export
+    void discard();
+
+    QString errorString() const { return error; }
+
+    // bytes that reached the file, compressed ones for gzip
+    qint64 bytesWritten() const;
+
+private:
+    ExportFormat format;
+    QString fileName;
+    bool gzip;
+
+    QFile file;
+    void* gzipFile = nullptr;
+
+    QByteArray buffer;
+    QString error;
+
+    int columnCount = 0;
+
+    // JSON keys with their quotes and colon, and the INSERT prefix, built once by writeHeader
+    QVector<QByteArray> keys;
+    QByteArray insertPrefix;
+    int rowsPerInsert = 1;
+    int rowsInInsert = 0;
+    bool transaction = true;
+
+    bool flush();
+    void appendCsvField(sqlite3_stmt* statement, int column, char separator);
+    void appendTsvField(sqlite3_stmt* statement, int column);
+    void appendJsonValue(sqlite3_stmt* statement, int column);
+    void appendSqlValue(sqlite3_stmt* statement, int column);
+    static void appendJsonString(QByteArray& out, const char* text, int size);
+};
+
+#endif // RESULTWRITER_H
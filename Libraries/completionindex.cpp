@@ -0,0 +1,136 @@
+#include "completionindex.h"
+
+#include <algorithm>
+
+void CompletionIndex::apply(const SchemaDelta &delta)
+{
+    if (delta.reset)
+    {
+        objects.clear();
+        functions = delta.functions;
+    }
+
+    foreach (const QString& name, delta.removed)
+        objects.remove(name.toCaseFolded());
+
+    foreach (const SchemaObject& object, delta.changed)
+        objects.insert(object.name.toCaseFolded(), object);
+
+    dirty = true;
+}
+
+void CompletionIndex::clear()
+{
+    objects.clear();
+    functions.clear();
+    dirty = true;
+}
+
+QStringList CompletionIndex::columns(const QString &table) const
+{
+    return objects.value(table.toCaseFolded()).columns;
+}
+
+QString CompletionIndex::tableName(const QString &name) const
+{
+    const auto it = objects.constFind(name.toCaseFolded());
+    if (it == objects.constEnd() || (it->type != "table" && it->type != "view"))
+        return QString();
+    return it->name;
+}
+
+/*
+ * Appends a name to the arena. Names longer than 65535 characters are not worth completing and are left out.
+ */
+void CompletionIndex::add(const QString &name, int kind) const
+{
+    const QString key = name.toCaseFolded();
+    if (name.isEmpty() || name.size() > 0xffff || key.size() > 0xffff)
+        return;
+
+    Entry entry;
+    entry.key = keys.size();
+    entry.name = names.size();
+    entry.length = quint16(key.size());
+    entry.nameLength = quint16(name.size());
+    entry.kind = kind;
+    entries << entry;
+
+    keys += key;
+    names += name;
+}
+
+/*
+ * Lays out every name of the schema in the arena and sorts the entries by their case folded name, then by the name as written, so that equal
+ * names are next to each other.
+ */
+void CompletionIndex::rebuild() const
+{
+    keys.clear();
+    names.clear();
+    entries.clear();
+
+    int columnCount = 0;
+    foreach (const SchemaObject& object, objects)
+        columnCount += object.columns.size();
+    entries.reserve(objects.size() + columnCount + functions.size());
+
+    foreach (const SchemaObject& object, objects)
+    {
+        if (object.type == "table")
+            add(object.name, Table);
+        else if (object.type == "view")
+            add(object.name, View);
+        else if (object.type == "index")
+            add(object.name, Index);
+        else if (object.type == "trigger")
+            add(object.name, Trigger);
+
+        foreach (const QString& column, object.columns)
+            add(column, Column);
+    }
+
+    foreach (const QString& function, functions)
+        add(function, Function);
+
+    std::sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b)
+    {
+        const int order = keys.midRef(a.key, a.length).compare(keys.midRef(b.key, b.length));
+        if (order != 0)
+            return order < 0;
+        return names.midRef(a.name, a.nameLength).compare(names.midRef(b.name, b.nameLength)) < 0;
+    });
+
+    dirty = false;
+}
+
+QStringList CompletionIndex::complete(const QString &prefix, int kinds, int limit) const
+{
+    if (dirty)
+        rebuild();
+
+    const QString key = prefix.toCaseFolded();
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), key, [this](const Entry& entry, const QString& k)
+    {
+        return keys.midRef(entry.key, entry.length).compare(k) < 0;
+    });
+
+    QStringList result;
+    QStringRef previous;
+    for (; it != entries.cend() && result.size() < limit; ++it)
+    {
+        if (!keys.midRef(it->key, it->length).startsWith(key))
+            break;
+        if (!(it->kind & kinds))
+            continue;
+
+        // a column that many tables have is offered once
+        const QStringRef name = names.midRef(it->name, it->nameLength);
+        if (name == previous)
+            continue;
+
+        result << name.toString();
+        previous = name;
+    }
+    return result;
+}
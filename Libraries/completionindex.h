@@ -0,0 +1,68 @@
+#ifndef COMPLETIONINDEX_H
+#define COMPLETIONINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+#include "Database/schemainfo.h"
+
+/*
+ * Names of a database to complete in the editor: its tables, views, columns, indexes, triggers and functions. The schema is kept by object, so a
+ * SchemaDelta after a DDL statement only replaces the objects it names. Lookups go through a sorted arena: every name is stored once, case
+ * folded and as written, in two long strings, and a sorted vector of small entries points into them, so that a prefix is found by binary search
+ * whatever the size of the schema.
+ */
+class CompletionIndex
+{
+public:
+    enum Kind
+    {
+        Table = 0x01,
+        View = 0x02,
+        Column = 0x04,
+        Index = 0x08,
+        Trigger = 0x10,
+        Function = 0x20,
+        AnyKind = 0x3f
+    };
+
+    // applies the changes of the schema reported by the query engine, a reset delta replaces everything
+    void apply(const SchemaDelta& delta);
+    void clear();
+
+    // names of the given kinds that start with prefix, ignoring case, each name once and in case insensitive order, at most limit of them
+    QStringList complete(const QString& prefix, int kinds = AnyKind, int limit = 200) const;
+
+    // columns of a table or a view, in the order of its definition, ignoring the case of the name
+    QStringList columns(const QString& table) const;
+
+    // the name of a table or a view as written in the schema, empty if there is none with that name
+    QString tableName(const QString& name) const;
+
+private:
+    struct Entry
+    {
+        int key;
+        int name;
+        quint16 length;
+        quint16 nameLength;
+        int kind;
+    };
+
+    // schema by the case folded name of each object
+    QHash<QString, SchemaObject> objects;
+    QStringList functions;
+
+    // the arena, rebuilt on the first lookup after a change
+    mutable QString keys;
+    mutable QString names;
+    mutable QVector<Entry> entries;
+    mutable bool dirty = true;
+
+    void rebuild() const;
+    void add(const QString& name, int kind) const;
+};
+
+#endif // COMPLETIONINDEX_H
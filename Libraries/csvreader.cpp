@@ -0,0 +1,114 @@
+#include "csvreader.h"
+
+#include <algorithm>
+#include <cstring>
+
+CsvReader::CsvReader(const char *d, qint64 s, char separator) : data(d), size(s), separator(separator)
+{
+    // byte order mark
+    if (size >= 3 && uchar(data[0]) == 0xef && uchar(data[1]) == 0xbb && uchar(data[2]) == 0xbf)
+        pos = 3;
+
+    std::fill(stops, stops + 256, false);
+    stops[uchar(separator)] = true;
+    stops[uchar('\n')] = true;
+    stops[uchar('\r')] = true;
+}
+
+bool CsvReader::readRow(QStringList &fields)
+{
+    fields.clear();
+    if (!readFields(buffer))
+        return false;
+
+    foreach (const QByteArray& field, buffer)
+        fields << QString::fromUtf8(field);
+    return true;
+}
+
+bool CsvReader::readFields(QVector<QByteArray> &fields)
+{
+    fields.clear();
+    if (pos >= size)
+        return false;
+
+    for (;;)
+    {
+        if (pos < size && data[pos] == '"')
+        {
+            // quoted field, runs up to the quote that is not doubled; copied a stretch between two quotes at a time
+            QByteArray field;
+            ++pos;
+            while (pos < size)
+            {
+                const char* quote = static_cast<const char*>(memchr(data + pos, '"', size_t(size - pos)));
+                const qint64 end = quote ? quote - data : size;
+                field.append(data + pos, int(end - pos));
+                pos = end + 1;
+
+                if (pos < size && data[pos] == '"')
+                {
+                    field += '"';
+                    ++pos;
+                }
+                else
+                    break;
+            }
+            pos = qMin(pos, size);
+
+            // anything between the closing quote and the separator is kept, as most spreadsheets do
+            while (pos < size && !stops[uchar(data[pos])])
+                field += data[pos++];
+
+            fields << field;
+        }
+        else
+        {
+            const qint64 start = pos;
+            while (pos < size && !stops[uchar(data[pos])])
+                ++pos;
+            fields << QByteArray::fromRawData(data + start, int(pos - start));
+        }
+
+        if (pos < size && data[pos] == separator)
+        {
+            ++pos;
+            continue;
+        }
+
+        // end of the record, \n, \r\n or the end of the text
+        if (pos < size && data[pos] == '\r')
+            ++pos;
+        if (pos < size && data[pos] == '\n')
+            ++pos;
+        return true;
+    }
+}
+
+char CsvReader::detectSeparator(const char *data, qint64 size)
+{
+    int tabs = 0, semicolons = 0, commas = 0;
+    bool quoted = false;
+    for (qint64 i = 0; i < size; ++i)
+    {
+        const char c = data[i];
+        if (c == '"')
+            quoted = !quoted;
+        else if (quoted)
+            continue;
+        else if (c == '\n')
+            break;
+        else if (c == '\t')
+            ++tabs;
+        else if (c == ';')
+            ++semicolons;
+        else if (c == ',')
+            ++commas;
+    }
+
+    if (tabs > 0 && tabs >= semicolons && tabs >= commas)
+        return '\t';
+    if (semicolons > commas)
+        return ';';
+    return ',';
+}
@@ -0,0 +1,40 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+
+/*
+ * Reads comma separated values (RFC 4180) from UTF-8 text in memory: fields may be quoted, quoted fields may contain separators, line breaks and
+ * doubled quotes. The reader doesn't copy the text, so it works just as well on a memory mapped file as on a QByteArray, which must outlive it.
+ */
+class CsvReader
+{
+public:
+    CsvReader(const char* data, qint64 size, char separator = ',');
+
+    // reads the next record, returns false at the end of the text
+    bool readRow(QStringList& fields);
+
+    // reads the next record as raw UTF-8; unquoted fields point into the text instead of being copied, so they are only valid as long as it is
+    bool readFields(QVector<QByteArray>& fields);
+
+    // offset of the next record in the text
+    qint64 position() const { return pos; }
+
+    // guesses the separator from the first line of the text: a tab, a semicolon or a comma
+    static char detectSeparator(const char* data, qint64 size);
+
+private:
+    const char* data;
+    qint64 size;
+    qint64 pos = 0;
+    char separator;
+
+    // bytes that end an unquoted field, looked up once per byte while scanning
+    bool stops[256];
+    QVector<QByteArray> buffer;
+};
+
+#endif // CSVREADER_H
@@ -0,0 +1,278 @@
+#include "sqlcompletion.h"
+#include "sqllexer.h"
+
+#include <QVector>
+
+namespace
+{
+    // keywords that end a table reference, so they are never taken for an alias
+    const char* const ClauseKeywords[] =
+    {
+        "WHERE", "JOIN", "LEFT", "RIGHT", "FULL", "INNER", "OUTER", "CROSS", "NATURAL", "ON", "USING", "GROUP", "ORDER", "HAVING", "LIMIT",
+        "UNION", "EXCEPT", "INTERSECT", "WINDOW", "SET", "VALUES", "SELECT", "FROM", "AS", "INDEXED", "NOT", "RETURNING", "DEFAULT", "WHEN",
+        "THEN", "DO", "ADD", "RENAME", "DROP", "BEGIN", "FOR", "INSTEAD", "BEFORE", "AFTER"
+    };
+
+    // keywords after which a list of columns or expressions follows
+    const char* const ColumnKeywords[] =
+    {
+        "SELECT", "WHERE", "SET", "BY", "HAVING", "RETURNING", "USING", "DISTINCT", "AND", "OR", "NOT", "WHEN", "THEN", "ELSE", "CASE"
+    };
+
+    // keywords after which a table name follows
+    const char* const TableKeywords[] = { "FROM", "JOIN", "INTO", "UPDATE", "TABLE" };
+
+    template <int N>
+    bool isOneOf(const QChar* data, const SqlToken& token, const char* const (&keywords)[N])
+    {
+        for (const char* keyword : keywords)
+        {
+            if (SqlLexer::equals(data, token, keyword))
+                return true;
+        }
+        return false;
+    }
+
+    // the name an identifier token stands for, without its quotes
+    QString nameOf(const QString& text, const SqlToken& token)
+    {
+        if (token.type != SqlToken::QuotedIdentifier)
+            return text.mid(token.start, token.length);
+
+        const QChar open = text.at(token.start);
+        const QChar close = open == QLatin1Char('[') ? QLatin1Char(']') : open;
+        QString name = text.mid(token.start + 1, token.length - (token.terminated ? 2 : 1));
+        if (close != QLatin1Char(']'))
+            name.replace(QString(2, close), QString(close));
+        return name;
+    }
+
+    bool isName(const SqlToken& token)
+    {
+        return token.type == SqlToken::Identifier || token.type == SqlToken::QuotedIdentifier;
+    }
+}
+
+SqlCompletionContext SqlCompletionParser::parse(const QString &statement, int position)
+{
+    SqlCompletionContext context;
+    const QChar* data = statement.constData();
+
+    QVector<SqlToken> tokens;
+    SqlLexer lexer(statement);
+    SqlToken token;
+    while (lexer.next(token))
+    {
+        if (token.isSignificant())
+            tokens << token;
+    }
+
+    // the word being typed is the name token that ends at the cursor
+    int prefixStart = position;
+    for (const SqlToken& t : tokens)
+    {
+        if (isName(t) && t.start < position && t.start + t.length >= position)
+        {
+            prefixStart = t.start;
+            context.prefix = statement.mid(t.start, position - t.start);
+            if (t.type == SqlToken::QuotedIdentifier)
+                context.prefix.remove(0, 1);
+            break;
+        }
+    }
+
+    enum State
+    {
+        Other,
+        ColumnList,
+        TableName,      // a table name comes next
+        AfterTable,     // a table name was read, an alias, a comma or a clause may follow
+        AliasName       // AS was read after a table name
+    };
+
+    State state = Other;
+    QString pendingSchema;
+    bool indexSeen = false;
+    bool intoSeen = false;
+    bool inFromList = false;
+
+    // the state before the word at the cursor tells what the word may be
+    auto decide = [&](int index)
+    {
+        const SqlToken* previous = index > 0 ? &tokens.at(index - 1) : nullptr;
+        const SqlToken* beforeDot = index > 1 ? &tokens.at(index - 2) : nullptr;
+        if (state == TableName)
+        {
+            context.expect = SqlCompletionContext::Table;
+            context.schema = pendingSchema;
+        }
+        else if (previous && previous->type == SqlToken::Operator && data[previous->start] == QLatin1Char('.') && beforeDot && isName(*beforeDot))
+        {
+            context.expect = SqlCompletionContext::QualifiedColumn;
+            context.qualifier = nameOf(statement, *beforeDot);
+
+            // schema.table.column
+            const SqlToken* schemaDot = index > 2 ? &tokens.at(index - 3) : nullptr;
+            const SqlToken* schemaName = index > 3 ? &tokens.at(index - 4) : nullptr;
+            if (schemaDot && schemaDot->type == SqlToken::Operator && data[schemaDot->start] == QLatin1Char('.') && schemaName && isName(*schemaName))
+                context.schema = nameOf(statement, *schemaName);
+        }
+        else if (state == ColumnList)
+            context.expect = SqlCompletionContext::Column;
+    };
+
+    int cursorIndex = tokens.size();
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens.at(i).start >= prefixStart)
+        {
+            cursorIndex = i;
+            break;
+        }
+    }
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        const SqlToken& t = tokens.at(i);
+        if (i == cursorIndex)
+            decide(i);
+
+        // the word being typed is not a table or an alias yet
+        if (t.start == prefixStart && !context.prefix.isNull())
+            continue;
+
+        if (t.type == SqlToken::Identifier && SqlLexer::equals(data, t, "INDEX"))
+            indexSeen = true;
+
+        switch (state)
+        {
+        case TableName:
+            if (isName(t))
+            {
+                context.tables << nameOf(statement, t);
+                context.schemas << pendingSchema;
+                pendingSchema.clear();
+                state = AfterTable;
+                continue;
+            }
+            if (t.type == SqlToken::Operator && data[t.start] == QLatin1Char('('))
+            {
+                // a subquery or a table valued function, its own FROM is read as usual
+                pendingSchema.clear();
+                state = Other;
+                continue;
+            }
+            break;
+
+        case AfterTable:
+            if (t.type == SqlToken::Operator && data[t.start] == QLatin1Char('.'))
+            {
+                // schema.table, the table follows
+                if (!context.tables.isEmpty())
+                {
+                    pendingSchema = context.tables.takeLast();
+                    context.schemas.removeLast();
+                }
+                state = TableName;
+                continue;
+            }
+            if (t.type == SqlToken::Operator && data[t.start] == QLatin1Char(','))
+            {
+                state = inFromList ? TableName : Other;
+                continue;
+            }
+            if (SqlLexer::equals(data, t, "AS"))
+            {
+                state = AliasName;
+                continue;
+            }
+            if (intoSeen && t.type == SqlToken::Operator && data[t.start] == QLatin1Char('('))
+            {
+                // INSERT INTO table (columns
+                state = ColumnList;
+                continue;
+            }
+            if (isName(t) && !isOneOf(data, t, ClauseKeywords))
+            {
+                context.aliases.insert(nameOf(statement, t).toCaseFolded(), context.tables.size() - 1);
+                state = Other;
+                continue;
+            }
+            break;
+
+        case AliasName:
+            if (isName(t))
+            {
+                context.aliases.insert(nameOf(statement, t).toCaseFolded(), context.tables.size() - 1);
+                state = Other;
+                continue;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (t.type != SqlToken::Identifier)
+        {
+            // a comma after an alias goes on with the FROM list
+            if (inFromList && t.type == SqlToken::Operator && data[t.start] == QLatin1Char(','))
+                state = TableName;
+            else if (state == AfterTable || state == AliasName)
+                state = Other;
+            continue;
+        }
+
+        if (isOneOf(data, t, TableKeywords))
+        {
+            inFromList = SqlLexer::equals(data, t, "FROM");
+            intoSeen = SqlLexer::equals(data, t, "INTO");
+            pendingSchema.clear();
+            state = TableName;
+        }
+        else if (SqlLexer::equals(data, t, "ON"))
+        {
+            // CREATE INDEX name ON table, otherwise the condition of a join
+            state = indexSeen ? TableName : ColumnList;
+            indexSeen = false;
+            inFromList = false;
+        }
+        else if (isOneOf(data, t, ColumnKeywords))
+        {
+            state = ColumnList;
+            inFromList = false;
+        }
+        else if (isOneOf(data, t, ClauseKeywords))
+        {
+            // joins go on with the FROM list until their table
+            if (!SqlLexer::equals(data, t, "LEFT") && !SqlLexer::equals(data, t, "RIGHT") && !SqlLexer::equals(data, t, "FULL")
+                    && !SqlLexer::equals(data, t, "INNER") && !SqlLexer::equals(data, t, "OUTER") && !SqlLexer::equals(data, t, "CROSS")
+                    && !SqlLexer::equals(data, t, "NATURAL"))
+            {
+                state = Other;
+                inFromList = false;
+            }
+        }
+    }
+
+    if (cursorIndex == tokens.size())
+        decide(cursorIndex);
+
+    // an alias or a table of the statement stands for the table it names, in the schema it was qualified with
+    if (context.expect == SqlCompletionContext::QualifiedColumn && context.schema.isEmpty())
+    {
+        int table = context.aliases.value(context.qualifier.toCaseFolded(), -1);
+        for (int i = 0; table < 0 && i < context.tables.size(); ++i)
+        {
+            if (context.tables.at(i).compare(context.qualifier, Qt::CaseInsensitive) == 0)
+                table = i;
+        }
+        if (table >= 0)
+        {
+            context.qualifier = context.tables.at(table);
+            context.schema = context.schemas.at(table);
+        }
+    }
+
+    return context;
+}
@@ -0,0 +1,49 @@
+#ifndef SQLCOMPLETION_H
+#define SQLCOMPLETION_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+// What the word at the cursor of the editor may be, worked out by SqlCompletionParser from the statement around it
+struct SqlCompletionContext
+{
+    enum Expect
+    {
+        Anything,
+        Table,              // after FROM, JOIN, INTO, UPDATE, TABLE and the ON of CREATE INDEX
+        Column,             // in the select list, WHERE, ON, SET, GROUP BY, ORDER BY, HAVING and the like
+        QualifiedColumn     // after name. where name is a table or an alias
+    };
+
+    Expect expect = Anything;
+
+    // the word being typed, up to the cursor
+    QString prefix;
+
+    // for QualifiedColumn, the table before the dot with aliases resolved
+    QString qualifier;
+
+    // the schema the word belongs to: for Table the one before the dot, for QualifiedColumn the one of the qualifier. Empty when the name isn't
+    // qualified, which means the main database or, for a QualifiedColumn, that the qualifier may be a schema itself
+    QString schema;
+
+    // tables the statement reads or writes, in order, with the schema each was qualified with, and the index of the table of each alias by the
+    // case folded alias
+    QStringList tables;
+    QStringList schemas;
+    QHash<QString, int> aliases;
+};
+
+/*
+ * Parses a single statement just enough to help the completion: the clause the cursor is in, the tables the statement refers to and their
+ * aliases, anywhere in the statement, so that a column list can be completed before its FROM clause is written. It works on the tokens of the
+ * SqlLexer and doesn't validate anything; incomplete statements, which is what the editor has while typing, are the normal case.
+ */
+class SqlCompletionParser
+{
+public:
+    static SqlCompletionContext parse(const QString& statement, int position);
+};
+
+#endif // SQLCOMPLETION_H
@@ -0,0 +1,502 @@
+#include "sqllexer.h"
+
+namespace
+{
+    inline bool isIdentifierStart(QChar c)
+    {
+        return c.isLetter() || c == QLatin1Char('_') || c.unicode() > 0x7f;
+    }
+
+    inline bool isIdentifierPart(QChar c)
+    {
+        return isIdentifierStart(c) || c.isDigit() || c == QLatin1Char('$');
+    }
+
+    inline bool isDigit(QChar c)
+    {
+        return c.unicode() >= '0' && c.unicode() <= '9';
+    }
+
+    inline bool isHexDigit(QChar c)
+    {
+        const ushort u = c.unicode();
+        return isDigit(c) || (u >= 'a' && u <= 'f') || (u >= 'A' && u <= 'F');
+    }
+}
+
+SqlLexer::SqlLexer(const QString &text, State state) : data(text.constData()), length(text.length()), currentState(state)
+{
+}
+
+SqlLexer::SqlLexer(const QChar *d, int l, State state) : data(d), length(l), currentState(state)
+{
+}
+
+bool SqlLexer::equals(const QChar *data, const SqlToken &token, const char *keyword)
+{
+    if (token.type != SqlToken::Identifier)
+        return false;
+
+    int i = 0;
+    for (; i < token.length; ++i)
+    {
+        const char k = keyword[i];
+        if (k == '\0')
+            return false;
+
+        ushort c = data[token.start + i].unicode();
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        if (c != ushort(k))
+            return false;
+    }
+
+    return keyword[i] == '\0';
+}
+
+/*
+ * Scans a quoted construct starting at the current position. The opening quote has already been consumed unless the lexer resumes in the middle
+ * of it. Doubled closing quotes are escapes in sqlite, except for [brackets].
+ */
+bool SqlLexer::scanQuoted(SqlToken &token, QChar close, SqlToken::Type type, State openState)
+{
+    token.type = type;
+    while (position < length)
+    {
+        if (data[position] == close)
+        {
+            if (close != QLatin1Char(']') && position + 1 < length && data[position + 1] == close)
+            {
+                position += 2;
+                continue;
+            }
+
+            ++position;
+            token.length = position - token.start;
+            token.terminated = true;
+            currentState = Normal;
+            return true;
+        }
+        ++position;
+    }
+
+    token.length = position - token.start;
+    token.terminated = false;
+    currentState = openState;
+    return true;
+}
+
+bool SqlLexer::scanBlockComment(SqlToken &token)
+{
+    token.type = SqlToken::BlockComment;
+    while (position < length)
+    {
+        if (data[position] == QLatin1Char('*') && position + 1 < length && data[position + 1] == QLatin1Char('/'))
+        {
+            position += 2;
+            token.length = position - token.start;
+            token.terminated = true;
+            currentState = Normal;
+            return true;
+        }
+        ++position;
+    }
+
+    token.length = position - token.start;
+    token.terminated = false;
+    currentState = InBlockComment;
+    return true;
+}
+
+bool SqlLexer::next(SqlToken &token)
+{
+    if (position >= length)
+        return false;
+
+    token.start = position;
+    token.terminated = true;
+
+    // resume a construct that was left open at the end of the previous chunk
+    switch (currentState)
+    {
+    case InBlockComment:
+        return scanBlockComment(token);
+    case InString:
+        return scanQuoted(token, QLatin1Char('\''), SqlToken::String, InString);
+    case InDoubleQuote:
+        return scanQuoted(token, QLatin1Char('"'), SqlToken::QuotedIdentifier, InDoubleQuote);
+    case InBacktick:
+        return scanQuoted(token, QLatin1Char('`'), SqlToken::QuotedIdentifier, InBacktick);
+    case InBracket:
+        return scanQuoted(token, QLatin1Char(']'), SqlToken::QuotedIdentifier, InBracket);
+    case Normal:
+        break;
+    }
+
+    const QChar c = data[position];
+    const QChar n = position + 1 < length ? data[position + 1] : QChar();
+
+    if (c.isSpace())
+    {
+        while (position < length && data[position].isSpace())
+            ++position;
+        token.type = SqlToken::Whitespace;
+        token.length = position - token.start;
+        return true;
+    }
+
+    if (c == QLatin1Char('-') && n == QLatin1Char('-'))
+    {
+        while (position < length && data[position] != QLatin1Char('\n'))
+            ++position;
+        token.type = SqlToken::LineComment;
+        token.length = position - token.start;
+        return true;
+    }
+
+    if (c == QLatin1Char('/') && n == QLatin1Char('*'))
+    {
+        position += 2;
+        return scanBlockComment(token);
+    }
+
+    switch (c.unicode())
+    {
+    case '\'':
+        ++position;
+        return scanQuoted(token, QLatin1Char('\''), SqlToken::String, InString);
+    case '"':
+        ++position;
+        return scanQuoted(token, QLatin1Char('"'), SqlToken::QuotedIdentifier, InDoubleQuote);
+    case '`':
+        ++position;
+        return scanQuoted(token, QLatin1Char('`'), SqlToken::QuotedIdentifier, InBacktick);
+    case '[':
+        ++position;
+        return scanQuoted(token, QLatin1Char(']'), SqlToken::QuotedIdentifier, InBracket);
+    case ';':
+        ++position;
+        token.type = SqlToken::Semicolon;
+        token.length = 1;
+        return true;
+    default:
+        break;
+    }
+
+    // blob literal x'...'
+    if ((c == QLatin1Char('x') || c == QLatin1Char('X')) && n == QLatin1Char('\''))
+    {
+        position += 2;
+        scanQuoted(token, QLatin1Char('\''), SqlToken::Blob, InString);
+        return true;
+    }
+
+    // numbers: 12, 1.5, .5, 1e10, 0x1F
+    if (isDigit(c) || (c == QLatin1Char('.') && isDigit(n)))
+    {
+        token.type = SqlToken::Number;
+        if (c == QLatin1Char('0') && (n == QLatin1Char('x') || n == QLatin1Char('X')))
+        {
+            position += 2;
+            while (position < length && isHexDigit(data[position]))
+                ++position;
+        }
+        else
+        {
+            while (position < length && isDigit(data[position]))
+                ++position;
+            if (position < length && data[position] == QLatin1Char('.'))
+            {
+                ++position;
+                while (position < length && isDigit(data[position]))
+                    ++position;
+            }
+            if (position < length && (data[position] == QLatin1Char('e') || data[position] == QLatin1Char('E')))
+            {
+                int p = position + 1;
+                if (p < length && (data[p] == QLatin1Char('+') || data[p] == QLatin1Char('-')))
+                    ++p;
+                if (p < length && isDigit(data[p]))
+                {
+                    position = p;
+                    while (position < length && isDigit(data[position]))
+                        ++position;
+                }
+            }
+        }
+        token.length = position - token.start;
+        return true;
+    }
+
+    if (isIdentifierStart(c))
+    {
+        while (position < length && isIdentifierPart(data[position]))
+            ++position;
+        token.type = SqlToken::Identifier;
+        token.length = position - token.start;
+        return true;
+    }
+
+    // parameters: ?, ?NNN, :name, @name, $name
+    if (c == QLatin1Char('?'))
+    {
+        ++position;
+        while (position < length && isDigit(data[position]))
+            ++position;
+        token.type = SqlToken::Parameter;
+        token.length = position - token.start;
+        return true;
+    }
+
+    if ((c == QLatin1Char(':') || c == QLatin1Char('@') || c == QLatin1Char('$')) && isIdentifierStart(n))
+    {
+        ++position;
+        while (position < length && isIdentifierPart(data[position]))
+            ++position;
+        token.type = SqlToken::Parameter;
+        token.length = position - token.start;
+        return true;
+    }
+
+    // operators, the two character ones are kept together
+    static const char* const twoCharOperators[] = { "||", "<=", ">=", "==", "!=", "<>", "<<", ">>", "->" };
+    token.type = SqlToken::Operator;
+    token.length = 1;
+    for (const char* op : twoCharOperators)
+    {
+        if (c.unicode() == ushort(op[0]) && n.unicode() == ushort(op[1]))
+        {
+            token.length = 2;
+            break;
+        }
+    }
+    position += token.length;
+    return true;
+}
+
+/*
+ * Splits a script into its statements. Semicolons inside strings, comments and trigger bodies don't end a statement, empty statements and
+ * statements that contain nothing but comments are skipped.
+ */
+QVector<SqlStatement> SqlLexer::splitStatements(const QString &script)
+{
+    QVector<SqlStatement> statements;
+
+    SqlLexer lexer(script);
+    SqlStatementTracker tracker;
+    SqlToken token;
+
+    int statementStart = -1;
+    int statementEnd = 0;
+    int line = 1;
+    int lineCountedUpTo = 0;
+    QString keyword;
+
+    auto finish = [&](int end)
+    {
+        line += script.midRef(lineCountedUpTo, statementStart - lineCountedUpTo).count(QLatin1Char('\n'));
+        lineCountedUpTo = statementStart;
+
+        SqlStatement statement;
+        statement.text = script.mid(statementStart, statementEnd - statementStart);
+        statement.start = statementStart;
+        statement.length = end - statementStart;
+        statement.line = line;
+        statement.keyword = keyword;
+        statements << statement;
+
+        statementStart = -1;
+        keyword.clear();
+        tracker.reset();
+    };
+
+    while (lexer.next(token))
+    {
+        if (!token.isSignificant())
+            continue;
+
+        if (tracker.feed(script.constData(), token))
+        {
+            if (statementStart >= 0)
+                finish(token.start + token.length);
+            else
+                tracker.reset();
+            continue;
+        }
+
+        if (statementStart < 0)
+        {
+            statementStart = token.start;
+            if (token.type == SqlToken::Identifier)
+                keyword = script.mid(token.start, token.length).toUpper();
+        }
+        statementEnd = token.start + token.length;
+    }
+
+    if (statementStart >= 0)
+        finish(statementEnd);
+
+    return statements;
+}
+
+/*
+ * Reduces a statement to the text it is cached under, so that statements that only differ in layout share one prepared statement. Whitespace and
+ * comments between tokens collapse into a single space and the final semicolon goes; the tokens themselves, literals included, are kept as they
+ * were written. A literal can't become a placeholder: sqlite names result columns after their text, and only matches an expression index or the
+ * condition of a partial index against the literal itself. Statements that differ in their values only share a prepared statement when the user
+ * wrote the placeholders.
+ */
+QString SqlLexer::normalize(const QString &statement)
+{
+    QString text;
+    text.reserve(statement.size());
+
+    SqlLexer lexer(statement);
+    SqlToken token;
+    bool pendingSpace = false;
+    while (lexer.next(token))
+    {
+        if (!token.isSignificant())
+        {
+            pendingSpace = !text.isEmpty();
+            continue;
+        }
+
+        if (token.type == SqlToken::Semicolon)
+            continue;
+
+        if (pendingSpace)
+            text += QLatin1Char(' ');
+        pendingSpace = false;
+        text += statement.midRef(token.start, token.length);
+    }
+
+    return text;
+}
+
+/*
+ * Numbers the parameters the way sqlite does: a ? takes the index after the largest one so far, ?NNN takes index NNN, and a named parameter takes
+ * the next index the first time it appears and keeps it afterwards.
+ */
+QStringList SqlLexer::parameters(const QString &statement)
+{
+    QStringList names;
+
+    SqlLexer lexer(statement);
+    SqlToken token;
+    while (lexer.next(token))
+    {
+        if (token.type != SqlToken::Parameter)
+            continue;
+
+        const QString name = statement.mid(token.start, token.length);
+        if (name.at(0) != QLatin1Char('?'))
+        {
+            if (!names.contains(name))
+                names << name;
+            continue;
+        }
+
+        bool ok = true;
+        const int index = name.length() > 1 ? name.mid(1).toInt(&ok) : names.size() + 1;
+        if (!ok || index < 1)
+            continue;
+
+        while (names.size() < index)
+            names << QString("?%1").arg(names.size() + 1);
+    }
+
+    return names;
+}
+
+QString SqlLexer::quoteIdentifier(const QString &name)
+{
+    QString quoted = name;
+    quoted.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + quoted + QLatin1Char('"');
+}
+
+QString SqlLexer::firstKeyword(const QString &text)
+{
+    SqlLexer lexer(text);
+    SqlToken token;
+    while (lexer.next(token))
+    {
+        if (!token.isSignificant())
+            continue;
+        return token.type == SqlToken::Identifier ? text.mid(token.start, token.length).toUpper() : QString();
+    }
+
+    return QString();
+}
+
+/*
+ * Finds the statement the caret is in. A caret in the blank space between two statements belongs to the statement before it, so that the statement
+ * that was just typed is the one that runs, unless the caret already sits on the line where the next statement starts.
+ */
+SqlStatement SqlLexer::statementAt(const QString &script, int position)
+{
+    const QVector<SqlStatement> statements = splitStatements(script);
+    if (statements.isEmpty())
+        return SqlStatement();
+
+    int found = 0;
+    for (int i = 0; i < statements.size() && statements.at(i).start <= position; ++i)
+        found = i;
+
+    const SqlStatement& current = statements.at(found);
+    const int end = current.start + current.length;
+    if (position > end && found + 1 < statements.size())
+    {
+        const SqlStatement& following = statements.at(found + 1);
+        const bool leftLine = script.midRef(end, position - end).count(QLatin1Char('\n')) > 0;
+        const bool sameLine = script.midRef(position, following.start - position).count(QLatin1Char('\n')) == 0;
+        if (leftLine && sameLine)
+            return following;
+    }
+
+    return current;
+}
+
+void SqlStatementTracker::reset()
+{
+    count = 0;
+    createSeen = false;
+    trigger = false;
+    bodySeen = false;
+    depth = 0;
+}
+
+bool SqlStatementTracker::feed(const QChar *data, const SqlToken &token)
+{
+    if (token.type == SqlToken::Semicolon)
+        return !trigger || (bodySeen && depth == 0);
+
+    // CREATE [TEMP | TEMPORARY] TRIGGER
+    if (count == 0)
+        createSeen = SqlLexer::equals(data, token, "CREATE");
+    else if (createSeen && !trigger && count <= 2)
+    {
+        const bool temporary = count == 1 && (SqlLexer::equals(data, token, "TEMP") || SqlLexer::equals(data, token, "TEMPORARY"));
+        if (SqlLexer::equals(data, token, "TRIGGER"))
+            trigger = true;
+        else if (!temporary)
+            createSeen = false;
+    }
+    else if (trigger && token.type == SqlToken::Identifier)
+    {
+        // the body is BEGIN ... END, CASE ... END expressions may appear inside it
+        if (!bodySeen && SqlLexer::equals(data, token, "BEGIN"))
+        {
+            bodySeen = true;
+            depth = 1;
+        }
+        else if (bodySeen && SqlLexer::equals(data, token, "CASE"))
+            ++depth;
+        else if (bodySeen && depth > 0 && SqlLexer::equals(data, token, "END"))
+            --depth;
+    }
+
+    ++count;
+    return false;
+}
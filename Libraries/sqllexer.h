@@ -0,0 +1,137 @@
+#ifndef SQLLEXER_H
+#define SQLLEXER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QVariant>
+
+// A single token produced by the SqlLexer, positions are relative to the scanned text
+struct SqlToken
+{
+    enum Type
+    {
+        Whitespace,
+        LineComment,
+        BlockComment,
+        String,             // 'text'
+        QuotedIdentifier,   // "name", `name` or [name]
+        Blob,               // x'0A0B'
+        Number,
+        Identifier,         // names and keywords
+        Parameter,          // ?, ?1, :name, @name, $name
+        Semicolon,
+        Operator            // everything else, one character at a time except for the multi character operators
+    };
+
+    Type type = Whitespace;
+    int start = 0;
+    int length = 0;
+
+    // false for strings, identifiers and comments that run past the end of the scanned text
+    bool terminated = true;
+
+    bool isSignificant() const { return type != Whitespace && type != LineComment && type != BlockComment; }
+};
+
+// A complete statement found by SqlLexer::splitStatements
+struct SqlStatement
+{
+    // statement text without the terminating semicolon
+    QString text;
+
+    // offset of the first character of the statement in the script
+    int start = 0;
+
+    // length of the statement, including the terminating semicolon if any
+    int length = 0;
+
+    // line of the first character of the statement, starting at 1
+    int line = 1;
+
+    // first word of the statement in upper case, such as SELECT or CREATE
+    QString keyword;
+};
+
+/*
+ * Hand written sqlite tokenizer. It scans the text once, and can be resumed in the middle of a multi-line comment, string or quoted identifier by
+ * passing the state the previous chunk of text ended in, which is what the syntax highlighter and the streaming script reader need.
+ */
+class SqlLexer
+{
+public:
+    // construct that is still open at the end of the scanned text
+    enum State
+    {
+        Normal = 0,
+        InBlockComment,
+        InString,
+        InDoubleQuote,
+        InBacktick,
+        InBracket
+    };
+
+    explicit SqlLexer(const QString& text, State state = Normal);
+    SqlLexer(const QChar* data, int length, State state = Normal);
+
+    // reads the next token, returns false at the end of the text
+    bool next(SqlToken& token);
+
+    // state at the current position, non Normal only when the last token was left open
+    State state() const { return currentState; }
+
+    static QVector<SqlStatement> splitStatements(const QString& script);
+
+    // first word of the text in upper case, skipping whitespace and comments
+    static QString firstKeyword(const QString& text);
+
+    // statement that contains the given position, or the closest one before it, an empty statement if the script has none
+    static SqlStatement statementAt(const QString& script, int position);
+
+    // the statement with the whitespace and the comments between its tokens collapsed, and without its final semicolon
+    static QString normalize(const QString& statement);
+
+    // names of the parameters of a statement, the name at index i is the one sqlite binds at index i + 1, anonymous ? are named ?1, ?2 and so on
+    static QStringList parameters(const QString& statement);
+
+    // wraps a table or column name in double quotes, doubling the quotes inside it
+    static QString quoteIdentifier(const QString& name);
+
+    // true if the identifier token equals the given upper case keyword, ignoring case
+    static bool equals(const QChar* data, const SqlToken& token, const char* keyword);
+
+private:
+    const QChar* data;
+    int length;
+    int position = 0;
+    State currentState;
+
+    bool scanQuoted(SqlToken& token, QChar close, SqlToken::Type type, State openState);
+    bool scanBlockComment(SqlToken& token);
+};
+
+/*
+ * Decides whether a semicolon terminates the statement it appears in. A plain ';' ends most statements, but the bodies of CREATE TRIGGER
+ * statements contain statements of their own, so there only the ';' after the END of the body counts. Feed it every significant token in
+ * order, and call reset() when a statement ends.
+ */
+class SqlStatementTracker
+{
+public:
+    void reset();
+
+    // returns true if the token is a semicolon that ends the current statement
+    bool feed(const QChar* data, const SqlToken& token);
+
+    // number of significant tokens seen in the current statement, not counting a terminating semicolon
+    int tokenCount() const { return count; }
+
+private:
+    int count = 0;
+    bool createSeen = false;
+    bool trigger = false;
+    bool bodySeen = false;
+    int depth = 0;
+};
+
+#endif // SQLLEXER_H
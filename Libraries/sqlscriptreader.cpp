@@ -0,0 +1,128 @@
+#include "sqlscriptreader.h"
+
+#include <QIODevice>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include <climits>
+
+namespace
+{
+    // bytes read from the device at a time
+    const qint64 ChunkSize = 1 << 20;
+}
+
+SqlScriptReader::SqlScriptReader(QIODevice *device) : device(device), decoder(QTextCodec::codecForName("UTF-8")->makeDecoder())
+{
+}
+
+SqlScriptReader::~SqlScriptReader()
+{
+}
+
+/*
+ * Drops the text before the statement being read and appends the next chunk of the device. Returns false at the end of the device.
+ */
+bool SqlScriptReader::fill()
+{
+    const int keep = statementStart >= 0 ? qMin(statementStart, scanPosition) : scanPosition;
+    if (keep > lineCountedUpTo)
+    {
+        line += pending.midRef(lineCountedUpTo, keep - lineCountedUpTo).count(QLatin1Char('\n'));
+        lineCountedUpTo = keep;
+    }
+
+    pending.remove(0, keep);
+    consumed += keep;
+    scanPosition -= keep;
+    lineCountedUpTo -= keep;
+    if (statementStart >= 0)
+    {
+        statementStart -= keep;
+        statementEnd -= keep;
+    }
+
+    const QByteArray chunk = device->read(ChunkSize);
+    if (chunk.isEmpty())
+        return false;
+
+    bytes += chunk.size();
+    pending += decoder->toUnicode(chunk);
+    return true;
+}
+
+void SqlScriptReader::take(SqlStatement &statement, int end)
+{
+    line += pending.midRef(lineCountedUpTo, statementStart - lineCountedUpTo).count(QLatin1Char('\n'));
+    lineCountedUpTo = statementStart;
+
+    statement.text = pending.mid(statementStart, statementEnd - statementStart);
+    statement.start = int(qMin<qint64>(consumed + statementStart, INT_MAX));
+    statement.length = end - statementStart;
+    statement.line = line;
+    statement.keyword = keyword;
+
+    statementStart = -1;
+    keyword.clear();
+    tracker.reset();
+}
+
+bool SqlScriptReader::next(SqlStatement &statement)
+{
+    for (;;)
+    {
+        const int origin = scanPosition;
+        const QChar* data = pending.constData() + origin;
+        SqlLexer lexer(data, pending.size() - origin, scanState);
+        SqlToken token;
+
+        while (lexer.next(token))
+        {
+            const int start = origin + token.start;
+            const int end = start + token.length;
+
+            // the token may go on in the next chunk, it is scanned again from its start once that is read
+            if (end == pending.size() && !atEnd)
+                break;
+
+            scanPosition = end;
+            scanState = lexer.state();
+
+            if (!token.isSignificant())
+                continue;
+
+            if (tracker.feed(data, token))
+            {
+                if (statementStart >= 0)
+                {
+                    take(statement, end);
+                    return true;
+                }
+                tracker.reset();
+                continue;
+            }
+
+            if (statementStart < 0)
+            {
+                statementStart = start;
+                if (token.type == SqlToken::Identifier)
+                    keyword = pending.mid(start, token.length).toUpper();
+            }
+            statementEnd = end;
+        }
+
+        if (atEnd)
+        {
+            // the last statement doesn't need a semicolon
+            if (statementStart >= 0)
+            {
+                take(statement, statementEnd);
+                return true;
+            }
+            return false;
+        }
+
+        if (!fill())
+            atEnd = true;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SQLSCRIPTREADER_H
+#define SQLSCRIPTREADER_H
+
+#include <QString>
+#include <QScopedPointer>
+
+#include "Libraries/sqllexer.h"
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QTextDecoder;
+QT_END_NAMESPACE
+
+/*
+ * Splits an SQL script into statements while reading it from a device a chunk at a time, the streaming counterpart of SqlLexer::splitStatements.
+ * Only the statement being read and the current chunk are held in memory, whatever the size of the script. The lexer resumes where the previous
+ * chunk ended; the last token of a chunk is scanned again once the next chunk is there, since it may continue in it.
+ */
+class SqlScriptReader
+{
+public:
+    explicit SqlScriptReader(QIODevice* device);
+    ~SqlScriptReader();
+
+    // reads the next statement, returns false at the end of the script; start and line count from the beginning of the script
+    bool next(SqlStatement& statement);
+
+    // bytes read from the device so far
+    qint64 bytesRead() const { return bytes; }
+
+private:
+    QIODevice* device;
+    QScopedPointer<QTextDecoder> decoder;
+    qint64 bytes = 0;
+    bool atEnd = false;
+
+    // text not consumed yet: the statement being read and whatever follows it
+    QString pending;
+    qint64 consumed = 0;
+
+    // where scanning resumes in pending, and the state of the lexer there
+    int scanPosition = 0;
+    SqlLexer::State scanState = SqlLexer::Normal;
+
+    SqlStatementTracker tracker;
+    int statementStart = -1;
+    int statementEnd = 0;
+    QString keyword;
+
+    int line = 1;
+    int lineCountedUpTo = 0;
+
+    bool fill();
+    void take(SqlStatement& statement, int end);
+};
+
+#endif // SQLSCRIPTREADER_H
@@ -0,0 +1,210 @@
+#include "resultmodel.h"
+
+namespace
+{
+    // default memory budget for the rows of a result set
+    const qint64 DefaultBudget = 256 * 1024 * 1024;
+
+    // pages that are always kept, whatever the budget, so the visible rows never thrash
+    const int MinimumPages = 4;
+}
+
+ResultModel::ResultModel(QObject *parent) : QAbstractTableModel(parent), budget(DefaultBudget)
+{
+}
+
+int ResultModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : knownRows;
+}
+
+int ResultModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.size();
+}
+
+QVariant ResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return QVariant();
+
+    const int page = index.row() / ResultPage::Rows;
+    auto it = pages.find(page);
+    if (it == pages.end())
+    {
+        // the page was dropped to stay within the budget, ask for it once and show it when it arrives
+        if (!requestedPages.contains(page) && !failedPages.contains(page))
+        {
+            requestedPages.insert(page);
+            emit const_cast<ResultModel*>(this)->pageRequested(resultId, page);
+        }
+        return QVariant();
+    }
+
+    it->lastUsed = ++clock;
+    return it->rows.value(index.row() % ResultPage::Rows, index.column());
+}
+
+QVariant ResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+        return section < columns.size() ? columns.at(section) : QVariant();
+
+    return section + 1;
+}
+
+bool ResultModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && hasMore && !fetchPending;
+}
+
+void ResultModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    fetchPending = true;
+    emit fetchMoreRequested();
+}
+
+void ResultModel::setMemoryBudget(qint64 bytes)
+{
+    budget = bytes;
+    evict(-1);
+}
+
+qint64 ResultModel::memoryBudget() const
+{
+    return budget;
+}
+
+qint64 ResultModel::memoryUsage() const
+{
+    return usage;
+}
+
+/*
+ * Starts a new result set. Called when the worker reports the columns of a select statement, before any rows arrive. Result sets that can't be read
+ * again with LIMIT and OFFSET, such as the ones of a pragma, are kept entirely.
+ */
+void ResultModel::setColumns(int id, const QStringList &c, bool r)
+{
+    beginResetModel();
+    columns = c;
+    resultId = id;
+    refetchable = r;
+    knownRows = 0;
+    pages.clear();
+    requestedPages.clear();
+    failedPages.clear();
+    usage = 0;
+    hasMore = true;
+    fetchPending = true;
+    endResetModel();
+}
+
+/*
+ * Adds a page that arrived from the worker. The next page in order extends the result set, any other page replaces one that was dropped earlier.
+ * A dropped page the worker failed to read again stays empty.
+ */
+void ResultModel::addPage(int id, int page, const ResultPage &rows, bool atEnd, bool failed)
+{
+    if (id != resultId)
+        return;
+
+    if (failed)
+    {
+        requestedPages.remove(page);
+        failedPages.insert(page);
+        return;
+    }
+    failedPages.clear();
+
+    CachedPage cached;
+    cached.rows = rows;
+    cached.size = rows.memoryUsage();
+    cached.lastUsed = ++clock;
+
+    const int first = page * ResultPage::Rows;
+    if (first == knownRows)
+    {
+        fetchPending = false;
+        hasMore = !atEnd;
+
+        if (rows.rowCount() == 0)
+            return;
+
+        beginInsertRows(QModelIndex(), first, first + rows.rowCount() - 1);
+        pages.insert(page, cached);
+        usage += cached.size;
+        knownRows += rows.rowCount();
+        endInsertRows();
+    }
+    else if (first < knownRows)
+    {
+        requestedPages.remove(page);
+        if (pages.contains(page) || rows.rowCount() == 0)
+            return;
+
+        pages.insert(page, cached);
+        usage += cached.size;
+        emit dataChanged(index(first, 0), index(first + rows.rowCount() - 1, columns.size() - 1));
+    }
+
+    evict(page);
+}
+
+/*
+ * Drops the least recently viewed pages until the rows fit into the budget again.
+ */
+void ResultModel::evict(int keepPage)
+{
+    if (!refetchable)
+        return;
+
+    while (usage > budget && pages.size() > MinimumPages)
+    {
+        auto victim = pages.end();
+        for (auto it = pages.begin(); it != pages.end(); ++it)
+        {
+            if (it.key() != keepPage && (victim == pages.end() || it->lastUsed < victim->lastUsed))
+                victim = it;
+        }
+
+        if (victim == pages.end())
+            return;
+
+        emit pageDropped(resultId, victim.key(), victim->rows);
+        usage -= victim->size;
+        pages.erase(victim);
+    }
+}
+
+/*
+ * Called when the worker can no longer give dropped pages back, because the database of the result set was closed and the pages could not be
+ * spilled. The pages still in memory are kept from then on, whatever the budget.
+ */
+void ResultModel::stopRefetching(int id)
+{
+    if (id == resultId)
+        refetchable = false;
+}
+
+void ResultModel::clear()
+{
+    beginResetModel();
+    columns.clear();
+    resultId = -1;
+    knownRows = 0;
+    pages.clear();
+    requestedPages.clear();
+    failedPages.clear();
+    usage = 0;
+    refetchable = false;
+    hasMore = false;
+    fetchPending = false;
+    endResetModel();
+}
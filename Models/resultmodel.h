@@ -0,0 +1,77 @@
+#ifndef RESULTMODEL_H
+#define RESULTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+
+#include "Database/resultpage.h"
+
+/*
+ * Table model for the rows produced by the QueryEngine. Rows arrive asynchronously a page at a time; when the view scrolls to the end, the model
+ * asks for the next page through fetchMoreRequested() instead of pulling it from a QSqlQuery in the GUI thread.
+ *
+ * Only as many pages as fit into the memory budget are kept. When the budget is exceeded the least recently viewed pages are handed to the worker
+ * through pageDropped() and dropped, and read again through pageRequested() once the view scrolls back to them, so the memory used by a result
+ * set of millions of rows stays bounded. Once the worker can't give dropped pages back anymore, stopRefetching() keeps the remaining ones.
+ */
+class ResultModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit ResultModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    bool canFetchMore(const QModelIndex& parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex& parent) Q_DECL_OVERRIDE;
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    qint64 memoryUsage() const;
+
+public slots:
+    void setColumns(int resultId, const QStringList& columns, bool refetchable);
+    void addPage(int resultId, int page, const ResultPage& rows, bool atEnd, bool failed);
+    void stopRefetching(int resultId);
+    void clear();
+
+signals:
+    void fetchMoreRequested();
+    void pageRequested(int resultId, int page);
+    void pageDropped(int resultId, int page, const ResultPage& rows);
+
+private:
+    struct CachedPage
+    {
+        ResultPage rows;
+        qint64 size = 0;
+        quint64 lastUsed = 0;
+    };
+
+    QStringList columns;
+    int resultId = -1;
+    int knownRows = 0;
+    bool refetchable = false;
+    bool hasMore = false;
+    bool fetchPending = false;
+
+    // page number -> rows, lastUsed is bumped by data() so the cache is least recently used
+    mutable QHash<int, CachedPage> pages;
+    mutable QSet<int> requestedPages;
+
+    // pages that could not be read again, not asked for until another page arrives so a failing page doesn't repeat on every repaint
+    QSet<int> failedPages;
+    mutable quint64 clock = 0;
+    qint64 budget;
+    qint64 usage = 0;
+
+    void evict(int keepPage);
+};
+
+#endif // RESULTMODEL_H
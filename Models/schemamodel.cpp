@@ -0,0 +1,522 @@
+#include "schemamodel.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QIcon>
+#include <QFont>
+#include <QSet>
+
+#include <algorithm>
+
+struct SchemaModel::Node
+{
+    Node(NodeType t, const QString& n, Node* p) : type(t), name(n), parent(p) {}
+    ~Node() { qDeleteAll(children); }
+
+    NodeType type;
+    QString name;
+    Node* parent;
+    QVector<Node*> children;
+
+    // tables and views: the children were created, which happens the first time they are expanded
+    bool fetched = false;
+
+    // databases: the schema arrived, every object by name, and the indexes and triggers by the lower case name of their table
+    bool loaded = false;
+    QHash<QString, SchemaObject> objects;
+    QMultiHash<QString, QString> dependents;
+};
+
+namespace
+{
+    SchemaModel::NodeType nodeTypeOf(const QString& type)
+    {
+        if (type == "view")
+            return SchemaModel::ViewNode;
+        if (type == "index")
+            return SchemaModel::IndexNode;
+        if (type == "trigger")
+            return SchemaModel::TriggerNode;
+        return SchemaModel::TableNode;
+    }
+
+    bool isTopLevel(const QString& type)
+    {
+        return type == "table" || type == "view";
+    }
+
+    bool sameObject(const SchemaObject& a, const SchemaObject& b)
+    {
+        return a.type == b.type && a.table == b.table && a.columns == b.columns;
+    }
+
+    // the objects of a database are ordered by type, tables before views, then by name the way sqlite compares names
+    bool lessThan(SchemaModel::NodeType aType, const QString& a, SchemaModel::NodeType bType, const QString& b)
+    {
+        if (aType != bType)
+            return aType < bType;
+        return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+    }
+}
+
+SchemaModel::SchemaModel(QObject *parent) : QAbstractItemModel(parent), root(new Node(GroupNode, QString(), nullptr))
+{
+}
+
+SchemaModel::~SchemaModel()
+{
+    delete root;
+}
+
+QModelIndex SchemaModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node* node = nodeFor(parent);
+    if (column != 0 || row < 0 || row >= node->children.size())
+        return QModelIndex();
+    return createIndex(row, column, node->children.at(row));
+}
+
+QModelIndex SchemaModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+    return indexFor(nodeFor(child)->parent);
+}
+
+int SchemaModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    return nodeFor(parent)->children.size();
+}
+
+int SchemaModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant SchemaModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    const Node* node = nodeFor(index);
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return node->type == DatabaseNode ? QFileInfo(node->name).fileName() : node->name;
+    case Qt::ToolTipRole:
+        return node->type == DatabaseNode ? node->name : QVariant();
+    case Qt::DecorationRole:
+        if (node->type == DatabaseNode)
+            return QIcon(":/Resources/Tree/folder.png");
+        if (node->type == TableNode || node->type == ViewNode)
+            return QIcon(":/Resources/Tree/table.png");
+        return QVariant();
+    case NodeTypeRole:
+        return node->type;
+    case NameRole:
+        return node->name;
+    default:
+        return QVariant();
+    }
+}
+
+QVariant SchemaModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || section != 0)
+        return QVariant();
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QStringLiteral("(Localdb) | SQLITELocalDB | outline");
+    case Qt::DecorationRole:
+        return QIcon(":/Resources/Tree/foldertree.png");
+    case Qt::FontRole:
+        return QFont("Calibri");
+    default:
+        return QVariant();
+    }
+}
+
+/*
+ * Tables and views show an expander before their children exist, and so do databases before their schema arrived.
+ */
+bool SchemaModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node* node = nodeFor(parent);
+    if (node == root)
+        return !node->children.isEmpty();
+
+    switch (node->type)
+    {
+    case DatabaseNode:
+        return !node->loaded || !node->children.isEmpty();
+    case TableNode:
+    case ViewNode:
+        return !node->fetched || !node->children.isEmpty();
+    default:
+        return !node->children.isEmpty();
+    }
+}
+
+bool SchemaModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node* node = nodeFor(parent);
+    if (node == root)
+        return false;
+    if (node->type == DatabaseNode)
+        return !node->loaded;
+    return (node->type == TableNode || node->type == ViewNode) && !node->fetched;
+}
+
+/*
+ * Creates the columns, indexes and triggers of a table the first time the view asks for them.
+ */
+void SchemaModel::fetchMore(const QModelIndex &parent)
+{
+    Node* node = nodeFor(parent);
+    if (node == root)
+        return;
+
+    if (node->type == DatabaseNode)
+    {
+        if (!node->loaded)
+            emit schemaRequested(node->name);
+        return;
+    }
+
+    if (node->fetched)
+        return;
+
+    const QVector<Node*> children = createChildren(node->parent, node);
+    node->fetched = true;
+    if (children.isEmpty())
+        return;
+
+    beginInsertRows(parent, 0, children.size() - 1);
+    node->children = children;
+    endInsertRows();
+}
+
+QModelIndex SchemaModel::addDatabase(const QString &path)
+{
+    if (Node* database = findDatabase(path))
+        return indexFor(database);
+
+    const int row = root->children.size();
+    beginInsertRows(QModelIndex(), row, row);
+    root->children << new Node(DatabaseNode, path, root);
+    endInsertRows();
+    return index(row, 0);
+}
+
+void SchemaModel::removeDatabase(const QModelIndex &index)
+{
+    Node* node = nodeFor(index);
+    if (node == root || node->type != DatabaseNode)
+        return;
+
+    const int row = rowOf(node);
+    beginRemoveRows(QModelIndex(), row, row);
+    delete root->children.takeAt(row);
+    endRemoveRows();
+}
+
+QStringList SchemaModel::databases() const
+{
+    QStringList paths;
+    foreach (const Node* database, root->children)
+        paths << database->name;
+    return paths;
+}
+
+SchemaModel::NodeType SchemaModel::nodeType(const QModelIndex &index) const
+{
+    return nodeFor(index)->type;
+}
+
+QString SchemaModel::databasePath(const QModelIndex &index) const
+{
+    for (const Node* node = nodeFor(index); node != root; node = node->parent)
+    {
+        if (node->type == DatabaseNode)
+            return node->name;
+    }
+    return QString();
+}
+
+QString SchemaModel::tableName(const QModelIndex &index) const
+{
+    for (const Node* node = nodeFor(index); node != root; node = node->parent)
+    {
+        if (node->type == TableNode || node->type == ViewNode)
+            return node->name;
+    }
+    return QString();
+}
+
+/*
+ * Applies the changes of the schema of a database. The first delta after opening a database holds every object: it is compared with what the tree
+ * already shows, so reopening a database keeps the rows, and the expanded tables, that didn't change.
+ */
+void SchemaModel::apply(const SchemaDelta &delta)
+{
+    Node* database = findDatabase(delta.path);
+    if (!database)
+        return;
+
+    // a database shown for the first time is filled at once, rather than a row at a time
+    if (delta.reset && database->children.isEmpty())
+    {
+        database->objects.clear();
+        database->dependents.clear();
+        foreach (const SchemaObject& object, delta.changed)
+        {
+            database->objects.insert(object.name, object);
+            if (!isTopLevel(object.type))
+                database->dependents.insert(object.table.toLower(), object.name);
+        }
+        database->loaded = true;
+        loadObjects(database);
+        return;
+    }
+
+    QStringList removed = delta.removed;
+    if (delta.reset)
+    {
+        QSet<QString> names;
+        foreach (const SchemaObject& object, delta.changed)
+            names.insert(object.name);
+        for (auto it = database->objects.cbegin(); it != database->objects.cend(); ++it)
+        {
+            if (!names.contains(it.key()))
+                removed << it.key();
+        }
+        database->loaded = true;
+    }
+
+    // tables whose indexes or triggers changed, by lower case name
+    QSet<QString> stale;
+
+    foreach (const QString& name, removed)
+    {
+        const SchemaObject object = database->objects.take(name);
+        if (object.type.isEmpty())
+            continue;
+
+        if (isTopLevel(object.type))
+        {
+            removeObject(database, object);
+        }
+        else
+        {
+            database->dependents.remove(object.table.toLower(), object.name);
+            stale.insert(object.table.toLower());
+        }
+    }
+
+    foreach (const SchemaObject& object, delta.changed)
+    {
+        const SchemaObject previous = database->objects.value(object.name);
+        database->objects.insert(object.name, object);
+        if (sameObject(previous, object))
+            continue;
+
+        if (!previous.type.isEmpty())
+        {
+            if (isTopLevel(previous.type) && previous.type != object.type)
+                removeObject(database, previous);
+            else if (!isTopLevel(previous.type))
+                database->dependents.remove(previous.table.toLower(), previous.name);
+            stale.insert(previous.table.toLower());
+        }
+
+        if (isTopLevel(object.type))
+        {
+            insertObject(database, object);
+        }
+        else
+        {
+            database->dependents.insert(object.table.toLower(), object.name);
+            stale.insert(object.table.toLower());
+        }
+    }
+
+    foreach (const QString& name, stale)
+    {
+        Node* table = findTable(database, name);
+        if (table && table->fetched)
+            refreshChildren(table);
+    }
+}
+
+SchemaModel::Node *SchemaModel::nodeFor(const QModelIndex &index) const
+{
+    return index.isValid() ? static_cast<Node*>(index.internalPointer()) : root;
+}
+
+QModelIndex SchemaModel::indexFor(Node *node) const
+{
+    if (!node || node == root)
+        return QModelIndex();
+    return createIndex(rowOf(node), 0, node);
+}
+
+/*
+ * The objects of a database are sorted, so the row of a table among thousands of them is found by a binary search.
+ */
+int SchemaModel::rowOf(const Node *node) const
+{
+    const Node* parent = node->parent;
+    if (parent != root && parent->type == DatabaseNode)
+    {
+        bool found = false;
+        return findObject(parent, node->type, node->name, &found);
+    }
+    return parent->children.indexOf(const_cast<Node*>(node));
+}
+
+SchemaModel::Node *SchemaModel::findDatabase(const QString &path) const
+{
+    foreach (Node* database, root->children)
+    {
+        if (database->name == path)
+            return database;
+    }
+    return nullptr;
+}
+
+/*
+ * Returns the row of an object among the children of a database, or the row it would be inserted at if it isn't there.
+ */
+int SchemaModel::findObject(const Node *database, NodeType type, const QString &name, bool *found) const
+{
+    const auto it = std::lower_bound(database->children.cbegin(), database->children.cend(), name, [type](const Node* node, const QString& n)
+    {
+        return lessThan(node->type, node->name, type, n);
+    });
+
+    *found = it != database->children.cend() && (*it)->type == type && QString::compare((*it)->name, name, Qt::CaseInsensitive) == 0;
+    return it - database->children.cbegin();
+}
+
+SchemaModel::Node *SchemaModel::findTable(const Node *database, const QString &name) const
+{
+    bool found = false;
+    int row = findObject(database, TableNode, name, &found);
+    if (!found)
+        row = findObject(database, ViewNode, name, &found);
+    return found ? database->children.at(row) : nullptr;
+}
+
+/*
+ * Adds the row of a table or a view, unless it is there already.
+ */
+void SchemaModel::insertObject(Node *database, const SchemaObject &object)
+{
+    const NodeType type = nodeTypeOf(object.type);
+    bool found = false;
+    const int row = findObject(database, type, object.name, &found);
+    if (found)
+        return;
+
+    beginInsertRows(indexFor(database), row, row);
+    database->children.insert(row, new Node(type, object.name, database));
+    endInsertRows();
+}
+
+void SchemaModel::removeObject(Node *database, const SchemaObject &object)
+{
+    bool found = false;
+    const int row = findObject(database, nodeTypeOf(object.type), object.name, &found);
+    if (!found)
+        return;
+
+    beginRemoveRows(indexFor(database), row, row);
+    delete database->children.takeAt(row);
+    endRemoveRows();
+}
+
+/*
+ * Creates the rows of every table and view of a database that has none yet, sorted once and inserted at once.
+ */
+void SchemaModel::loadObjects(Node *database)
+{
+    QVector<Node*> children;
+    for (auto it = database->objects.cbegin(); it != database->objects.cend(); ++it)
+    {
+        if (isTopLevel(it->type))
+            children << new Node(nodeTypeOf(it->type), it->name, database);
+    }
+    if (children.isEmpty())
+        return;
+
+    std::sort(children.begin(), children.end(), [](const Node* a, const Node* b)
+    {
+        return lessThan(a->type, a->name, b->type, b->name);
+    });
+
+    beginInsertRows(indexFor(database), 0, children.size() - 1);
+    database->children = children;
+    endInsertRows();
+}
+
+/*
+ * Returns the groups of columns, indexes and triggers of a table, leaving out the empty ones.
+ */
+QVector<SchemaModel::Node*> SchemaModel::createChildren(const Node *database, Node *table) const
+{
+    QStringList indexes;
+    QStringList triggers;
+    foreach (const QString& name, database->dependents.values(table->name.toLower()))
+    {
+        if (database->objects.value(name).type == "index")
+            indexes << name;
+        else
+            triggers << name;
+    }
+    indexes.sort(Qt::CaseInsensitive);
+    triggers.sort(Qt::CaseInsensitive);
+
+    QVector<Node*> groups;
+    auto addGroup = [&](const QString& title, NodeType type, const QStringList& names)
+    {
+        if (names.isEmpty())
+            return;
+
+        Node* group = new Node(GroupNode, title, table);
+        foreach (const QString& name, names)
+            group->children << new Node(type, name, group);
+        groups << group;
+    };
+
+    addGroup(tr("Columns"), ColumnNode, database->objects.value(table->name).columns);
+    addGroup(tr("Indexes"), IndexNode, indexes);
+    addGroup(tr("Triggers"), TriggerNode, triggers);
+    return groups;
+}
+
+/*
+ * Recreates the children of an expanded table, after its columns, indexes or triggers changed.
+ */
+void SchemaModel::refreshChildren(Node *table)
+{
+    const QModelIndex index = indexFor(table);
+    if (!table->children.isEmpty())
+    {
+        beginRemoveRows(index, 0, table->children.size() - 1);
+        qDeleteAll(table->children);
+        table->children.clear();
+        endRemoveRows();
+    }
+
+    const QVector<Node*> children = createChildren(table->parent, table);
+    if (children.isEmpty())
+        return;
+
+    beginInsertRows(index, 0, children.size() - 1);
+    table->children = children;
+    endInsertRows();
+}
@@ -0,0 +1,95 @@
+#ifndef SCHEMAMODEL_H
+#define SCHEMAMODEL_H
+
+#include <QAbstractItemModel>
+#include <QStringList>
+
+#include "Database/schemainfo.h"
+
+/*
+ * Tree model of the database explorar: the opened databases, their tables and views, and under each table its columns, indexes and triggers.
+ *
+ * The model never queries a database itself. It is fed the SchemaDelta of the QueryEngine, and applies only what the delta says changed, so a
+ * CREATE or a DROP inserts or removes a single row however many tables the database holds. The children of a table are created when the table is
+ * expanded for the first time, so the tree holds one row per table until the user looks inside.
+ */
+class SchemaModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum NodeType
+    {
+        DatabaseNode,
+        TableNode,
+        ViewNode,
+
+        // "Columns", "Indexes" or "Triggers" of a table or a view
+        GroupNode,
+        ColumnNode,
+        IndexNode,
+        TriggerNode
+    };
+
+    enum Role
+    {
+        NodeTypeRole = Qt::UserRole + 1,
+
+        // name of the object the row stands for, the path for databases
+        NameRole
+    };
+
+    explicit SchemaModel(QObject* parent = nullptr);
+    ~SchemaModel();
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QModelIndex parent(const QModelIndex& child) const Q_DECL_OVERRIDE;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    bool canFetchMore(const QModelIndex& parent) const Q_DECL_OVERRIDE;
+    void fetchMore(const QModelIndex& parent) Q_DECL_OVERRIDE;
+
+    // adds a database at the end of the tree, or returns it if it is there already
+    QModelIndex addDatabase(const QString& path);
+    void removeDatabase(const QModelIndex& index);
+    QStringList databases() const;
+
+    NodeType nodeType(const QModelIndex& index) const;
+
+    // path of the database a row belongs to
+    QString databasePath(const QModelIndex& index) const;
+
+    // table or view a row belongs to, empty for databases
+    QString tableName(const QModelIndex& index) const;
+
+public slots:
+    void apply(const SchemaDelta& delta);
+
+signals:
+    // a database was expanded before its schema arrived
+    void schemaRequested(const QString& path);
+
+private:
+    struct Node;
+    Node* root;
+
+    Node* nodeFor(const QModelIndex& index) const;
+    QModelIndex indexFor(Node* node) const;
+    int rowOf(const Node* node) const;
+
+    Node* findDatabase(const QString& path) const;
+    int findObject(const Node* database, NodeType type, const QString& name, bool* found) const;
+    Node* findTable(const Node* database, const QString& name) const;
+    void insertObject(Node* database, const SchemaObject& object);
+    void removeObject(Node* database, const SchemaObject& object);
+    void loadObjects(Node* database);
+
+    QVector<Node*> createChildren(const Node* database, Node* table) const;
+    void refreshChildren(Node* table);
+};
+
+#endif // SCHEMAMODEL_H
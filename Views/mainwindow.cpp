@@ -4,7 +4,8 @@
 #include <QFontComboBox>
 #include <QFontDatabase>
 #include <QComboBox>
-#include <QListWidget>
+#include <QTreeWidget>
+#include <QHeaderView>
 #include <QIcon>
 #include <QTextEdit>
 #include <QTableView>
@@ -26,11 +27,9 @@
 #include <QTextStream>
 #include <QFileDialog>
 #include <QFile>
+#include <QDir>
 #include <QCloseEvent>
 #include <QSettings>
-#include <QSqlQueryModel>
-#include <QSqlQuery>
-#include <QSqlError>
 #include <QPrinter>
 #include <QPrintDialog>
 #include <QMessageBox>
@@ -39,14 +38,31 @@
 #include <QDialog>
 #include <QPixmap>
 #include <QLabel>
-#include <QStringListModel>
 #include <QDesktopServices>
+#include <QSpinBox>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QProgressDialog>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 #include "Libraries/viewmodel.h"
 #include "Formats/formatstream.h"
 #include "Widgets/tblgenerator.h"
 #include "Widgets/textedit.h"
 #include "Widgets/solutiontreewidget.h"
+#include "Widgets/tablebrowser.h"
+#include "Widgets/parameterpanel.h"
+#include "Widgets/planview.h"
+#include "Widgets/csvimportdialog.h"
+#include "Widgets/connectionsettingsdialog.h"
+#include "Libraries/sqllexer.h"
+#include "Libraries/completionindex.h"
+#include "Database/queryengine.h"
+#include "Database/sqlvalidator.h"
+#include "Models/resultmodel.h"
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
@@ -68,10 +84,115 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     /*
      * This section defines database related code, initializing all the necessary objects at startup
      */
-    database = QSqlDatabase::addDatabase("QSQLITE");
-    tableModel = new QSqlQueryModel(this);
+    tableModel = new ResultModel(this);
     tableView->setModel(tableModel);
 
+    /*
+     * Statements typed in the editor are executed by the query engine, on connections of its own that live in a worker thread. The engine follows
+     * the database that is selected in the explorar, and keeps the connections of the databases selected before open, up to a limit. The explorar
+     * is fed the schema the engine reports, so the GUI thread holds no connection at all.
+     */
+    engine = new QueryEngine(this);
+    connect(engine, &QueryEngine::opened, this, [=](const QString& path, bool ok, const QString& error)
+    {
+        if (!ok)
+            QMessageBox::warning(this, tr(""), tr("Could not open %1: %2").arg(QFileInfo(path).fileName(), error));
+    });
+    connect(engine, &QueryEngine::started, this, &MainWindow::onQueryStarted);
+    connect(engine, &QueryEngine::finished, this, &MainWindow::onQueryFinished);
+    connect(engine, &QueryEngine::failed, this, &MainWindow::onQueryFailed);
+    connect(engine, &QueryEngine::aborted, this, &MainWindow::onQueryAborted);
+    connect(engine, &QueryEngine::scriptProgress, this, &MainWindow::onScriptProgress);
+    connect(engine, &QueryEngine::scriptFinished, this, &MainWindow::onScriptFinished);
+    connect(engine, &QueryEngine::statisticsUpdated, this, &MainWindow::onStatisticsUpdated);
+    connect(engine, &QueryEngine::statementCacheUpdated, this, &MainWindow::onStatementCacheUpdated);
+    connect(engine, &QueryEngine::planReady, this, &MainWindow::onPlanReady);
+    connect(engine, &QueryEngine::importFinished, this, &MainWindow::onCsvImportFinished);
+    connect(engine, &QueryEngine::exportProgress, this, &MainWindow::onExportProgress);
+    connect(engine, &QueryEngine::exportFinished, this, &MainWindow::onExportFinished);
+    connect(engine, &QueryEngine::backupFinished, this, &MainWindow::onBackupFinished);
+    connect(engine, &QueryEngine::dumpFinished, this, &MainWindow::onDumpFinished);
+    connect(engine, &QueryEngine::scriptFileFinished, this, &MainWindow::onScriptFileFinished);
+    connect(engine, &QueryEngine::schemaUpdated, this, &MainWindow::onSchemaUpdated);
+    connect(engine, &QueryEngine::schemaUpdated, solutionTree, &SolutionTreeWidget::applySchema);
+    connect(engine, &QueryEngine::columnsReady, tableModel, &ResultModel::setColumns);
+    connect(engine, &QueryEngine::pageFetched, tableModel, &ResultModel::addPage);
+    connect(engine, &QueryEngine::busyChanged, ui->actionRun, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionRunSelection, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionRunStatement, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionRunFile, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionExplain, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionExportResults, &QAction::setDisabled);
+    connect(engine, &QueryEngine::busyChanged, ui->actionCancel, &QAction::setEnabled);
+    connect(queryTimeoutSpinBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), [=](int seconds)
+    {
+        engine->setTimeout(seconds * 1000);
+    });
+    connect(tableModel, &ResultModel::fetchMoreRequested, engine, &QueryEngine::fetchMore);
+    connect(tableModel, &ResultModel::pageRequested, engine, &QueryEngine::fetchPage);
+    connect(tableModel, &ResultModel::pageDropped, engine, &QueryEngine::storePage);
+    connect(engine, &QueryEngine::refetchUnavailable, tableModel, &ResultModel::stopRefetching);
+    connect(engine, &QueryEngine::keysetPageFetched, tableBrowser, &TableBrowser::addPage);
+    connect(tableBrowser, &TableBrowser::pageRequested, engine, &QueryEngine::fetchKeysetPage);
+
+    // statements of the editor may change the browsed table
+    connect(engine, &QueryEngine::finished, tableBrowser, [=](const ExecutionResult& result)
+    {
+        if (!result.isSelect)
+            tableBrowser->invalidate();
+    });
+    connect(engine, &QueryEngine::scriptFinished, tableBrowser, &TableBrowser::invalidate);
+
+    // another process wrote to the database, the schema follows through schemaUpdated if it changed
+    connect(engine, &QueryEngine::databaseChanged, this, [=](const QString& path)
+    {
+        tableBrowser->refresh();
+        statusBar()->showMessage(tr("%1 was changed by another connection").arg(QFileInfo(path).fileName()), 5000);
+    });
+
+    // the statements in view are checked against the selected database once the typing pauses
+    validator = new SqlValidator(this);
+    auto validationTimer = new QTimer(this);
+    validationTimer->setSingleShot(true);
+    validationTimer->setInterval(500);
+    connect(editor, &TextEdit::textChanged, validationTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+    connect(editor, &TextEdit::visibleBlocksChanged, validationTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+    connect(validationTimer, &QTimer::timeout, [=]()
+    {
+        if (ui->actionCheckWhileTyping->isChecked())
+            validator->validate(editor->visibleStatements());
+    });
+    connect(ui->actionCheckWhileTyping, &QAction::toggled, [=](bool checked)
+    {
+        if (checked)
+            validationTimer->start();
+        else
+            editor->setDiagnostics(QVector<SqlDiagnostic>());
+    });
+    connect(validator, &SqlValidator::diagnosticsReady, editor, &TextEdit::setDiagnostics);
+    connect(engine, &QueryEngine::opened, [=](const QString& path, bool ok)
+    {
+        if (path != engine->databasePath())
+            return;
+        validator->setDatabase(ok ? path : QString());
+        validationTimer->start();
+    });
+    connect(engine, &QueryEngine::schemaUpdated, validator, &SqlValidator::clearCache);
+    connect(engine, &QueryEngine::attachmentsChanged, this, [=](const QString& path, const QVariantMap& databases)
+    {
+        attachedDatabases.insert(path, databases);
+        if (path != engine->databasePath())
+            return;
+        validator->setAttachedDatabases(databases);
+        updateAttachedIndexes();
+        validationTimer->start();
+    });
+    connect(engine, &QueryEngine::attachFailed, this, [=](const QString& schema, const QString& error)
+    {
+        QMessageBox::warning(this, tr("Attach Database"), tr("Could not attach or detach %1: %2").arg(schema, error));
+    });
+    connect(engine, &QueryEngine::schemaUpdated, validationTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+
     ReadSettings();
 }
 
@@ -88,49 +209,47 @@ void MainWindow::closeEvent(QCloseEvent *e)
 
 void MainWindow::dragEnterEvent(QDragEnterEvent *e)
 {
-    if (QFileInfo(e->mimeData()->urls().first().toLocalFile()).suffix() == "db")
+    const QString suffix = QFileInfo(e->mimeData()->urls().first().toLocalFile()).suffix();
+    if (suffix == "db" || suffix.compare("sql", Qt::CaseInsensitive) == 0)
         e->accept();
 }
 
 void MainWindow::dropEvent(QDropEvent *e)
 {
     const QString str = e->mimeData()->urls().first().toLocalFile();
+    if (QFileInfo(str).suffix().compare("sql", Qt::CaseInsensitive) == 0)
+    {
+        openScript(str);
+        return;
+    }
+
     bool isLoaded = load(str);
     if (isLoaded)
     {
         solutionTree->addItemTotheExplorar(str);
-        loadTablesToTheSelectedDatabase();
     }
     else
-        QMessageBox::warning(this, tr(""), database.lastError().text());
+        QMessageBox::warning(this, tr(""), tr("Could not create %1").arg(str));
 }
 
 /*
  * Accepts a local URL to a file in the file system that contains all the keywords that needs to be appeared in the TextEdit for autocompletion. It reads the
- * keywords, creates StringListModel and returns a pointer to the data model.
+ * keywords, one per line, and returns them.
  */
-QAbstractItemModel *MainWindow::modelFromFile(const QString& fileName)
+QStringList MainWindow::wordsFromFile(const QString& fileName)
 {
     QFile file(fileName);
     if (!file.open(QFile::ReadOnly))
-        return new QStringListModel(completer);
+        return QStringList();
 
-#ifndef QT_NO_CURSOR
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-#endif
     QStringList words;
-
     while (!file.atEnd())
     {
-        QByteArray line = file.readLine();
+        QByteArray line = file.readLine().trimmed();
         if (!line.isEmpty())
-            words << line.trimmed();
+            words << line;
     }
-
-#ifndef QT_NO_CURSOR
-    QApplication::restoreOverrideCursor();
-#endif
-    return new QStringListModel(words, completer);
+    return words;
 }
 
 /*
@@ -153,6 +272,8 @@ void MainWindow::initializeIcons()
     //! these two doesn't depend on the platform
     ui->actionRun->setIcon(QIcon(resource + "execute.png"));
     ui->actionAbout->setIcon(QIcon(resource + "about.png"));
+    ui->actionCancel->setIcon(QIcon::fromTheme("process-stop"));
+    ui->actionExplain->setIcon(QIcon::fromTheme("system-search", QIcon::fromTheme("edit-find")));
 }
 
 /*
@@ -200,11 +321,9 @@ void MainWindow::initializeToolbars()
 
         if (editor == nullptr) return;
 
-        QString str = editor->toPlainText();
-        editor->clear();
-        int size = fontSizeComboBox->currentText().toInt();
-        editor->setFontPointSize(size);
-        editor->setText(str);
+        QFont font = editor->font();
+        font.setPointSize(fontSizeComboBox->currentText().toInt());
+        editor->setFont(font);
     });
 
     // Adding standard font sizes to the size combo box
@@ -236,6 +355,18 @@ void MainWindow::initializeToolbars()
     auto runTb = addToolBar(tr("Run"));
     runTb->setObjectName("run_tb");
     runTb->addAction(ui->actionRun);
+    runTb->addAction(ui->actionRunStatement);
+    runTb->addAction(ui->actionExplain);
+    runTb->addAction(ui->actionCancel);
+
+    //! Query timeout, statements running longer than this are interrupted
+    //!
+    queryTimeoutSpinBox = new QSpinBox(this);
+    queryTimeoutSpinBox->setRange(0, 24 * 60 * 60);
+    queryTimeoutSpinBox->setSuffix(tr(" s"));
+    queryTimeoutSpinBox->setSpecialValueText(tr("No timeout"));
+    queryTimeoutSpinBox->setToolTip(tr("Interrupt statements that run longer than this"));
+    runTb->addWidget(queryTimeoutSpinBox);
 }
 
 /*
@@ -251,19 +382,36 @@ void MainWindow::initializeUI()
     editor = new TextEdit(this);
     editor->setPlaceholderText(tr("Sql statement..."));
     completer = new QCompleter(this);
-    completer->setModel(modelFromFile(":/Resources/Completer/wordlist.txt"));
-    completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
     completer->setCaseSensitivity(Qt::CaseInsensitive);
     completer->setWrapAround(false);
     editor->setCompleter(completer);
+    editor->setKeywords(wordsFromFile(":/Resources/Completer/wordlist.txt"));
 
     //! Default Format Stream
     FormatStream* fs = new FormatStream(editor->document());
-    Q_UNUSED(fs)
+    connect(editor, &TextEdit::visibleBlocksChanged, fs, &FormatStream::setVisibleBlocks);
 
     tableView = new QTableView(this);
-    activityLog = new QListWidget(this);
+    activityLog = new QTreeWidget(this);
     activityLog->setFont(QFont("Calibri"));
+    activityLog->setColumnCount(HistoryColumnCount);
+    activityLog->setHeaderLabels({tr("Message"), tr("Time (ms)"), tr("First row (ms)"), tr("Rows"), tr("VM steps"), tr("Full scan steps"),
+                                  tr("Sorts"), tr("Auto indexes"), tr("Cache hits"), tr("Cache misses")});
+    activityLog->headerItem()->setToolTip(HistoryFullScanSteps, tr("Rows stepped through by full table scans, a high count means the statement scans instead of seeking"));
+    activityLog->headerItem()->setToolTip(HistorySorts, tr("Sorts that could not use an index"));
+    activityLog->headerItem()->setToolTip(HistoryAutoIndexes, tr("Rows inserted into indexes that sqlite created on the fly for the statement"));
+    activityLog->headerItem()->setToolTip(HistoryCacheMisses, tr("Pages that had to be read from the database document"));
+    activityLog->header()->setStretchLastSection(false);
+    activityLog->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    activityLog->header()->setSectionResizeMode(HistoryMessage, QHeaderView::Stretch);
+    activityLog->setUniformRowHeights(true);
+    tableBrowser = new TableBrowser(this);
+    parameterPanel = new ParameterPanel(this);
+    planView = new PlanView(this);
+
+    //! hit rate of the prepared statement cache of the query engine
+    statementCacheLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(statementCacheLabel);
 
     //! custom widget
     resultPanel = new QTabWidget(this);
@@ -271,6 +419,9 @@ void MainWindow::initializeUI()
     resultPanel->setTabPosition(QTabWidget::East);
     resultPanel->addTab(tableView, tr("Result"));
     resultPanel->addTab(activityLog, tr("History"));
+    resultPanel->addTab(tableBrowser, tr("Browse"));
+    resultPanel->addTab(parameterPanel, tr("Parameters"));
+    resultPanel->addTab(planView, tr("Plan"));
 
     //! context menu for the result panel
     auto actionResultRemove = new QAction(tr("Remove current records"), this);
@@ -285,6 +436,9 @@ void MainWindow::initializeUI()
         case 1:
             activityLog->clear();
             break;
+        case 2:
+            tableBrowser->clear();
+            break;
         }
     });
 
@@ -362,17 +516,60 @@ void MainWindow::bind()
 
     // TreeView connections
     connect(solutionTree, &SolutionTreeWidget::selectedItemChanged, this, &MainWindow::onSelectedItemChanged);
+    connect(solutionTree, &SolutionTreeWidget::databaseRemoved, [&](const QString& path)
+    {
+        engine->closeDatabase(path);
+        completionIndexes.remove(path);
+        attachedDatabases.remove(path);
+        updateAttachedIndexes();
+    });
     connect(solutionTree, &SolutionTreeWidget::statementRequested, this, &MainWindow::onStatementRequested);
-    connect(solutionTree, &SolutionTreeWidget::itemDoubleClicked, [&](){
+    connect(solutionTree, &SolutionTreeWidget::tableBrowseRequested, this, &MainWindow::onTableBrowseRequested);
+    connect(solutionTree, &SolutionTreeWidget::doubleClicked, [&](){
 
         if (solutionTree->getSelectedItemType() == SolutionTreeWidget::Table)
         {
-            QString tableName = solutionTree->currentItem()->text(0);
+            QString tableName = solutionTree->selectedTable();
             editor->insertPlainText(tableName);
         }
     });
 
     connect(solutionTree, &SolutionTreeWidget::tableGeneratorRequested, this, &MainWindow::onTableGeneratorRequested);
+    connect(solutionTree, &SolutionTreeWidget::csvImportRequested, this, &MainWindow::onCsvImportRequested);
+    connect(solutionTree, &SolutionTreeWidget::backupRequested, this, &MainWindow::onBackupRequested);
+    connect(solutionTree, &SolutionTreeWidget::dumpRequested, this, &MainWindow::onDumpRequested);
+    connect(solutionTree, &SolutionTreeWidget::restoreRequested, this, &MainWindow::onRestoreRequested);
+    connect(solutionTree, &SolutionTreeWidget::connectionSettingsRequested, this, &MainWindow::onConnectionSettingsRequested);
+    connect(solutionTree, &SolutionTreeWidget::attachRequested, this, &MainWindow::onAttachRequested);
+    connect(solutionTree, &SolutionTreeWidget::detachRequested, this, &MainWindow::onDetachRequested);
+
+    // the parameter panel follows the statement under the caret, once the typing pauses. Moving the caret within the statement the panel shows
+    // changes nothing, editing may change any statement
+    auto parameterTimer = new QTimer(this);
+    parameterTimer->setSingleShot(true);
+    parameterTimer->setInterval(300);
+    connect(editor, &TextEdit::textChanged, [=]()
+    {
+        parameterStatementStart = parameterStatementEnd = -1;
+        parameterTimer->start();
+    });
+    connect(editor, &TextEdit::cursorPositionChanged, [=]()
+    {
+        const int position = editor->textCursor().position();
+        if (position < parameterStatementStart || position > parameterStatementEnd)
+            parameterTimer->start();
+    });
+    connect(parameterTimer, &QTimer::timeout, [=]()
+    {
+        const SqlStatement statement = editor->currentStatement();
+        parameterStatementStart = statement.start;
+        parameterStatementEnd = statement.text.isEmpty() ? -1 : statement.start + statement.length;
+        parameterPanel->setStatement(statement.text);
+    });
+    connect(parameterPanel, &ParameterPanel::parametersChanged, [=](int count)
+    {
+        resultPanel->setTabText(resultPanel->indexOf(parameterPanel), count > 0 ? tr("Parameters (%1)").arg(count) : tr("Parameters"));
+    });
 }
 
 /*
@@ -416,18 +613,63 @@ void MainWindow::on_actionOpen_triggered()
         if(load(str))
         {
             solutionTree->addItemTotheExplorar(str);
-            loadTablesToTheSelectedDatabase();
         }
     }
 }
 
+/*
+ * opens an existing .sql document in the editor.
+ */
+void MainWindow::on_actionOpenScript_triggered()
+{
+    if (editor->document()->isModified() && QMessageBox::question(this, tr("Open SQL Script"),
+            tr("The editor has unsaved changes, discard them?")) != QMessageBox::Yes)
+        return;
+
+    const QString path = QFileDialog::getOpenFileName(this, tr("Open SQL Script..."), QString(),
+                                                      tr("structured query language file (*.sql);;all files (*)"));
+    if (!path.isEmpty())
+        openScript(path);
+}
+
 /*
  * Execute the statement
  */
 void MainWindow::on_actionRun_triggered()
+{
+    runCommand(editor->toPlainText(), 1);
+}
+
+/*
+ * Execute only the text that is selected in the editor
+ */
+void MainWindow::on_actionRunSelection_triggered()
+{
+    if (!editor->textCursor().hasSelection())
+    {
+        statusBar()->showMessage(tr("Select the statements to execute first"), 5000);
+        return;
+    }
+
+    runCommand(editor->selectedSql(), editor->selectionFirstLine());
+}
+
+/*
+ * Execute only the statement the cursor is in, so that expensive statements around it are not executed again
+ */
+void MainWindow::on_actionRunStatement_triggered()
+{
+    const SqlStatement statement = editor->currentStatement();
+    runCommand(statement.text, statement.line);
+}
+
+/*
+ * Hands the command over to the query engine. firstLine is the editor line the command starts at, used to point at the right line when a statement fails.
+ */
+void MainWindow::runCommand(const QString &command, int firstLine)
 {
     // Check if the global database is points to some document
-    if (!database.isOpen())
+    if (engine->databasePath().isEmpty())
     {
         auto msgBox = new QMessageBox(this);
         msgBox->setIcon(QMessageBox::Information);
@@ -437,44 +679,360 @@ void MainWindow::on_actionRun_triggered()
         return;
     }
 
-    // Get the text typed in the editor
-    const QString command = editor->toPlainText();
+    // Return if there is nothing to execute
     if ((command.isEmpty() || command.isNull()) || command.trimmed().isEmpty())
         return;
 
-    // Executing the command, or query, and report if any error occurred
-    QSqlQuery query;
-    if (!query.exec(command))
+    // The outcome is reported back through onQueryFinished, onScriptFinished or onQueryFailed
+    runLineOffset = firstLine - 1;
+
+    // a single statement with parameters is bound to the values of the parameter panel, several rows of values make a batch. Only the statement
+    // itself goes to the engine, without the semicolon and comments around it, since its text is also wrapped to read dropped pages again
+    const QStringList parameters = SqlLexer::parameters(command);
+    const QVector<SqlStatement> statements = SqlLexer::splitStatements(command);
+    if (!parameters.isEmpty() && statements.size() == 1)
     {
-        checkLastErrorIfAny(&query);
+        const SqlStatement& statement = statements.first();
+        runLineOffset += statement.line - 1;
+
+        const QVector<QVariantList> rows = parameterPanel->rows(parameters);
+        if (rows.size() > 1)
+            engine->executeBatch(statement.text, rows);
+        else
+            engine->execute(statement.text, rows.value(0));
         return;
     }
 
-    //! At this point, the query is successfully exectuted
-    //!
+    engine->executeScript(command, ui->actionRunInTransaction->isChecked());
+}
+
+/*
+ * Asks the query engine for the plan of the selected statement, or of the statement the cursor is in; the plan shows up in the Plan tab.
+ * Only the first statement of a selection is explained.
+ */
+void MainWindow::on_actionExplain_triggered()
+{
+    if (engine->databasePath().isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before explaining statements."), 5000);
+        return;
+    }
+
+    const QString text = editor->textCursor().hasSelection() ? editor->selectedSql() : editor->currentStatement().text;
+    const QVector<SqlStatement> statements = SqlLexer::splitStatements(text);
+    if (statements.isEmpty() || statements.first().text.trimmed().isEmpty())
+        return;
+
+    engine->explain(statements.first().text, ui->actionExplainBytecode->isChecked());
+}
+
+/*
+ * Executes the selected statement, or the statement the cursor is in, once more and streams its rows into a file. The rows go from the worker
+ * straight into the file, the Result tab is not involved, so any number of rows can be exported. The format follows the chosen file type.
+ */
+void MainWindow::on_actionExportResults_triggered()
+{
+    if (engine->databasePath().isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before exporting results."), 5000);
+        return;
+    }
+
+    const QString text = editor->textCursor().hasSelection() ? editor->selectedSql() : editor->currentStatement().text;
+    const QVector<SqlStatement> statements = SqlLexer::splitStatements(text);
+    if (statements.isEmpty() || statements.first().text.trimmed().isEmpty())
+    {
+        statusBar()->showMessage(tr("Place the cursor in the select statement to export first"), 5000);
+        return;
+    }
+
+    struct FileType
+    {
+        QString filter;
+        QString suffix;
+        ExportFormat format;
+        bool gzip;
+    };
+    const QVector<FileType> types =
+    {
+        { tr("comma separated values (*.csv)"), ".csv", ExportFormat::Csv, false },
+        { tr("comma separated values, gzip (*.csv.gz)"), ".csv.gz", ExportFormat::Csv, true },
+        { tr("tab separated values (*.tsv)"), ".tsv", ExportFormat::Tsv, false },
+        { tr("tab separated values, gzip (*.tsv.gz)"), ".tsv.gz", ExportFormat::Tsv, true },
+        { tr("JSON Lines (*.jsonl)"), ".jsonl", ExportFormat::JsonLines, false },
+        { tr("JSON Lines, gzip (*.jsonl.gz)"), ".jsonl.gz", ExportFormat::JsonLines, true },
+        { tr("SQL insert statements (*.sql)"), ".sql", ExportFormat::SqlInsert, false },
+        { tr("SQL insert statements, gzip (*.sql.gz)"), ".sql.gz", ExportFormat::SqlInsert, true }
+    };
+
+    QStringList filters;
+    foreach (const FileType& type, types)
+        filters << type.filter;
+
+    QString selectedFilter = filters.first();
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Results..."), QString(), filters.join(";;"), &selectedFilter);
+    if (fileName.isEmpty())
+        return;
+
+    const FileType& type = types.at(qMax(0, filters.indexOf(selectedFilter)));
+    if (!fileName.endsWith(type.suffix, Qt::CaseInsensitive))
+        fileName += type.suffix;
+
+    ResultExport request;
+    request.statement = statements.first().text;
+    request.fileName = fileName;
+    request.format = type.format;
+    request.gzip = type.gzip;
+
+    if (request.format == ExportFormat::SqlInsert)
+    {
+        bool ok = false;
+        request.table = QInputDialog::getText(this, tr("Export Results"), tr("Table the insert statements write into:"), QLineEdit::Normal, "exported_rows", &ok).trimmed();
+        if (!ok || request.table.isEmpty())
+            return;
+    }
+
+    const QStringList parameters = SqlLexer::parameters(request.statement);
+    if (!parameters.isEmpty())
+        request.values = parameterPanel->rows(parameters).value(0);
+
+    statusBar()->showMessage(tr("Exporting..."));
+    engine->exportResult(request);
+}
+
+void MainWindow::onExportProgress(qint64 rows, qint64 bytes)
+{
+    statusBar()->showMessage(tr("Exporting... %1 rows, %2 MB written").arg(rows).arg(bytes / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
+/*
+ * Fires when an export ends. A failed or cancelled export leaves no file behind.
+ */
+void MainWindow::onExportFinished(const ResultExportResult &result)
+{
+    QString message;
+    if (!result.error.isEmpty())
+        message = tr("Export to %1 failed: %2").arg(QFileInfo(result.fileName).fileName(), result.error);
+    else if (result.cancelled)
+        message = tr("Export to %1 cancelled after %2 rows").arg(QFileInfo(result.fileName).fileName()).arg(result.rows);
+    else
+        message = tr("Exported %1 rows to %2 (%3 MB) in %4 ms").arg(result.rows).arg(QFileInfo(result.fileName).fileName())
+                .arg(result.bytes / (1024.0 * 1024.0), 0, 'f', 1).arg(result.elapsed);
+
+    statusBar()->showMessage(message, 5000);
+
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+    indice->setText(HistoryRows, QString::number(result.rows));
+}
+
+/*
+ * Fires when the plan asked for by on_actionExplain_triggered arrives from the worker thread.
+ */
+void MainWindow::onPlanReady(const QueryPlan &plan)
+{
+    planView->showPlan(plan);
+    resultPanel->setCurrentWidget(planView);
+}
+
+/*
+ * Stops the statement that is currently executing in the query engine
+ */
+void MainWindow::on_actionCancel_triggered()
+{
+    statusBar()->showMessage(tr("Cancelling..."));
+    engine->cancel();
+}
+
+/*
+ * Fires when the query engine starts executing a statement in its worker thread.
+ */
+void MainWindow::onQueryStarted(const QString &command)
+{
+    Q_UNUSED(command)
+    statusBar()->showMessage(tr("Executing..."));
+}
+
+/*
+ * Fires when the query engine has successfully executed a statement. For select statements the rows are already streaming into the tableModel.
+ */
+void MainWindow::onQueryFinished(const ExecutionResult &result)
+{
+    statusBar()->showMessage(tr("Executed in %1 ms").arg(result.elapsed), 5000);
 
     // Get the query type that was executed, and generate the appropriate message that needs to be shown in the Activity Log
     QString message;
-    auto queryType = getQueryType(command, message, query.numRowsAffected());
+    auto queryType = getQueryType(result.command, message, result.rowsAffected);
 
-    if (queryType == ExecuteQueryType::SelectStatement)
+    if (result.isSelect || queryType == ExecuteQueryType::SelectStatement)
     {
+        // the rows column of the entry keeps counting while the view fetches more rows
+        addHistoryEntry(QIcon(resource + "execute.png"), tr("Succeed"), &result);
         resultPanel->setCurrentIndex(0);
-        tableModel->setQuery(query);
     }
     else
     {
-        // Load or remove tables, if new tables are created or removed old ones.
-        if (queryType == ExecuteQueryType::CreateStatement || queryType == ExecuteQueryType::DropStatement)
-            loadTablesToTheSelectedDatabase();
+        if (result.boundRows > 0)
+            message += tr(", executed for %1 rows of parameters").arg(result.boundRows);
 
-        QListWidgetItem* indice = new QListWidgetItem(QIcon(resource + "execute.png"), message, activityLog);
-        indice->setToolTip(command.trimmed());
+        auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, &result);
         activityLog->setCurrentItem(indice);
         resultPanel->setCurrentIndex(1);
     }
 }
 
+/*
+ * Fires when the query engine could not execute a statement.
+ */
+void MainWindow::onQueryFailed(const ExecutionResult &result, const QString &error)
+{
+    statusBar()->clearMessage();
+    checkLastErrorIfAny(result, error);
+}
+
+/*
+ * Fires periodically while the query engine executes a script.
+ */
+void MainWindow::onScriptProgress(int executed, int count)
+{
+    statusBar()->showMessage(tr("Executing... %1 of %2 statements").arg(executed).arg(count));
+}
+
+/*
+ * Fires when every statement of a script was executed. Adds a summary to the Activity Log, followed by the timing of each statement, or only of the
+ * slowest ones when the script is long.
+ */
+void MainWindow::onScriptFinished(const ScriptResult &result)
+{
+    const int maxLoggedStatements = 20;
+    const int count = result.statements.size();
+    statusBar()->showMessage(tr("Executed %1 statements in %2 ms").arg(count).arg(result.elapsed), 5000);
+
+    bool showsRows = false;
+    if (count > 0)
+        showsRows = result.statements.last().isSelect;
+
+    QString summary = tr("Script: %1 statements executed in %2 ms").arg(count).arg(result.elapsed);
+    if (result.transaction)
+        summary += tr(" (single transaction)");
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), summary, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+
+    QVector<ExecutionResult> logged = result.statements;
+    if (logged.size() > maxLoggedStatements)
+    {
+        std::partial_sort(logged.begin(), logged.begin() + maxLoggedStatements, logged.end(), [](const ExecutionResult& a, const ExecutionResult& b)
+        {
+            return a.elapsed > b.elapsed;
+        });
+        logged.resize(maxLoggedStatements);
+        indice->setText(HistoryMessage, summary + tr(", slowest %1 statements:").arg(maxLoggedStatements));
+    }
+
+    QString message;
+    foreach (const ExecutionResult& statement, logged)
+    {
+        getQueryType(statement.command, message, statement.rowsAffected);
+        if (statement.isSelect)
+            message = tr("Succeed");
+
+        addHistoryEntry(QIcon(), tr("#%1 (line %2): %3").arg(statement.statementIndex + 1).arg(statement.line + runLineOffset).arg(message), &statement, indice);
+    }
+
+    indice->setExpanded(true);
+    activityLog->setCurrentItem(indice);
+    resultPanel->setCurrentIndex(showsRows ? 0 : 1);
+}
+
+/*
+ * Fires when more rows of the last select statement were fetched, and updates its entry in the Activity Log.
+ */
+void MainWindow::onStatisticsUpdated(const ExecutionResult &result)
+{
+    // the entry is a recent one, either on its own or as a statement of a script
+    for (int i = activityLog->topLevelItemCount() - 1; i >= 0; --i)
+    {
+        QTreeWidgetItem* item = activityLog->topLevelItem(i);
+        for (int j = -1; j < item->childCount(); ++j)
+        {
+            QTreeWidgetItem* entry = j < 0 ? item : item->child(j);
+            if (entry->data(HistoryMessage, Qt::UserRole).toInt() == result.resultId)
+            {
+                setHistoryStatistics(entry, result);
+                return;
+            }
+        }
+    }
+}
+
+/*
+ * Fires after every run, shows how often the statements were found in the prepared statement cache of the connection.
+ */
+void MainWindow::onStatementCacheUpdated(qint64 hits, qint64 misses, int size)
+{
+    const qint64 lookups = hits + misses;
+    if (lookups == 0)
+    {
+        statementCacheLabel->clear();
+        return;
+    }
+
+    statementCacheLabel->setText(tr("Statement cache: %1% hits").arg(hits * 100 / lookups));
+    statementCacheLabel->setToolTip(tr("%1 of %2 statements were already prepared, %3 prepared statements are cached").arg(hits).arg(lookups).arg(size));
+}
+
+/*
+ * Adds an entry to the Activity Log, with the counters of the statement if there is one.
+ */
+QTreeWidgetItem* MainWindow::addHistoryEntry(const QIcon &icon, const QString &message, const ExecutionResult *result, QTreeWidgetItem *parent)
+{
+    auto item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(activityLog);
+    item->setIcon(HistoryMessage, icon);
+    item->setText(HistoryMessage, message);
+
+    if (result)
+    {
+        item->setToolTip(HistoryMessage, result->command.trimmed());
+        item->setData(HistoryMessage, Qt::UserRole, result->resultId);
+        item->setText(HistoryTime, QString::number(result->elapsed));
+        if (result->firstRowTime >= 0)
+            item->setText(HistoryFirstRow, QString::number(result->firstRowTime));
+        setHistoryStatistics(item, *result);
+    }
+
+    return item;
+}
+
+/*
+ * Shows the counters of a statement in its Activity Log entry. Full table scans, sorts and automatic indexes are highlighted, they are what makes a
+ * statement scan instead of seek.
+ */
+void MainWindow::setHistoryStatistics(QTreeWidgetItem *item, const ExecutionResult &result)
+{
+    for (int column = HistoryTime; column < HistoryColumnCount; ++column)
+        item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+
+    if (result.isSelect)
+        item->setText(HistoryRows, QString::number(result.rowsReturned));
+    else
+        item->setText(HistoryRows, QString::number(result.rowsAffected));
+
+    item->setText(HistoryVmSteps, QString::number(result.vmSteps));
+    item->setText(HistoryFullScanSteps, QString::number(result.fullScanSteps));
+    item->setText(HistorySorts, QString::number(result.sorts));
+    item->setText(HistoryAutoIndexes, QString::number(result.autoIndexes));
+    item->setText(HistoryCacheHits, QString::number(result.cacheHits));
+    item->setText(HistoryCacheMisses, QString::number(result.cacheMisses));
+
+    const QBrush warning(Qt::red);
+    if (result.fullScanSteps > 0)
+        item->setForeground(HistoryFullScanSteps, warning);
+    if (result.sorts > 0)
+        item->setForeground(HistorySorts, warning);
+    if (result.autoIndexes > 0)
+        item->setForeground(HistoryAutoIndexes, warning);
+}
+
 /*
  * MainWindow::on_actionNativeWindowsUI_triggered
  * toggle between the Windows Vista Theme and Fusion Theme (only on Windows)
@@ -499,6 +1057,30 @@ void MainWindow::on_actionShowTextOnToolbar_triggered(bool checked)
         setToolButtonStyle(Qt::ToolButtonFollowStyle);
 }
 
+/*
+ * Lets the user choose how much memory the rows of a result set may occupy, older pages are dropped and read again when the limit is reached
+ */
+void MainWindow::on_actionResultMemoryBudget_triggered()
+{
+    bool ok = false;
+    const int megabytes = QInputDialog::getInt(this, tr("Result Memory Budget"), tr("Memory for the rows of a result set (MB):"),
+                                               int(tableModel->memoryBudget() / (1024 * 1024)), 16, 64 * 1024, 16, &ok);
+    if (ok)
+        tableModel->setMemoryBudget(qint64(megabytes) * 1024 * 1024);
+}
+
+/*
+ * Lets the user choose how many databases keep their connection open. Switching to one of them costs nothing, the others are opened again
+ */
+void MainWindow::on_actionConnectionPoolSize_triggered()
+{
+    bool ok = false;
+    const int connections = QInputDialog::getInt(this, tr("Open Connections"), tr("Databases whose connection is kept open:"),
+                                                 engine->poolSize(), 1, 64, 1, &ok);
+    if (ok)
+        engine->setPoolSize(connections);
+}
+
 /*
  * Displays the about Window
  */
@@ -547,27 +1129,21 @@ void MainWindow::on_actionAbout_Framework_triggered()
 }
 
 /*
- * Make the necessary pre requesites when a database document is created or opened. Set the opened database document as the one that is pointed by the global
- * 'database' object in the application. and if the specified database file is not valid for any reason, a new document is created at the specified path silently.
+ * Make the necessary pre requesites when a database document is created or opened. Set the opened database document as the one the query engine works
+ * on. and if the specified database file doesn't exist, a new document is created at the specified path silently. The engine opens the document in its
+ * own thread and reports a document that is not a valid database through opened().
  */
 bool MainWindow::load(const QString &str)
 {
-    if (QFile::exists(str))
+    if (!QFile::exists(str))
     {
-        database.setDatabaseName(str);
-        checkLastErrorIfAny();
-        return database.open();
+        QFile db(str);
+        if (!db.open(QIODevice::WriteOnly))
+            return false;
     }
 
-    QFile db(str);
-    if (db.open(QIODevice::WriteOnly))
-    {
-        database.setDatabaseName(str);
-        checkLastErrorIfAny();
-        return database.open();
-    }
-
-    return false;
+    engine->open(str);
+    return true;
 }
 
 /*
@@ -602,87 +1178,61 @@ MainWindow::ExecuteQueryType MainWindow::getQueryType(const QString &query, QStr
 }
 
 /*
- * Loads all the tables that are already stored in a database document and add each table indicators to the treeView underneath the database name Item.
+ * Fires when a statement was interrupted by the Cancel action or by its timeout. Reports how far the statement got before it was stopped.
  */
-void MainWindow::loadTablesToTheSelectedDatabase()
-{   
-    // Load all the tables in the current item
-    auto ci = solutionTree->currentItem();
-    if (ci)
-    {
-        if (solutionTree->getSelectedItemType() == SolutionTreeWidget::SelectedItemType::Table)
-            ci = ci->parent();
-
-        // First we remove all the tables in the item
-        foreach (QTreeWidgetItem* i, ci->takeChildren())
-        {
-            delete i;
-        }
+void MainWindow::onQueryAborted(const ExecutionResult &result)
+{
+    statusBar()->clearMessage();
 
-        const QString stmt = "Select distinct tbl_name from sqlite_master";
-        QSqlQuery query; query.exec(stmt);
-        while (query.next())
-        {
-            // Get the table name
-            const QString t = query.value(0).toString();
+    const QString reason = result.abortReason == AbortReason::TimedOut ? tr("Timed out") : tr("Cancelled");
+    const QString message = tr("%1 after %2 ms: about %3 steps executed").arg(reason).arg(result.elapsed).arg(result.progressSteps);
 
-            auto contains = [&](const QString& tableName)
-            {
-                for (int i = 0; i < ci->childCount(); ++i)
-                    if (tableName == ci->child(i)->text(0) || tableName == "sqlite_sequence")
-                        return true;
-                return false;
-            };
-
-            if (!contains(t))
-                solutionTree->addItemToTheSelectedNode(t);
-        }
-    }
+    auto indice = addHistoryEntry(QIcon::fromTheme("process-stop", QIcon(resource + "execute.png")), message, &result);
+    activityLog->setCurrentItem(indice);
+    resultPanel->setCurrentIndex(1);
 }
 
 /*
- * This function is executed manually after doing any database related task, such as executing a query, changing the global database object to point into
- * another database document etc. and it checks weather there are any error occured by the global database object, and immedietly reports  it to the user if any.
+ * Reports an error that occurred in the query engine. The engine runs in another thread, so the error arrives as text instead of a QSqlQuery. For
+ * scripts, the statement that failed is pointed out by its number and line.
  */
-void MainWindow::checkLastErrorIfAny(QSqlQuery *query)
+void MainWindow::checkLastErrorIfAny(const ExecutionResult &result, const QString &error)
 {
-    if (query)
-    {
-        if (query->lastError().isValid())
-        {
-            QMessageBox::critical(this, tr(""), query->lastError().text());
-        }
-
+    if (error.isEmpty())
         return;
-    }
 
-    if (database.lastError().isValid())
-    {
-        auto msgBox = new QMessageBox(this);
-        msgBox->setText(database.lastError().text());
-        msgBox->setIcon(QMessageBox::Critical);
-        msgBox->exec();
-        delete msgBox;
-    }
+    QMessageBox msgBox(this);
+    msgBox.setIcon(QMessageBox::Critical);
+    msgBox.setText(error);
+    if (result.statementCount > 1 && result.statementIndex >= 0)
+        msgBox.setInformativeText(tr("Statement %1 of %2, at line %3, failed.").arg(result.statementIndex + 1).arg(result.statementCount).arg(result.line + runLineOffset));
+    else if (runLineOffset > 0)
+        msgBox.setInformativeText(tr("The statement at line %1 failed.").arg(result.line + runLineOffset));
+    msgBox.setDetailedText(result.command.trimmed());
+    msgBox.exec();
 }
 
 /*
  * This event is fired whenever an item is selected in the SolutionTreeWidget by the user. It set the selected database (if the selected item is a database)
  * as the active one (or the one that points by the global database object).
  */
-void MainWindow::onSelectedItemChanged(QTreeWidgetItem *item, SolutionTreeWidget::SelectedItemType t)
+void MainWindow::onSelectedItemChanged(const QString &path, SolutionTreeWidget::SelectedItemType t)
 {
-    // databases cannot be nullptr, throw an exception if any occurred.
+    // databases cannot be empty, throw an exception if any occurred.
     if (t == SolutionTreeWidget::Database)
     {
-        Q_ASSERT(item);
+        Q_ASSERT(!path.isEmpty());
     }
 
-    // check for empty items | when the items are removed from the solution tree and if there are no items left, the item will be a nullptr.
-    // so this check is useful for scenario where the topLevelItemCount is zero.
-    if (!item)
+    // check for empty items | when the items are removed from the solution tree and if there are no items left, the path will be empty.
+    // so this check is useful for scenario where the tree holds no database.
+    if (path.isEmpty())
     {
-        database.close();
+        engine->close();
+        validator->setDatabase(QString());
+        editor->setCompletionIndex(nullptr);
+        updateAttachedIndexes();
+        tableBrowser->clear();
         setSelectedDatabaseIndicatorVisible("Empty");
         return;
     }
@@ -690,22 +1240,17 @@ void MainWindow::onSelectedItemChanged(QTreeWidgetItem *item, SolutionTreeWidget
     // normal use when the selected items being changed
     switch (t)
     {
-    // if selected item is a database, set the gloabal database object to point to the selected one, and open it...
+    // if selected item is a database, or a table, view, column, index or trigger of one, make that database the active one. The engine keeps its
+    // connection open once it was opened, so switching back and forth doesn't reopen anything...
     case SolutionTreeWidget::SelectedItemType::Database:
-        database.setDatabaseName(item->toolTip(0));
-        database.open();
-        setSelectedDatabaseIndicatorVisible(item->text(0));
-        break;
-
-    // if selected item is a table, set it's parent (the database in this case) as the global database object, and open it...
     case SolutionTreeWidget::SelectedItemType::Table:
-        if (item->parent())
-        {
-            database.setDatabaseName(item->parent()->toolTip(0));
-            database.open();
-            setSelectedDatabaseIndicatorVisible(item->parent()->text(0));
-        }
-
+    case SolutionTreeWidget::SelectedItemType::Detail:
+        if (engine->databasePath() != path)
+            tableBrowser->clear();
+        engine->open(path);
+        editor->setCompletionIndex(completionIndexes.value(path).data());
+        updateAttachedIndexes();
+        setSelectedDatabaseIndicatorVisible(QFileInfo(path).fileName());
         break;
 
     default:
@@ -713,12 +1258,63 @@ void MainWindow::onSelectedItemChanged(QTreeWidgetItem *item, SolutionTreeWidget
     }
 }
 
+/*
+ * Keeps the completion index of a database up to date. The engine reports the whole schema when a database is opened, and only what changed
+ * after the statements that altered it.
+ */
+void MainWindow::onSchemaUpdated(const SchemaDelta &delta)
+{
+    QSharedPointer<CompletionIndex>& index = completionIndexes[delta.path];
+    const bool created = !index;
+    if (created)
+        index.reset(new CompletionIndex);
+    index->apply(delta);
+
+    if (delta.path == engine->databasePath())
+        editor->setCompletionIndex(index.data());
+
+    // the database may be attached to the active one
+    else if (created)
+        updateAttachedIndexes();
+}
+
+/*
+ * Hands the editor the names of the databases attached to the active one. An attached file has names to complete if it is open in the explorar
+ * as well, the schema name is completed either way.
+ */
+void MainWindow::updateAttachedIndexes()
+{
+    QHash<QString, const CompletionIndex*> indexes;
+    const QVariantMap databases = attachedDatabases.value(engine->databasePath());
+    for (auto i = databases.constBegin(); i != databases.constEnd(); ++i)
+    {
+        const QString file = QFileInfo(i.value().toString()).canonicalFilePath();
+        const CompletionIndex* index = nullptr;
+        for (auto c = completionIndexes.constBegin(); c != completionIndexes.constEnd() && !index; ++c)
+        {
+            if (QFileInfo(c.key()).canonicalFilePath() == file)
+                index = c.value().data();
+        }
+        indexes.insert(i.key(), index);
+    }
+    editor->setAttachedIndexes(indexes);
+}
+
 /*
  * set text (sql command) to the editor
  */
 void MainWindow::onStatementRequested(QString command)
 {
-    editor->setText(command);
+    editor->setPlainText(command);
+}
+
+/*
+ * shows a table of the selected database in the browser
+ */
+void MainWindow::onTableBrowseRequested(QString table)
+{
+    tableBrowser->browse(table);
+    resultPanel->setCurrentWidget(tableBrowser);
 }
 
 /*
@@ -730,11 +1326,439 @@ void MainWindow::onTableGeneratorRequested()
     tblgen.resize(455, 350);
     if (tblgen.exec() == QDialog::Accepted)
     {
-        editor->setText(tblgen.Generate());
+        editor->setPlainText(tblgen.Generate());
         editor->document()->setModified(true);
     }
 }
 
+/*
+ * Shows the CSV import dialog for the selected database. The dialog hands the import to the query engine and follows its progress until it is
+ * closed.
+ */
+void MainWindow::onCsvImportRequested()
+{
+    if (engine->databasePath().isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before importing files."), 5000);
+        return;
+    }
+
+    if (engine->isBusy())
+    {
+        statusBar()->showMessage(tr("Wait for the running statement to finish, or cancel it, before importing files."), 5000);
+        return;
+    }
+
+    CsvImportDialog dialog(this);
+    connect(&dialog, &CsvImportDialog::importRequested, engine, &QueryEngine::importCsv);
+    connect(&dialog, &CsvImportDialog::cancelRequested, engine, &QueryEngine::cancel);
+    connect(engine, &QueryEngine::importProgress, &dialog, &CsvImportDialog::showProgress);
+    connect(engine, &QueryEngine::importFinished, &dialog, &CsvImportDialog::showResult);
+    dialog.exec();
+}
+
+/*
+ * Fires when an import ends, successfully or not. Adds it to the Activity Log and shows the new table in the explorar.
+ */
+void MainWindow::onCsvImportFinished(const CsvImportResult &result)
+{
+    QString message = tr("Imported %1 records from %2 into %3 in %4 ms")
+            .arg(result.rows).arg(QFileInfo(result.fileName).fileName(), result.table).arg(result.elapsed);
+    if (!result.error.isEmpty())
+        message += tr(", stopped: %1").arg(result.error);
+    else if (result.cancelled)
+        message += tr(", cancelled");
+
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+    indice->setText(HistoryRows, QString::number(result.rows));
+
+    tableBrowser->invalidate();
+}
+
+/*
+ * Backs the selected database up into a new file while it stays in use. Databases that fit comfortably in memory are snapshot into memory
+ * first, larger ones are copied straight into the file.
+ */
+void MainWindow::onBackupRequested()
+{
+    const qint64 throughMemoryLimit = 256 * 1024 * 1024;
+
+    const QString source = engine->databasePath();
+    if (source.isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before backing it up."), 5000);
+        return;
+    }
+
+    if (engine->isBusy())
+    {
+        statusBar()->showMessage(tr("Wait for the running statement to finish, or cancel it, before backing up."), 5000);
+        return;
+    }
+
+    const QFileInfo info(source);
+    const QString target = QFileDialog::getSaveFileName(this, tr("Backup Database..."), info.absoluteDir().filePath(info.completeBaseName() + "-backup." + info.suffix()),
+                                                        tr("sqlite database (*.db *.sqlite *.sqlite3);;all files (*)"));
+    if (target.isEmpty())
+        return;
+
+    if (QFileInfo(target).absoluteFilePath() == info.absoluteFilePath())
+    {
+        statusBar()->showMessage(tr("A database cannot be backed up into itself."), 5000);
+        return;
+    }
+
+    DatabaseBackup request;
+    request.target = target;
+    request.throughMemory = info.size() < throughMemoryLimit;
+
+    QProgressDialog progress(tr("Backing up %1...").arg(info.fileName()), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    connect(&progress, &QProgressDialog::canceled, engine, &QueryEngine::cancel);
+    connect(engine, &QueryEngine::backupProgress, &progress, [&](int remaining, int pageCount)
+    {
+        progress.setMaximum(pageCount);
+        progress.setValue(pageCount - remaining);
+        progress.setLabelText(tr("Backing up %1... %2 of %3 pages").arg(info.fileName()).arg(pageCount - remaining).arg(pageCount));
+    });
+    connect(engine, &QueryEngine::backupFinished, &progress, &QProgressDialog::reset);
+
+    engine->backup(request);
+    progress.exec();
+}
+
+void MainWindow::onBackupFinished(const BackupResult &result)
+{
+    QString message;
+    if (!result.error.isEmpty())
+        message = tr("Backup to %1 failed: %2").arg(QFileInfo(result.target).fileName(), result.error);
+    else if (result.cancelled)
+        message = tr("Backup to %1 cancelled").arg(QFileInfo(result.target).fileName());
+    else
+        message = tr("Backed up %1 pages to %2 in %3 ms").arg(result.pages).arg(QFileInfo(result.target).fileName()).arg(result.elapsed);
+
+    statusBar()->showMessage(message, 5000);
+
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+}
+
+/*
+ * Writes the selected database as an SQL script, in parallel over several read connections when the database is in WAL mode.
+ */
+void MainWindow::onDumpRequested()
+{
+    const QString source = engine->databasePath();
+    if (source.isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before dumping it."), 5000);
+        return;
+    }
+
+    if (engine->isBusy())
+    {
+        statusBar()->showMessage(tr("Wait for the running statement to finish, or cancel it, before dumping."), 5000);
+        return;
+    }
+
+    const QFileInfo info(source);
+    DatabaseDump request;
+    request.target = QFileDialog::getSaveFileName(this, tr("Dump to SQL..."), info.absoluteDir().filePath(info.completeBaseName() + ".sql"),
+                                                  tr("sql script (*.sql);;all files (*)"));
+    if (request.target.isEmpty())
+        return;
+
+    QProgressDialog progress(tr("Dumping %1...").arg(info.fileName()), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    connect(&progress, &QProgressDialog::canceled, engine, &QueryEngine::cancel);
+    connect(engine, &QueryEngine::dumpProgress, &progress, [&](int tablesDone, int tableCount, qint64 rows)
+    {
+        progress.setMaximum(tableCount);
+        progress.setValue(tablesDone);
+        progress.setLabelText(tr("Dumping %1... %2 of %3 tables, %4 rows").arg(info.fileName()).arg(tablesDone).arg(tableCount).arg(rows));
+    });
+    connect(engine, &QueryEngine::dumpFinished, &progress, &QProgressDialog::reset);
+
+    engine->dump(request);
+    progress.exec();
+}
+
+void MainWindow::onDumpFinished(const DumpResult &result)
+{
+    QString message;
+    if (!result.error.isEmpty())
+        message = tr("Dump to %1 failed: %2").arg(QFileInfo(result.target).fileName(), result.error);
+    else if (result.cancelled)
+        message = tr("Dump to %1 cancelled").arg(QFileInfo(result.target).fileName());
+    else
+    {
+        message = tr("Dumped %1 tables, %2 rows to %3 in %4 ms over %5 connections")
+                .arg(result.tables).arg(result.rows).arg(QFileInfo(result.target).fileName()).arg(result.elapsed).arg(result.connections);
+        if (!result.consistent)
+            message += tr(", tables were read at slightly different moments");
+    }
+
+    statusBar()->showMessage(message, 5000);
+
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+    indice->setText(HistoryRows, QString::number(result.rows));
+}
+
+/*
+ * Lets the user choose the pragma profile the selected database is opened with, and edit the profiles. Every open database whose profile changed
+ * gets the new settings right away.
+ */
+void MainWindow::onConnectionSettingsRequested()
+{
+    const QString path = engine->databasePath();
+    if (path.isEmpty())
+        return;
+
+    ConnectionSettingsDialog dialog(path, connectionProfiles, databaseProfiles.value(path), this);
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+
+    const QVector<ConnectionProfile> previous = connectionProfiles;
+    connectionProfiles = dialog.profiles();
+    databaseProfiles.insert(path, dialog.selectedProfile().name);
+
+    for (auto i = databaseProfiles.constBegin(); i != databaseProfiles.constEnd(); ++i)
+    {
+        ConnectionProfile before;
+        foreach (const ConnectionProfile& profile, previous)
+            if (profile.name == i.value())
+                before = profile;
+
+        const ConnectionProfile after = connectionProfile(i.value());
+        if (i.key() == path || before != after)
+            engine->setConnectionProfile(i.key(), after);
+    }
+
+    statusBar()->showMessage(tr("Connection settings of %1 set to \"%2\".").arg(QFileInfo(path).fileName(), dialog.selectedProfile().name), 5000);
+}
+
+/*
+ * The profile saved under a name, or one that leaves every setting alone if there is none by that name anymore.
+ */
+ConnectionProfile MainWindow::connectionProfile(const QString &name) const
+{
+    foreach (const ConnectionProfile& profile, connectionProfiles)
+        if (profile.name == name)
+            return profile;
+
+    return ConnectionProfile();
+}
+
+/*
+ * Attaches another database of the explorar to the active one under a schema name. A single statement can then join the tables of both as
+ * schema.table, and sqlite runs the join itself instead of the rows being copied from one file to the other.
+ */
+void MainWindow::onAttachRequested()
+{
+    const QString active = engine->databasePath();
+    if (active.isEmpty())
+        return;
+
+    QStringList paths = solutionTree->databases();
+    paths.removeAll(active);
+    if (paths.isEmpty())
+    {
+        statusBar()->showMessage(tr("Open another database in the explorar first to attach it."), 5000);
+        return;
+    }
+
+    QStringList files;
+    foreach (const QString& path, paths)
+        files << QDir::toNativeSeparators(path);
+
+    bool ok = false;
+    const QString file = QInputDialog::getItem(this, tr("Attach Database"), tr("Database to attach to %1:").arg(QFileInfo(active).fileName()),
+                                               files, 0, false, &ok);
+    if (!ok)
+        return;
+    const QString path = paths.at(files.indexOf(file));
+
+    // the schema name is the name of the file unless the user chooses another one, statements write it unquoted so it is kept a plain word
+    QString schema = QFileInfo(path).completeBaseName();
+    for (QChar& c : schema)
+    {
+        if (!c.isLetterOrNumber())
+            c = QLatin1Char('_');
+    }
+
+    schema = QInputDialog::getText(this, tr("Attach Database"), tr("Schema name, the tables are then written as name.table:"), QLineEdit::Normal,
+                                   schema, &ok).trimmed();
+    if (!ok || schema.isEmpty())
+        return;
+
+    const QVariantMap attached = attachedDatabases.value(active);
+    for (auto i = attached.constBegin(); i != attached.constEnd(); ++i)
+    {
+        if (i.key().compare(schema, Qt::CaseInsensitive) == 0)
+        {
+            QMessageBox::warning(this, tr("Attach Database"), tr("%1 is attached under that name already.").arg(i.value().toString()));
+            return;
+        }
+    }
+
+    engine->attach(path, schema);
+}
+
+void MainWindow::onDetachRequested()
+{
+    const QStringList schemas = attachedDatabases.value(engine->databasePath()).keys();
+    if (schemas.isEmpty())
+    {
+        statusBar()->showMessage(tr("No database is attached to %1.").arg(QFileInfo(engine->databasePath()).fileName()), 5000);
+        return;
+    }
+
+    bool ok = false;
+    const QString schema = QInputDialog::getItem(this, tr("Detach Database"), tr("Schema to detach:"), schemas, 0, false, &ok);
+    if (ok)
+        engine->detach(schema);
+}
+
+/*
+ * Executes an SQL script, usually a dump, from a file against the selected database, without loading it into the editor.
+ */
+void MainWindow::onRestoreRequested()
+{
+    if (engine->databasePath().isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before restoring into it."), 5000);
+        return;
+    }
+
+    if (engine->isBusy())
+    {
+        statusBar()->showMessage(tr("Wait for the running statement to finish, or cancel it, before restoring."), 5000);
+        return;
+    }
+
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Restore from SQL..."), QString(), tr("sql script (*.sql);;all files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    QSettings settings;
+    runScriptFile(fileName, settings.value("ScriptFileBatchSize", 10000).toInt());
+}
+
+/*
+ * Executes an SQL script from a file, however large, against the selected database. The script is never loaded into the editor, the worker reads
+ * and executes it a statement at a time and commits every so many statements.
+ */
+void MainWindow::on_actionRunFile_triggered()
+{
+    if (engine->databasePath().isEmpty())
+    {
+        statusBar()->showMessage(tr("Please select a database first before running a script against it."), 5000);
+        return;
+    }
+
+    if (engine->isBusy())
+    {
+        statusBar()->showMessage(tr("Wait for the running statement to finish, or cancel it, before running a script."), 5000);
+        return;
+    }
+
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Run SQL File..."), QString(), tr("sql script (*.sql);;all files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    QSettings settings;
+    bool ok = false;
+    const int statementsPerTransaction = QInputDialog::getInt(this, tr("Run SQL File"),
+        tr("Statements per transaction (0 keeps the transactions of the script):"), settings.value("ScriptFileBatchSize", 10000).toInt(), 0, 10000000, 1000, &ok);
+    if (!ok)
+        return;
+    settings.setValue("ScriptFileBatchSize", statementsPerTransaction);
+
+    runScriptFile(fileName, statementsPerTransaction);
+}
+
+/*
+ * Runs a script file in the worker with a modal progress dialog, which shows the share of the file read so far and the statements per second.
+ */
+void MainWindow::runScriptFile(const QString &fileName, int statementsPerTransaction)
+{
+    ScriptFileRun request;
+    request.fileName = fileName;
+    request.statementsPerTransaction = statementsPerTransaction;
+
+    const QString name = QFileInfo(fileName).fileName();
+    QProgressDialog progress(tr("Running %1...").arg(name), tr("Cancel"), 0, 1000, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+
+    QElapsedTimer timer;
+    timer.start();
+    connect(&progress, &QProgressDialog::canceled, engine, &QueryEngine::cancel);
+    connect(engine, &QueryEngine::scriptFileProgress, &progress, [&](qint64 statements, qint64 bytesRead, qint64 totalBytes)
+    {
+        const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+        progress.setValue(totalBytes > 0 ? int(bytesRead * 1000 / totalBytes) : 0);
+        progress.setLabelText(tr("Running %1... %2 statements, %3 statements/s, %4 of %5 MB").arg(name).arg(statements)
+                              .arg(statements * 1000 / elapsed).arg(bytesRead / (1024 * 1024)).arg(totalBytes / (1024 * 1024)));
+    });
+    connect(engine, &QueryEngine::scriptFileFinished, &progress, &QProgressDialog::reset);
+
+    engine->runScriptFile(request);
+    progress.exec();
+}
+
+void MainWindow::onScriptFileFinished(const ScriptFileResult &result)
+{
+    const QString name = QFileInfo(result.fileName).fileName();
+    QString message;
+    if (!result.error.isEmpty())
+        message = tr("%1 stopped at line %2: %3").arg(name).arg(result.line).arg(result.error);
+    else if (result.cancelled)
+        message = tr("%1 cancelled after %2 statements").arg(name).arg(result.statements);
+    else
+        message = tr("Executed %1 statements from %2 in %3 ms (%4 statements/s)").arg(result.statements).arg(name).arg(result.elapsed)
+                .arg(result.statements * 1000 / qMax<qint64>(1, result.elapsed));
+
+    statusBar()->showMessage(message, 5000);
+
+    auto indice = addHistoryEntry(QIcon(resource + "execute.png"), message, nullptr);
+    indice->setText(HistoryTime, QString::number(result.elapsed));
+
+    tableBrowser->invalidate();
+}
+
+/*
+ * Opens an .sql document in the editor, later saves go back to the same file.
+ */
+bool MainWindow::openScript(const QString &path)
+{
+    QFile document(path);
+    if (!document.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        statusBar()->showMessage(tr("Could not open %1: %2").arg(QFileInfo(path).fileName(), document.errorString()), 5000);
+        return false;
+    }
+
+#ifndef QT_NO_CURSOR
+    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+#endif
+    QTextStream textStream(&document);
+    textStream.setCodec("UTF-8");
+    editor->setPlainText(textStream.readAll());
+    editor->document()->setModified(false);
+#ifndef QT_NO_CURSOR
+    QApplication::restoreOverrideCursor();
+#endif
+
+    fileName = path;
+    statusBar()->showMessage(tr("Opened %1, %2 lines").arg(QFileInfo(path).fileName()).arg(editor->document()->blockCount()), 5000);
+    return true;
+}
+
 /*
  * Saves whatever typed in the editor (TextEdit) as a .sql document
  */
@@ -830,16 +1854,28 @@ void MainWindow::setSelectedDatabaseIndicatorVisible(const QString &txt)
 void MainWindow::WriteSettings()
 {
     recentFileLists.clear();
-    for (int i = 0; i < solutionTree->topLevelItemCount(); ++i)
+    foreach (const QString& path, solutionTree->databases())
     {
-        recentFileLists.removeAll(solutionTree->topLevelItem(i)->toolTip(0));
-        recentFileLists.prepend(solutionTree->topLevelItem(i)->toolTip(0));
+        recentFileLists.removeAll(path);
+        recentFileLists.prepend(path);
     }
 
     QSettings m_settings;
     m_settings.setValue("RecentFiles", recentFileLists);
     m_settings.setValue("IsTextVisibleOnToolButtons", ui->actionShowTextOnToolbar->isChecked());
     m_settings.setValue("WindowState", saveState());
+    m_settings.setValue("QueryTimeout", queryTimeoutSpinBox->value());
+    m_settings.setValue("RunScriptInTransaction", ui->actionRunInTransaction->isChecked());
+    m_settings.setValue("ExplainBytecode", ui->actionExplainBytecode->isChecked());
+    m_settings.setValue("ValidateWhileTyping", ui->actionCheckWhileTyping->isChecked());
+    m_settings.setValue("ResultMemoryBudget", tableModel->memoryBudget() / (1024 * 1024));
+    m_settings.setValue("ConnectionPoolSize", engine->poolSize());
+    ConnectionProfile::write(m_settings, connectionProfiles);
+
+    QVariantMap profileNames;
+    for (auto i = databaseProfiles.constBegin(); i != databaseProfiles.constEnd(); ++i)
+        profileNames.insert(i.key(), i.value());
+    m_settings.setValue("DatabaseProfiles", profileNames);
 #ifdef Q_OS_WIN
     m_settings.setValue("IsWindowsNativeThemeSet", ui->actionNativeWindowsUI->isChecked());
 #endif
@@ -855,6 +1891,23 @@ void MainWindow::ReadSettings()
     recentFileLists = m_settings.value("RecentFiles").toStringList();
     ui->actionShowTextOnToolbar->setChecked(m_settings.value("IsTextVisibleOnToolButtons", false).toBool());
     restoreState(m_settings.value("WindowState").toByteArray());
+    queryTimeoutSpinBox->setValue(m_settings.value("QueryTimeout", 0).toInt());
+    ui->actionRunInTransaction->setChecked(m_settings.value("RunScriptInTransaction", true).toBool());
+    ui->actionExplainBytecode->setChecked(m_settings.value("ExplainBytecode", false).toBool());
+    ui->actionCheckWhileTyping->setChecked(m_settings.value("ValidateWhileTyping", true).toBool());
+    if (m_settings.contains("ResultMemoryBudget"))
+        tableModel->setMemoryBudget(m_settings.value("ResultMemoryBudget").toLongLong() * 1024 * 1024);
+    if (m_settings.contains("ConnectionPoolSize"))
+        engine->setPoolSize(m_settings.value("ConnectionPoolSize").toInt());
+
+    // the profiles reach the engine before any database is opened, so the first open already applies them
+    connectionProfiles = ConnectionProfile::read(m_settings);
+    const QVariantMap profileNames = m_settings.value("DatabaseProfiles").toMap();
+    for (auto i = profileNames.constBegin(); i != profileNames.constEnd(); ++i)
+    {
+        databaseProfiles.insert(i.key(), i.value().toString());
+        engine->setConnectionProfile(i.key(), connectionProfile(i.value().toString()));
+    }
 
 #ifdef Q_OS_WIN
     ui->actionNativeWindowsUI->setChecked(m_settings.value("IsWindowsNativeThemeSet", true).toBool());
@@ -904,7 +1957,6 @@ void MainWindow::ReadSettings()
             if (isLoaded)
             {
                 solutionTree->addItemTotheExplorar(str);
-                loadTablesToTheSelectedDatabase();
             }
         });
     }
@@ -915,7 +1967,9 @@ void MainWindow::ReadSettings()
  */
 void MainWindow::textFamily(const QFont &f)
 {
-    editor->setFont(f);
+    QFont font = f;
+    font.setPointSize(editor->font().pointSize());
+    editor->setFont(font);
 }
 
 
@@ -2,26 +2,43 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QSqlDatabase>
+#include <QHash>
+#include <QSharedPointer>
 
 QT_BEGIN_NAMESPACE
-class QAbstractItemModel;
 class QFontComboBox;
 class QComboBox;
 class QCompleter;
 class QTableView;
-class QListWidget;
+class QTreeWidget;
+class QLabel;
 class QCloseEvent;
 class QDragEnterEvent;
 class QDropEvent;
 class QDockWidget;
-class QSqlQueryModel;
+class QSpinBox;
 class QTreeWidgetItem;
 QT_END_NAMESPACE
 
 class TextEdit;
+class QueryEngine;
+class SqlValidator;
+class ResultModel;
+class TableBrowser;
+class ParameterPanel;
+class PlanView;
+class CompletionIndex;
 
 #include "Widgets/solutiontreewidget.h"
+#include "Database/queryresult.h"
+#include "Database/queryplan.h"
+#include "Database/csvimport.h"
+#include "Database/resultexport.h"
+#include "Database/backup.h"
+#include "Database/dump.h"
+#include "Database/scriptfile.h"
+#include "Database/schemainfo.h"
+#include "Database/connectionprofile.h"
 
 namespace Ui {
 class MainWindow;
@@ -52,14 +69,46 @@ protected:
 private slots:
     void on_actionNew_triggered();
     void on_actionOpen_triggered();
+    void on_actionOpenScript_triggered();
     void on_actionRun_triggered();
-
-    void onSelectedItemChanged(QTreeWidgetItem* item, SolutionTreeWidget::SelectedItemType t);
+    void on_actionRunSelection_triggered();
+    void on_actionRunStatement_triggered();
+    void on_actionCancel_triggered();
+    void on_actionRunFile_triggered();
+    void on_actionExplain_triggered();
+    void on_actionExportResults_triggered();
+
+    void onSelectedItemChanged(const QString& path, SolutionTreeWidget::SelectedItemType t);
     void onStatementRequested(QString command);
+    void onTableBrowseRequested(QString table);
     void onTableGeneratorRequested();
+    void onCsvImportRequested();
+    void onCsvImportFinished(const CsvImportResult& result);
+    void onExportProgress(qint64 rows, qint64 bytes);
+    void onExportFinished(const ResultExportResult& result);
+    void onBackupRequested();
+    void onBackupFinished(const BackupResult& result);
+    void onDumpRequested();
+    void onDumpFinished(const DumpResult& result);
+    void onRestoreRequested();
+    void onConnectionSettingsRequested();
+    void onAttachRequested();
+    void onDetachRequested();
+    void onScriptFileFinished(const ScriptFileResult& result);
+    void onSchemaUpdated(const SchemaDelta& delta);
+    void onQueryStarted(const QString& command);
+    void onQueryFinished(const ExecutionResult& result);
+    void onQueryFailed(const ExecutionResult& result, const QString& error);
+    void onQueryAborted(const ExecutionResult& result);
+    void onScriptProgress(int executed, int count);
+    void onScriptFinished(const ScriptResult& result);
+    void onStatisticsUpdated(const ExecutionResult& result);
+    void onStatementCacheUpdated(qint64 hits, qint64 misses, int size);
+    void onPlanReady(const QueryPlan& plan);
     void textFamily(const QFont& f);
 
     //! file
+    bool openScript(const QString& path);
     bool fileSave();
     bool fileSaveAs();
     void filePrint();
@@ -69,6 +118,8 @@ private slots:
     void on_actionNativeWindowsUI_triggered(bool checked);
 #endif
     void on_actionShowTextOnToolbar_triggered(bool checked);
+    void on_actionResultMemoryBudget_triggered();
+    void on_actionConnectionPoolSize_triggered();
     void on_actionAbout_triggered();
     void on_actionAbout_Framework_triggered();
 
@@ -80,29 +131,74 @@ private:
     QFontComboBox* fontsComboBox;
     QComboBox* fontSizeComboBox;
     QComboBox* selectedDatabaseIndicatorComboBox;
+    QSpinBox* queryTimeoutSpinBox;
+    QLabel* statementCacheLabel;
     void setSelectedDatabaseIndicatorVisible(const QString& txt);
 
     //! auto complete
-    QAbstractItemModel* modelFromFile(const QString& fileName);
+    QStringList wordsFromFile(const QString& fileName);
     QCompleter* completer;
 
+    // names of every database opened so far, by path
+    QHash<QString, QSharedPointer<CompletionIndex>> completionIndexes;
+
+    //! connection settings
+    QVector<ConnectionProfile> connectionProfiles;
+
+    // name of the profile each database is opened with, databases that aren't listed get the driver defaults
+    QHash<QString, QString> databaseProfiles;
+    ConnectionProfile connectionProfile(const QString& name) const;
+
+    //! attached databases
+    // the databases attached to each database, the file of each by its schema name
+    QHash<QString, QVariantMap> attachedDatabases;
+    void updateAttachedIndexes();
+
     //! Window UI
     SolutionTreeWidget* solutionTree;
     TextEdit* editor = nullptr;
     QTableView* tableView;
-    QListWidget* activityLog;
+    QTreeWidget* activityLog;
+    TableBrowser* tableBrowser;
+    ParameterPanel* parameterPanel;
+    PlanView* planView;
     QTabWidget* resultPanel;
 
+    // document range of the statement the parameter panel shows, -1 when it has to be looked up again
+    int parameterStatementStart = -1;
+    int parameterStatementEnd = -1;
+
     //! database
-    QSqlDatabase database;
-    QSqlQueryModel* tableModel;
+    QueryEngine* engine;
+    SqlValidator* validator;
+    ResultModel* tableModel;
     bool load(const QString& str);
+    void runCommand(const QString& command, int firstLine);
+    void runScriptFile(const QString& fileName, int statementsPerTransaction);
+    int runLineOffset = 0;
     QString getQueryResult(const QString& command, int rows);
     ExecuteQueryType getQueryType(const QString &query, QString& message, int rows);
-    void loadTablesToTheSelectedDatabase();
+
+    //! history, one row per execution with the counters of the statement in the columns
+    enum HistoryColumn
+    {
+        HistoryMessage,
+        HistoryTime,
+        HistoryFirstRow,
+        HistoryRows,
+        HistoryVmSteps,
+        HistoryFullScanSteps,
+        HistorySorts,
+        HistoryAutoIndexes,
+        HistoryCacheHits,
+        HistoryCacheMisses,
+        HistoryColumnCount
+    };
+    QTreeWidgetItem* addHistoryEntry(const QIcon& icon, const QString& message, const ExecutionResult* result, QTreeWidgetItem* parent = nullptr);
+    void setHistoryStatistics(QTreeWidgetItem* item, const ExecutionResult& result);
 
     //! database Error Reporting
-    void checkLastErrorIfAny(QSqlQuery* query = nullptr);
+    void checkLastErrorIfAny(const ExecutionResult& result, const QString& error);
 
     //! settings
     void ReadSettings();
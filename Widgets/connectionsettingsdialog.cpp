@@ -0,0 +1,209 @@
+#include "connectionsettingsdialog.h"
+
+#include <QComboBox>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QSignalBlocker>
+#include <QFileInfo>
+
+namespace
+{
+    // a combo box of pragma values, the first item leaves the setting alone
+    QComboBox* pragmaComboBox(const QStringList& values, QWidget* parent)
+    {
+        auto comboBox = new QComboBox(parent);
+        comboBox->addItem(QObject::tr("Unchanged"), QString());
+        foreach (const QString& value, values)
+            comboBox->addItem(value, value);
+        return comboBox;
+    }
+
+    QSpinBox* pragmaSpinBox(int maximum, int step, const QString& suffix, QWidget* parent)
+    {
+        auto spinBox = new QSpinBox(parent);
+        spinBox->setRange(-1, maximum);
+        spinBox->setSingleStep(step);
+        spinBox->setSpecialValueText(QObject::tr("Unchanged"));
+        spinBox->setSuffix(suffix);
+        return spinBox;
+    }
+}
+
+ConnectionSettingsDialog::ConnectionSettingsDialog(const QString &path, const QVector<ConnectionProfile> &profiles, const QString &profileName,
+                                                   QWidget *parent) : QDialog(parent), profileList(profiles)
+{
+    setWindowTitle(tr("Connection Settings - %1").arg(QFileInfo(path).fileName()));
+
+    profileComboBox = new QComboBox(this);
+    auto saveAsButton = new QPushButton(tr("Save As..."), this);
+    removeButton = new QPushButton(tr("Remove"), this);
+    auto profileLayout = new QHBoxLayout;
+    profileLayout->addWidget(profileComboBox, 1);
+    profileLayout->addWidget(saveAsButton);
+    profileLayout->addWidget(removeButton);
+
+    journalModeComboBox = pragmaComboBox(QStringList() << "DELETE" << "TRUNCATE" << "PERSIST" << "MEMORY" << "WAL" << "OFF", this);
+    journalModeComboBox->setToolTip(tr("WAL lets readers and the writer work at the same time, and makes commits cheaper"));
+
+    synchronousComboBox = pragmaComboBox(QStringList() << "OFF" << "NORMAL" << "FULL" << "EXTRA", this);
+    synchronousComboBox->setToolTip(tr("How often sqlite waits for the disk. OFF is fastest, but an OS crash or a power loss may then corrupt the database, "
+                                       "even in WAL mode. NORMAL is safe from corruption in WAL mode"));
+
+    cacheSizeSpinBox = pragmaSpinBox(64 * 1024, 16, tr(" MB"), this);
+    cacheSizeSpinBox->setToolTip(tr("Memory for the page cache of the connection"));
+
+    mmapSizeSpinBox = pragmaSpinBox(1024 * 1024, 256, tr(" MB"), this);
+    mmapSizeSpinBox->setToolTip(tr("Bytes of the file read through memory mapping instead of read calls, 0 turns it off"));
+
+    tempStoreComboBox = pragmaComboBox(QStringList() << "DEFAULT" << "FILE" << "MEMORY", this);
+    tempStoreComboBox->setToolTip(tr("Where temporary tables and the indexes of large sorts are kept"));
+
+    busyTimeoutSpinBox = pragmaSpinBox(600000, 1000, tr(" ms"), this);
+    busyTimeoutSpinBox->setToolTip(tr("How long a statement waits for a lock held by another connection before it fails"));
+
+    pageSizeComboBox = new QComboBox(this);
+    pageSizeComboBox->addItem(tr("Unchanged"), -1);
+    for (int size = 1024; size <= 65536; size *= 2)
+        pageSizeComboBox->addItem(QString::number(size), size);
+    pageSizeComboBox->setToolTip(tr("Only applied to a database that is still empty when it is opened"));
+
+    auto form = new QFormLayout;
+    form->addRow(tr("Profile:"), profileLayout);
+    form->addRow(tr("Journal mode:"), journalModeComboBox);
+    form->addRow(tr("Synchronous:"), synchronousComboBox);
+    form->addRow(tr("Cache size:"), cacheSizeSpinBox);
+    form->addRow(tr("Memory map size:"), mmapSizeSpinBox);
+    form->addRow(tr("Temporary store:"), tempStoreComboBox);
+    form->addRow(tr("Busy timeout:"), busyTimeoutSpinBox);
+    form->addRow(tr("Page size on create:"), pageSizeComboBox);
+
+    auto buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    auto rootLayout = new QVBoxLayout(this);
+    rootLayout->addLayout(form);
+    rootLayout->addWidget(new QLabel(tr("The settings are applied every time the database is opened."), this));
+    rootLayout->addWidget(buttonBox);
+
+    foreach (const ConnectionProfile& profile, profileList)
+        profileComboBox->addItem(profile.name);
+
+    connect(profileComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &ConnectionSettingsDialog::showProfile);
+    connect(saveAsButton, &QPushButton::clicked, this, &ConnectionSettingsDialog::saveAs);
+    connect(removeButton, &QPushButton::clicked, this, &ConnectionSettingsDialog::removeProfile);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &ConnectionSettingsDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &ConnectionSettingsDialog::reject);
+
+    const int current = qMax(0, profileComboBox->findText(profileName));
+    profileComboBox->setCurrentIndex(current);
+    showProfile(current);
+}
+
+QVector<ConnectionProfile> ConnectionSettingsDialog::profiles() const
+{
+    return profileList;
+}
+
+ConnectionProfile ConnectionSettingsDialog::selectedProfile() const
+{
+    return profileList.value(profileComboBox->currentIndex());
+}
+
+void ConnectionSettingsDialog::accept()
+{
+    storeFields();
+    QDialog::accept();
+}
+
+/*
+ * Fills the fields with a profile, after keeping the changes made to the fields of the one shown before.
+ */
+void ConnectionSettingsDialog::showProfile(int index)
+{
+    storeFields();
+    shownProfile = index;
+    if (index < 0 || index >= profileList.size())
+        return;
+
+    const ConnectionProfile& profile = profileList.at(index);
+    journalModeComboBox->setCurrentIndex(qMax(0, journalModeComboBox->findData(profile.journalMode)));
+    synchronousComboBox->setCurrentIndex(qMax(0, synchronousComboBox->findData(profile.synchronous)));
+    cacheSizeSpinBox->setValue(profile.cacheSize < 0 ? -1 : profile.cacheSize / 1024);
+    mmapSizeSpinBox->setValue(profile.mmapSize < 0 ? -1 : int(profile.mmapSize / (1024 * 1024)));
+    tempStoreComboBox->setCurrentIndex(qMax(0, tempStoreComboBox->findData(profile.tempStore)));
+    busyTimeoutSpinBox->setValue(profile.busyTimeout);
+    pageSizeComboBox->setCurrentIndex(qMax(0, pageSizeComboBox->findData(profile.pageSize)));
+
+    removeButton->setEnabled(profileList.size() > 1);
+}
+
+/*
+ * Adds a profile with the values of the fields under a new name, and selects it.
+ */
+void ConnectionSettingsDialog::saveAs()
+{
+    bool ok = false;
+    const QString name = QInputDialog::getText(this, tr("Save Profile"), tr("Profile name:"), QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || name.isEmpty())
+        return;
+
+    ConnectionProfile profile = fields();
+    profile.name = name;
+
+    // the fields belong to the new profile, the one they were loaded from keeps its values
+    const int existing = profileComboBox->findText(name);
+    shownProfile = -1;
+    if (existing >= 0)
+    {
+        profileList[existing] = profile;
+        profileComboBox->setCurrentIndex(existing);
+        showProfile(existing);
+        return;
+    }
+
+    profileList << profile;
+    profileComboBox->addItem(name);
+    profileComboBox->setCurrentIndex(profileList.size() - 1);
+}
+
+void ConnectionSettingsDialog::removeProfile()
+{
+    const int index = profileComboBox->currentIndex();
+    if (index < 0 || profileList.size() <= 1)
+        return;
+
+    shownProfile = -1;
+    profileList.remove(index);
+    const QSignalBlocker blocker(profileComboBox);
+    profileComboBox->removeItem(index);
+    showProfile(profileComboBox->currentIndex());
+}
+
+ConnectionProfile ConnectionSettingsDialog::fields() const
+{
+    ConnectionProfile profile;
+    profile.journalMode = journalModeComboBox->currentData().toString();
+    profile.synchronous = synchronousComboBox->currentData().toString();
+    profile.cacheSize = cacheSizeSpinBox->value() < 0 ? -1 : cacheSizeSpinBox->value() * 1024;
+    profile.mmapSize = mmapSizeSpinBox->value() < 0 ? -1 : qint64(mmapSizeSpinBox->value()) * 1024 * 1024;
+    profile.tempStore = tempStoreComboBox->currentData().toString();
+    profile.busyTimeout = busyTimeoutSpinBox->value();
+    profile.pageSize = pageSizeComboBox->currentData().toInt();
+    return profile;
+}
+
+void ConnectionSettingsDialog::storeFields()
+{
+    if (shownProfile < 0 || shownProfile >= profileList.size())
+        return;
+
+    ConnectionProfile profile = fields();
+    profile.name = profileList.at(shownProfile).name;
+    profileList[shownProfile] = profile;
+}
@@ -0,0 +1,57 @@
+#ifndef CONNECTIONSETTINGSDIALOG_H
+#define CONNECTIONSETTINGSDIALOG_H
+
+#include <QDialog>
+#include <QVector>
+
+#include "Database/connectionprofile.h"
+
+QT_BEGIN_NAMESPACE
+class QComboBox;
+class QSpinBox;
+class QPushButton;
+QT_END_NAMESPACE
+
+/*
+ * Chooses the pragma profile of a database and edits the profiles themselves. Changes made to the fields are kept in the profile they were made
+ * to, so every database that uses the profile gets them.
+ */
+class ConnectionSettingsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ConnectionSettingsDialog(const QString& path, const QVector<ConnectionProfile>& profiles, const QString& profileName, QWidget* parent = nullptr);
+
+    QVector<ConnectionProfile> profiles() const;
+    ConnectionProfile selectedProfile() const;
+
+public slots:
+    void accept() Q_DECL_OVERRIDE;
+
+private slots:
+    void showProfile(int index);
+    void saveAs();
+    void removeProfile();
+
+private:
+    QComboBox* profileComboBox;
+    QPushButton* removeButton;
+    QComboBox* journalModeComboBox;
+    QComboBox* synchronousComboBox;
+    QSpinBox* cacheSizeSpinBox;
+    QSpinBox* mmapSizeSpinBox;
+    QComboBox* tempStoreComboBox;
+    QSpinBox* busyTimeoutSpinBox;
+    QComboBox* pageSizeComboBox;
+
+    QVector<ConnectionProfile> profileList;
+
+    // the profile the fields show, its changes are stored back before another one is shown
+    int shownProfile = -1;
+
+    ConnectionProfile fields() const;
+    void storeFields();
+};
+
+#endif // CONNECTIONSETTINGSDIALOG_H
@@ -0,0 +1,370 @@
+#include "csvimportdialog.h"
+#include "Libraries/csvreader.h"
+
+#include <QLineEdit>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QProgressBar>
+#include <QLabel>
+#include <QPushButton>
+#include <QToolButton>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QSignalBlocker>
+#include <QMessageBox>
+#include <QRegularExpression>
+#include <QLocale>
+
+namespace
+{
+    // bytes and records of the file the column types are guessed from
+    const int SampleBytes = 1 << 20;
+    const int SampleRows = 1000;
+
+    enum Column { ColumnName, ColumnType, ColumnSample };
+
+    bool isNumber(const QString& value)
+    {
+        bool ok = false;
+        value.toDouble(&ok);
+        return ok;
+    }
+
+    /*
+     * Narrowest type that holds every non empty value of a column in the sample. Numbers with a leading zero stay text, since they are codes
+     * whose zeros would be lost.
+     */
+    QString inferType(const QVector<QStringList>& records, int column)
+    {
+        bool integers = true, reals = true, any = false;
+        foreach (const QStringList& record, records)
+        {
+            const QString value = record.value(column).trimmed();
+            if (value.isEmpty())
+                continue;
+            any = true;
+
+            if (value.size() > 1 && value.at(0) == QLatin1Char('0') && value.at(1) != QLatin1Char('.'))
+                return "TEXT";
+
+            bool ok = false;
+            if (integers)
+            {
+                value.toLongLong(&ok);
+                integers = ok;
+            }
+            if (reals && !integers)
+            {
+                value.toDouble(&ok);
+                reals = ok;
+            }
+            if (!reals)
+                return "TEXT";
+        }
+
+        return !any ? "TEXT" : integers ? "INTEGER" : "REAL";
+    }
+}
+
+CsvImportDialog::CsvImportDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle(tr("Import CSV"));
+
+    fileEdit = new QLineEdit(this);
+    fileEdit->setReadOnly(true);
+    browseButton = new QToolButton(this);
+    browseButton->setText(tr("..."));
+    auto fileLayout = new QHBoxLayout;
+    fileLayout->addWidget(fileEdit, 1);
+    fileLayout->addWidget(browseButton);
+
+    tableEdit = new QLineEdit(this);
+    tableEdit->setToolTip(tr("The table is created if it doesn't exist, otherwise the records are added to it"));
+
+    separatorComboBox = new QComboBox(this);
+    separatorComboBox->addItem(tr("Comma"), int(','));
+    separatorComboBox->addItem(tr("Semicolon"), int(';'));
+    separatorComboBox->addItem(tr("Tab"), int('\t'));
+    separatorComboBox->addItem(tr("Pipe"), int('|'));
+
+    headerCheckBox = new QCheckBox(tr("The first record names the columns"), this);
+
+    columnsTable = new QTableWidget(0, 3, this);
+    columnsTable->setHorizontalHeaderLabels(QStringList() << tr("Column") << tr("Type") << tr("Sample"));
+    columnsTable->horizontalHeader()->setStretchLastSection(true);
+    columnsTable->verticalHeader()->setVisible(false);
+
+    batchSizeSpinBox = new QSpinBox(this);
+    batchSizeSpinBox->setRange(1000, 10000000);
+    batchSizeSpinBox->setSingleStep(10000);
+    batchSizeSpinBox->setValue(CsvImport().batchSize);
+    batchSizeSpinBox->setToolTip(tr("Records inserted per transaction, larger batches are faster and a failure rolls back one batch only"));
+
+    emptyAsNullCheckBox = new QCheckBox(tr("Empty fields as NULL"), this);
+    emptyAsNullCheckBox->setChecked(true);
+
+    relaxDurabilityCheckBox = new QCheckBox(tr("Fast writes while importing"), this);
+    relaxDurabilityCheckBox->setToolTip(tr("Turns off synchronous writes and keeps the journal in memory until the import is done.\n"
+                                           "A power loss during the import may corrupt the database."));
+
+    progressBar = new QProgressBar(this);
+    progressBar->setRange(0, 1000);
+    progressBar->setValue(0);
+    statusLabel = new QLabel(this);
+
+    auto buttonBox = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    importButton = buttonBox->addButton(tr("Import"), QDialogButtonBox::AcceptRole);
+    importButton->setEnabled(false);
+
+    auto form = new QFormLayout;
+    form->addRow(tr("File:"), fileLayout);
+    form->addRow(tr("Table:"), tableEdit);
+    form->addRow(tr("Separator:"), separatorComboBox);
+    form->addRow(QString(), headerCheckBox);
+
+    auto options = new QHBoxLayout;
+    options->addWidget(new QLabel(tr("Records per transaction:"), this));
+    options->addWidget(batchSizeSpinBox);
+    options->addWidget(emptyAsNullCheckBox);
+    options->addWidget(relaxDurabilityCheckBox);
+    options->addStretch(1);
+
+    auto rootLayout = new QVBoxLayout(this);
+    rootLayout->addLayout(form);
+    rootLayout->addWidget(columnsTable, 1);
+    rootLayout->addLayout(options);
+    rootLayout->addWidget(progressBar);
+    rootLayout->addWidget(statusLabel);
+    rootLayout->addWidget(buttonBox);
+
+    connect(browseButton, &QToolButton::clicked, this, &CsvImportDialog::chooseFile);
+    connect(separatorComboBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &CsvImportDialog::analyse);
+    connect(headerCheckBox, &QCheckBox::toggled, this, &CsvImportDialog::analyse);
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &CsvImportDialog::startImport);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &CsvImportDialog::reject);
+
+    resize(620, 480);
+}
+
+void CsvImportDialog::chooseFile()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Import CSV..."), QString(), tr("comma separated values (*.csv *.tsv *.txt);;all files (*)"));
+    if (!fileName.isEmpty())
+        setFile(fileName);
+}
+
+/*
+ * Reads the first megabyte of the file and guesses the separator and whether the first record is a header from it. The whole file is only
+ * read by the import.
+ */
+void CsvImportDialog::setFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        QMessageBox::critical(this, windowTitle(), file.errorString());
+        return;
+    }
+
+    sample = file.read(SampleBytes);
+
+    // the sample most likely ends in the middle of a record
+    if (file.size() > sample.size())
+        sample.truncate(sample.lastIndexOf('\n') + 1);
+
+    fileEdit->setText(QDir::toNativeSeparators(fileName));
+    tableEdit->setText(QFileInfo(fileName).completeBaseName().replace(QRegularExpression("\\W"), "_"));
+    statusLabel->setText(tr("%1 MB").arg(file.size() / (1024.0 * 1024.0), 0, 'f', 1));
+
+    const char detected = CsvReader::detectSeparator(sample.constData(), sample.size());
+    const QSignalBlocker separatorBlocker(separatorComboBox);
+    const QSignalBlocker headerBlocker(headerCheckBox);
+    separatorComboBox->setCurrentIndex(qMax(0, separatorComboBox->findData(int(detected))));
+
+    // a header is a first record of names: nothing empty and nothing numeric
+    CsvReader reader(sample.constData(), sample.size(), detected);
+    QStringList first;
+    bool isHeader = reader.readRow(first);
+    foreach (const QString& field, first)
+        isHeader = isHeader && !field.trimmed().isEmpty() && !isNumber(field.trimmed());
+    headerCheckBox->setChecked(isHeader);
+
+    analyse();
+}
+
+/*
+ * Parses the sample with the chosen separator and lists the columns with the types their values fit in.
+ */
+void CsvImportDialog::analyse()
+{
+    sampleRecords.clear();
+    CsvReader reader(sample.constData(), sample.size(), separator());
+    QStringList fields;
+    while (sampleRecords.size() <= SampleRows && reader.readRow(fields))
+    {
+        if (fields.size() == 1 && fields.first().isEmpty())
+            continue;
+        sampleRecords << fields;
+    }
+
+    QStringList names;
+    if (headerCheckBox->isChecked() && !sampleRecords.isEmpty())
+        names = sampleRecords.takeFirst();
+
+    int columns = names.size();
+    foreach (const QStringList& record, sampleRecords)
+        columns = qMax(columns, record.size());
+
+    columnsTable->setRowCount(columns);
+    for (int column = 0; column < columns; ++column)
+    {
+        // names are unique and not empty, so that the table can be created with them
+        QString name = names.value(column).trimmed();
+        if (name.isEmpty())
+            name = QString("column%1").arg(column + 1);
+        const QString base = name;
+        for (int n = 2; names.mid(0, column).contains(name, Qt::CaseInsensitive); ++n)
+            name = QString("%1_%2").arg(base).arg(n);
+        if (column < names.size())
+            names[column] = name;
+        else
+            names << name;
+
+        QString example;
+        foreach (const QStringList& record, sampleRecords)
+        {
+            example = record.value(column);
+            if (!example.isEmpty())
+                break;
+        }
+
+        auto typeComboBox = new QComboBox(columnsTable);
+        typeComboBox->addItems(QStringList() << "INTEGER" << "REAL" << "TEXT" << "NUMERIC" << "BLOB");
+        typeComboBox->setCurrentText(inferType(sampleRecords, column));
+
+        columnsTable->setItem(column, ColumnName, new QTableWidgetItem(name));
+        columnsTable->setCellWidget(column, ColumnType, typeComboBox);
+        auto sampleItem = new QTableWidgetItem(example);
+        sampleItem->setFlags(sampleItem->flags() & ~Qt::ItemIsEditable);
+        columnsTable->setItem(column, ColumnSample, sampleItem);
+    }
+
+    importButton->setEnabled(columns > 0);
+}
+
+char CsvImportDialog::separator() const
+{
+    return char(separatorComboBox->currentData().toInt());
+}
+
+void CsvImportDialog::startImport()
+{
+    CsvImport request;
+    request.fileName = QDir::fromNativeSeparators(fileEdit->text());
+    request.table = tableEdit->text().trimmed();
+    request.separator = separator();
+    request.hasHeader = headerCheckBox->isChecked();
+    request.batchSize = batchSizeSpinBox->value();
+    request.emptyAsNull = emptyAsNullCheckBox->isChecked();
+    request.relaxDurability = relaxDurabilityCheckBox->isChecked();
+
+    for (int column = 0; column < columnsTable->rowCount(); ++column)
+    {
+        const QTableWidgetItem* item = columnsTable->item(column, ColumnName);
+        const QString name = item ? item->text().trimmed() : QString();
+        if (name.isEmpty() || request.columns.contains(name, Qt::CaseInsensitive))
+        {
+            QMessageBox::critical(this, windowTitle(), tr("Every column needs a name of its own."));
+            return;
+        }
+        request.columns << name;
+        request.types << static_cast<QComboBox*>(columnsTable->cellWidget(column, ColumnType))->currentText();
+    }
+
+    if (request.table.isEmpty())
+    {
+        QMessageBox::critical(this, windowTitle(), tr("Please enter the name of the table to import into."));
+        return;
+    }
+
+    importing = true;
+    setInputsEnabled(false);
+    progressBar->setValue(0);
+    statusLabel->setText(tr("Importing..."));
+    importTimer.start();
+    emit importRequested(request);
+}
+
+/*
+ * Updates the progress bar from the position in the file, and the rate from the records inserted so far.
+ */
+void CsvImportDialog::showProgress(qint64 rows, qint64 bytesRead, qint64 totalBytes)
+{
+    if (!importing)
+        return;
+
+    progressBar->setValue(totalBytes > 0 ? int(bytesRead * 1000 / totalBytes) : 1000);
+
+    const double seconds = qMax<qint64>(1, importTimer.elapsed()) / 1000.0;
+    statusLabel->setText(tr("%1 records, %2 records/s, %3 MB/s")
+                         .arg(QLocale().toString(rows))
+                         .arg(QLocale().toString(qRound64(rows / seconds)))
+                         .arg(bytesRead / seconds / (1024 * 1024), 0, 'f', 1));
+}
+
+void CsvImportDialog::showResult(const CsvImportResult &result)
+{
+    if (!importing)
+        return;
+
+    importing = false;
+    setInputsEnabled(true);
+
+    // importing the same file twice would add its records twice
+    importButton->setEnabled(result.cancelled || !result.error.isEmpty());
+
+    const QString rows = QLocale().toString(result.rows);
+    if (!result.error.isEmpty())
+        statusLabel->setText(tr("Stopped after %1 records: %2").arg(rows, result.error));
+    else if (result.cancelled)
+        statusLabel->setText(tr("Cancelled after %1 records").arg(rows));
+    else
+    {
+        const double seconds = qMax<qint64>(1, result.elapsed) / 1000.0;
+        statusLabel->setText(tr("%1 records imported in %2 s, %3 records/s")
+                             .arg(rows)
+                             .arg(seconds, 0, 'f', 1)
+                             .arg(QLocale().toString(qRound64(result.rows / seconds))));
+    }
+}
+
+/*
+ * Closing the dialog while the import runs cancels the import instead, the dialog closes once it has stopped.
+ */
+void CsvImportDialog::reject()
+{
+    if (importing)
+    {
+        statusLabel->setText(tr("Cancelling..."));
+        emit cancelRequested();
+        return;
+    }
+
+    QDialog::reject();
+}
+
+void CsvImportDialog::setInputsEnabled(bool enabled)
+{
+    foreach (QWidget* widget, QList<QWidget*>() << browseButton << tableEdit << separatorComboBox << headerCheckBox << columnsTable
+                                                << batchSizeSpinBox << emptyAsNullCheckBox << relaxDurabilityCheckBox << importButton)
+        widget->setEnabled(enabled);
+}
@@ -0,0 +1,74 @@
+#ifndef CSVIMPORTDIALOG_H
+#define CSVIMPORTDIALOG_H
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QStringList>
+
+#include "Database/csvimport.h"
+
+QT_BEGIN_NAMESPACE
+class QLineEdit;
+class QComboBox;
+class QCheckBox;
+class QSpinBox;
+class QTableWidget;
+class QProgressBar;
+class QLabel;
+class QPushButton;
+class QToolButton;
+QT_END_NAMESPACE
+
+/*
+ * Sets up the import of a CSV file into a table of the selected database: the separator, whether the first record names the columns, and the
+ * column types, which are guessed from a sample of the file. The import itself runs in the query engine, the dialog only shows its progress.
+ */
+class CsvImportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CsvImportDialog(QWidget* parent = nullptr);
+
+public slots:
+    void showProgress(qint64 rows, qint64 bytesRead, qint64 totalBytes);
+    void showResult(const CsvImportResult& result);
+    void reject() Q_DECL_OVERRIDE;
+
+signals:
+    void importRequested(const CsvImport& request);
+    void cancelRequested();
+
+private slots:
+    void chooseFile();
+    void analyse();
+    void startImport();
+
+private:
+    QLineEdit* fileEdit;
+    QToolButton* browseButton;
+    QLineEdit* tableEdit;
+    QComboBox* separatorComboBox;
+    QCheckBox* headerCheckBox;
+    QTableWidget* columnsTable;
+    QSpinBox* batchSizeSpinBox;
+    QCheckBox* emptyAsNullCheckBox;
+    QCheckBox* relaxDurabilityCheckBox;
+    QProgressBar* progressBar;
+    QLabel* statusLabel;
+    QPushButton* importButton;
+
+    // the first bytes of the file, enough to guess the separator, the header and the column types
+    QByteArray sample;
+    QVector<QStringList> sampleRecords;
+
+    bool importing = false;
+    QElapsedTimer importTimer;
+
+    void setFile(const QString& fileName);
+    void setInputsEnabled(bool enabled);
+    char separator() const;
+};
+
+#endif // CSVIMPORTDIALOG_H
@@ -0,0 +1,318 @@
+#include "parameterpanel.h"
+#include "Libraries/sqllexer.h"
+#include "Libraries/csvreader.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QToolButton>
+#include <QCheckBox>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFile>
+#include <QApplication>
+#include <QClipboard>
+#include <QMessageBox>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    // rows of a loaded batch that are shown in the grid
+    const int PreviewRows = 100;
+}
+
+ParameterPanel::ParameterPanel(QWidget *parent) : QWidget(parent)
+{
+    auto toolButton = [&](const QString& text, const QString& tip)
+    {
+        auto button = new QToolButton(this);
+        button->setText(text);
+        button->setToolTip(tip);
+        return button;
+    };
+
+    addRowButton = toolButton(tr("Add row"), tr("Add a row of values, every row executes the statement once"));
+    removeRowsButton = toolButton(tr("Remove rows"), tr("Remove the selected rows of values"));
+    loadButton = toolButton(tr("Load CSV..."), tr("Execute the statement once for every record of a CSV file"));
+    pasteButton = toolButton(tr("Paste"), tr("Execute the statement once for every row copied from a spreadsheet"));
+    clearBatchButton = toolButton(tr("Clear batch"), tr("Forget the loaded rows and type the values in again"));
+    clearBatchButton->setVisible(false);
+
+    emptyAsNullCheckBox = new QCheckBox(tr("Empty as NULL"), this);
+    emptyAsNullCheckBox->setChecked(true);
+
+    statusLabel = new QLabel(this);
+
+    grid = new QTableWidget(1, 0, this);
+    grid->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    grid->horizontalHeader()->setStretchLastSection(true);
+
+    auto tools = new QHBoxLayout;
+    tools->setContentsMargins(0, 0, 0, 0);
+    tools->addWidget(addRowButton);
+    tools->addWidget(removeRowsButton);
+    tools->addWidget(loadButton);
+    tools->addWidget(pasteButton);
+    tools->addWidget(clearBatchButton);
+    tools->addWidget(emptyAsNullCheckBox);
+    tools->addWidget(statusLabel, 1);
+
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(tools);
+    layout->addWidget(grid);
+
+    connect(addRowButton, &QToolButton::clicked, this, &ParameterPanel::addRow);
+    connect(removeRowsButton, &QToolButton::clicked, this, &ParameterPanel::removeRows);
+    connect(loadButton, &QToolButton::clicked, this, &ParameterPanel::loadCsv);
+    connect(pasteButton, &QToolButton::clicked, this, &ParameterPanel::paste);
+    connect(clearBatchButton, &QToolButton::clicked, this, &ParameterPanel::clearBatch);
+
+    showParameters(QStringList());
+}
+
+QStringList ParameterPanel::parameters() const
+{
+    return names;
+}
+
+/*
+ * Follows the statement in the editor. Values typed in for a parameter are kept as long as the statement still has a parameter of that name.
+ */
+void ParameterPanel::setStatement(const QString &statement)
+{
+    const QStringList parameters = SqlLexer::parameters(statement);
+    if (parameters == names)
+        return;
+
+    const QStringList previousNames = names;
+    names = parameters;
+    showParameters(previousNames);
+    emit parametersChanged(names.size());
+}
+
+/*
+ * Lays out the grid for the current parameters, or for the loaded batch.
+ */
+void ParameterPanel::showParameters(const QStringList &previousNames)
+{
+    const bool hasBatch = !batch.isEmpty();
+    addRowButton->setEnabled(!hasBatch && !names.isEmpty());
+    removeRowsButton->setEnabled(!hasBatch && !names.isEmpty());
+    clearBatchButton->setVisible(hasBatch);
+    grid->setEditTriggers(hasBatch ? QAbstractItemView::NoEditTriggers : QAbstractItemView::AllEditTriggers);
+
+    if (hasBatch)
+    {
+        statusLabel->setText(tr("%1 rows loaded, the statement executes once for every row").arg(batch.size()));
+        return;
+    }
+
+    statusLabel->setText(names.isEmpty() ? tr("The statement has no parameters") : QString());
+
+    // move the values typed in so far to the columns of the new parameters
+    QVector<QStringList> values;
+    for (int row = 0; row < grid->rowCount(); ++row)
+    {
+        QStringList rowValues;
+        foreach (const QString& name, names)
+        {
+            const int column = previousNames.indexOf(name);
+            const QTableWidgetItem* item = column >= 0 ? grid->item(row, column) : nullptr;
+            rowValues << (item ? item->text() : QString());
+        }
+        values << rowValues;
+    }
+
+    grid->clear();
+    grid->setColumnCount(names.size());
+    grid->setHorizontalHeaderLabels(names);
+    grid->setRowCount(qMax(1, values.size()));
+    for (int row = 0; row < values.size(); ++row)
+    {
+        for (int column = 0; column < names.size(); ++column)
+            grid->setItem(row, column, new QTableWidgetItem(values.at(row).at(column)));
+    }
+}
+
+/*
+ * Maps the rows of the grid or of the loaded batch onto the given parameters. A batch with a header row is mapped by name, without one its columns
+ * are taken in the order of the parameters.
+ */
+QVector<QVariantList> ParameterPanel::rows(const QStringList &parameters) const
+{
+    QVector<QVariantList> result;
+
+    if (!batch.isEmpty())
+    {
+        QVector<int> columns;
+        for (int i = 0; i < parameters.size(); ++i)
+            columns << (batchHeader.isEmpty() ? i : batchHeader.indexOf(bareName(parameters.at(i))));
+
+        result.reserve(batch.size());
+        foreach (const QStringList& record, batch)
+        {
+            QVariantList row;
+            foreach (int column, columns)
+                row << (column >= 0 && column < record.size() ? value(record.at(column)) : QVariant());
+            result << row;
+        }
+        return result;
+    }
+
+    for (int r = 0; r < grid->rowCount(); ++r)
+    {
+        QVariantList row;
+        foreach (const QString& parameter, parameters)
+        {
+            const int column = names.indexOf(parameter);
+            const QTableWidgetItem* item = column >= 0 ? grid->item(r, column) : nullptr;
+            row << value(item ? item->text() : QString());
+        }
+        result << row;
+    }
+
+    return result;
+}
+
+QVariant ParameterPanel::value(const QString &text) const
+{
+    if (text.isEmpty() && emptyAsNullCheckBox->isChecked())
+        return QVariant(QVariant::String);
+    return text;
+}
+
+void ParameterPanel::addRow()
+{
+    grid->insertRow(grid->rowCount());
+}
+
+void ParameterPanel::removeRows()
+{
+    QList<int> selected;
+    foreach (const QModelIndex& index, grid->selectionModel()->selectedIndexes())
+    {
+        if (!selected.contains(index.row()))
+            selected << index.row();
+    }
+
+    // from the bottom up, so the rows above keep their numbers
+    std::sort(selected.begin(), selected.end(), std::greater<int>());
+    foreach (int row, selected)
+        grid->removeRow(row);
+
+    if (grid->rowCount() == 0)
+        grid->setRowCount(1);
+}
+
+void ParameterPanel::loadCsv()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Parameter Values..."), QString(), tr("comma separated values (*.csv *.tsv *.txt);;all files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        QMessageBox::critical(this, tr("Load Parameter Values"), file.errorString());
+        return;
+    }
+
+    // the records are parsed straight out of the mapped file
+    if (file.size() > 0)
+    {
+        if (uchar* mapped = file.map(0, file.size()))
+        {
+            loadRows(reinterpret_cast<const char*>(mapped), file.size(), QFileInfo(fileName).fileName());
+            file.unmap(mapped);
+            return;
+        }
+    }
+
+    const QByteArray contents = file.readAll();
+    loadRows(contents.constData(), contents.size(), QFileInfo(fileName).fileName());
+}
+
+void ParameterPanel::paste()
+{
+    const QByteArray contents = QApplication::clipboard()->text().toUtf8();
+    loadRows(contents.constData(), contents.size(), tr("the clipboard"));
+}
+
+/*
+ * Takes the records of a CSV text as the rows of values. The first record is a header when all of its fields name parameters of the statement.
+ */
+void ParameterPanel::loadRows(const char *data, qint64 size, const QString &source)
+{
+    CsvReader reader(data, size, CsvReader::detectSeparator(data, size));
+
+    QVector<QStringList> records;
+    QStringList fields;
+    while (reader.readRow(fields))
+        records << fields;
+
+    if (records.isEmpty())
+    {
+        statusLabel->setText(tr("No rows in %1").arg(source));
+        return;
+    }
+
+    QStringList bareNames;
+    foreach (const QString& name, names)
+        bareNames << bareName(name);
+
+    batchHeader.clear();
+    bool isHeader = !bareNames.isEmpty();
+    foreach (const QString& field, records.first())
+        isHeader = isHeader && bareNames.contains(field.trimmed());
+    if (isHeader)
+    {
+        foreach (const QString& field, records.first())
+            batchHeader << field.trimmed();
+        records.removeFirst();
+    }
+
+    batch = records;
+
+    // preview, with the columns of the file
+    int columns = batchHeader.size();
+    for (int row = 0; row < batch.size() && row < PreviewRows; ++row)
+        columns = qMax(columns, batch.at(row).size());
+
+    grid->clear();
+    grid->setColumnCount(columns);
+    grid->setRowCount(qMin(batch.size(), PreviewRows));
+    if (!batchHeader.isEmpty())
+        grid->setHorizontalHeaderLabels(batchHeader);
+    for (int row = 0; row < grid->rowCount(); ++row)
+    {
+        const QStringList& record = batch.at(row);
+        for (int column = 0; column < record.size(); ++column)
+            grid->setItem(row, column, new QTableWidgetItem(record.at(column)));
+    }
+
+    showParameters(names);
+    statusLabel->setText(tr("%1 rows loaded from %2, the statement executes once for every row").arg(batch.size()).arg(source));
+}
+
+void ParameterPanel::clearBatch()
+{
+    batch.clear();
+    batchHeader.clear();
+    grid->clear();
+    grid->setRowCount(0);
+    grid->setColumnCount(0);
+    showParameters(QStringList());
+}
+
+/*
+ * Name of a parameter without its prefix, which is how the columns of a CSV header refer to it.
+ */
+QString ParameterPanel::bareName(const QString &parameter)
+{
+    return parameter.mid(1);
+}
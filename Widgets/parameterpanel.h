@@ -0,0 +1,71 @@
+#ifndef PARAMETERPANEL_H
+#define PARAMETERPANEL_H
+
+#include <QWidget>
+#include <QStringList>
+#include <QVector>
+#include <QVariant>
+
+QT_BEGIN_NAMESPACE
+class QTableWidget;
+class QToolButton;
+class QCheckBox;
+class QLabel;
+QT_END_NAMESPACE
+
+/*
+ * Values for the ?, ?NNN, :name, @name and $name parameters of the statement in the editor, one column per parameter. A single row binds the
+ * statement once. Several rows, typed in or loaded from a CSV file or the clipboard, execute it as one batch: prepared once, then rebound and
+ * stepped for every row inside a single transaction.
+ *
+ * Values are bound as text, the affinity of the columns they are compared with or stored into turns them into numbers where sqlite would.
+ */
+class ParameterPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ParameterPanel(QWidget* parent = nullptr);
+
+    QStringList parameters() const;
+
+    // one list of values per row, in the order of the given parameters; parameters the panel doesn't know are bound to NULL
+    QVector<QVariantList> rows(const QStringList& parameters) const;
+
+public slots:
+    void setStatement(const QString& statement);
+
+signals:
+    void parametersChanged(int count);
+
+private slots:
+    void addRow();
+    void removeRows();
+    void loadCsv();
+    void paste();
+    void clearBatch();
+
+private:
+    QStringList names;
+
+    // rows loaded from a file or the clipboard, the grid only previews the first of them
+    QVector<QStringList> batch;
+    QStringList batchHeader;
+
+    QTableWidget* grid;
+    QToolButton* addRowButton;
+    QToolButton* removeRowsButton;
+    QToolButton* loadButton;
+    QToolButton* pasteButton;
+    QToolButton* clearBatchButton;
+    QCheckBox* emptyAsNullCheckBox;
+    QLabel* statusLabel;
+
+    void showParameters(const QStringList& previousNames);
+    void loadRows(const char* data, qint64 size, const QString& source);
+    QVariant value(const QString& text) const;
+
+    static QString bareName(const QString& parameter);
+};
+
+#endif // PARAMETERPANEL_H
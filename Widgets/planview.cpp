@@ -0,0 +1,106 @@
+#include "planview.h"
+
+#include <QTreeWidget>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QHash>
+
+PlanView::PlanView(QWidget *parent) : QWidget(parent)
+{
+    summaryLabel = new QLabel(this);
+    summaryLabel->setWordWrap(true);
+
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels(QStringList() << tr("Step") << tr("Estimated rows"));
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    tree->header()->setStretchLastSection(false);
+
+    bytecode = new QTableWidget(this);
+    bytecode->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    bytecode->verticalHeader()->setVisible(false);
+    bytecode->horizontalHeader()->setStretchLastSection(true);
+
+    splitter = new QSplitter(Qt::Vertical, this);
+    splitter->addWidget(tree);
+    splitter->addWidget(bytecode);
+
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(summaryLabel);
+    layout->addWidget(splitter);
+
+    clear();
+}
+
+void PlanView::clear()
+{
+    summaryLabel->setText(tr("Explain a statement to see how sqlite will execute it"));
+    tree->clear();
+    bytecode->clear();
+    bytecode->setRowCount(0);
+    bytecode->setColumnCount(0);
+    bytecode->setVisible(false);
+}
+
+/*
+ * Rebuilds the tree from the steps of the plan, which come parents first. Steps with a hot spot are drawn in red with the hint as their tooltip,
+ * and their parents are expanded so none of them stays hidden.
+ */
+void PlanView::showPlan(const QueryPlan &plan)
+{
+    clear();
+
+    if (!plan.error.isEmpty())
+    {
+        summaryLabel->setText(tr("The statement could not be explained: %1").arg(plan.error));
+        return;
+    }
+
+    int hotSpots = 0;
+    QHash<int, QTreeWidgetItem*> items;
+    foreach (const QueryPlanNode& node, plan.nodes)
+    {
+        QTreeWidgetItem* parent = items.value(node.parent);
+        auto item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(tree);
+        item->setText(0, node.detail);
+        if (node.estimatedRows >= 0)
+        {
+            item->setText(1, QString::number(node.estimatedRows));
+            item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+        }
+        item->setToolTip(0, node.hint);
+
+        if (node.hotSpot)
+        {
+            ++hotSpots;
+            item->setForeground(0, Qt::red);
+            item->setForeground(1, Qt::red);
+            for (QTreeWidgetItem* ancestor = parent; ancestor; ancestor = ancestor->parent())
+                ancestor->setExpanded(true);
+        }
+
+        items.insert(node.id, item);
+    }
+    tree->expandAll();
+
+    summaryLabel->setText(hotSpots == 0 ? tr("%1 steps, nothing stands out").arg(plan.nodes.size())
+                                        : tr("%1 steps, %2 of them probably need an index, hover over the red steps for details").arg(plan.nodes.size()).arg(hotSpots));
+
+    if (plan.bytecode.isEmpty())
+        return;
+
+    bytecode->setColumnCount(plan.bytecodeColumns.size());
+    bytecode->setHorizontalHeaderLabels(plan.bytecodeColumns);
+    bytecode->setRowCount(plan.bytecode.size());
+    for (int row = 0; row < plan.bytecode.size(); ++row)
+    {
+        const QVariantList& values = plan.bytecode.at(row);
+        for (int column = 0; column < values.size(); ++column)
+            bytecode->setItem(row, column, new QTableWidgetItem(values.at(column).toString()));
+    }
+    bytecode->resizeColumnsToContents();
+    bytecode->setVisible(true);
+}
@@ -0,0 +1,36 @@
+#ifndef PLANVIEW_H
+#define PLANVIEW_H
+
+#include <QSplitter>
+
+#include "Database/queryplan.h"
+
+QT_BEGIN_NAMESPACE
+class QTreeWidget;
+class QTableWidget;
+class QLabel;
+QT_END_NAMESPACE
+
+/*
+ * Shows the plan of a statement as a tree of the steps sqlite takes, the steps to look at first in red, and beneath it the bytecode program when
+ * it was asked for.
+ */
+class PlanView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PlanView(QWidget* parent = nullptr);
+
+public slots:
+    void showPlan(const QueryPlan& plan);
+    void clear();
+
+private:
+    QLabel* summaryLabel;
+    QSplitter* splitter;
+    QTreeWidget* tree;
+    QTableWidget* bytecode;
+};
+
+#endif // PLANVIEW_H
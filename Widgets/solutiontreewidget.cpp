@@ -1,24 +1,25 @@
 #include "solutiontreewidget.h"
 
-#include <QFileInfo>
 #include <QtDebug>
 #include <QAction>
 #include <QMenu>
 
-SolutionTreeWidget::SolutionTreeWidget(QWidget *parent) : QTreeWidget(parent)
+SolutionTreeWidget::SolutionTreeWidget(QWidget *parent) : QTreeView(parent), schemaModel(new SchemaModel(this))
 {
     setSelectionMode(QAbstractItemView::SingleSelection);
-
-    // Header Item
-    auto h = new QTreeWidgetItem;
-    h->setIcon(0, QIcon(":/Resources/Tree/foldertree.png"));
-    h->setText(0, "(Localdb) | SQLITELocalDB | outline");
-    h->setFont(0, QFont("Calibri"));
-    setHeaderItem(h);
+    setModel(schemaModel);
     setHeaderHidden(false);
 
+    // a database expanded before it was ever selected gets selected, which opens it and brings its schema
+    connect(schemaModel, &SchemaModel::schemaRequested, this, [=](const QString& path)
+    {
+        const int row = schemaModel->databases().indexOf(path);
+        if (row >= 0)
+            setCurrentIndex(schemaModel->index(row, 0));
+    });
+
     setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(this, &SolutionTreeWidget::itemSelectionChanged, this, &SolutionTreeWidget::OnItemSelectionChanged);
+    connect(selectionModel(), &QItemSelectionModel::selectionChanged, this, &SolutionTreeWidget::OnItemSelectionChanged);
     connect(this, &SolutionTreeWidget::customContextMenuRequested, this, &SolutionTreeWidget::prepareMenu);
 }
 
@@ -29,112 +30,100 @@ void SolutionTreeWidget::addItemTotheExplorar(const QString& path)
     if (path.isNull() || path.isEmpty())
         return;
 
-    // Create a new tree item and setting up its properties
-    auto qtvi = new QTreeWidgetItem;
-    qtvi->setText(0, strippedName(path));
-    qtvi->setToolTip(0, path);
-    qtvi->setIcon(0, QIcon(":/Resources/Tree/folder.png"));
+    // The tables arrive with the schema of the database, once the query engine opened it
+    setCurrentIndex(schemaModel->addDatabase(path));
+}
 
-    // Finally, add the tree item to the explorar
-    this->addTopLevelItem(qtvi);
-    setCurrentItem(qtvi);
+// Returns the type of the item that is currently selected. Could be None, Folder, Database, Table or Detail
+SolutionTreeWidget::SelectedItemType SolutionTreeWidget::getSelectedItemType()
+{
+    return itemType(currentIndex());
 }
 
-// Adds a new table to the selected database
-void SolutionTreeWidget::addItemToTheSelectedNode(const QString& path)
+QString SolutionTreeWidget::selectedDatabase() const
 {
-    // Return if the path is null or empty
-    if (path.isNull() || path.isEmpty())
-        return;
+    return schemaModel->databasePath(currentIndex());
+}
 
-    // Create a new tree item and setting up its properties
-    auto qtvi = new QTreeWidgetItem;
-    qtvi->setText(0, strippedName(path));
-    qtvi->setToolTip(0, path);
-    qtvi->setIcon(0, QIcon(":/Resources/Tree/table.png"));
-
-    // Finally, add the tree item to the currently selected database
-    auto selecteddb = this->currentItem();
-    if (selecteddb)
-        selecteddb->addChild(qtvi);
-    else
-        delete qtvi;
+QString SolutionTreeWidget::selectedTable() const
+{
+    return schemaModel->tableName(currentIndex());
 }
 
-// Returns the type of the item that is currently selected. Could be None, Folder, Database or a Table
-SolutionTreeWidget::SelectedItemType SolutionTreeWidget::getSelectedItemType()
+QStringList SolutionTreeWidget::databases() const
 {
-    // Return if nothing has changed
-    auto changedItem = currentItem();
-    if (!changedItem)
-        return SelectedItemType::None;
+    return schemaModel->databases();
+}
 
-    // Make sure the changed item is the selected item
-    changedItem->setSelected(true);
+// Applies what changed in the schema of one of the databases, the rows of the other objects are left alone
+void SolutionTreeWidget::applySchema(const SchemaDelta &delta)
+{
+    schemaModel->apply(delta);
+}
+
+SolutionTreeWidget::SelectedItemType SolutionTreeWidget::itemType(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return SelectedItemType::None;
 
-    if (changedItem->parent() == nullptr)
+    switch (schemaModel->nodeType(index))
     {
-        // database is selected
+    case SchemaModel::DatabaseNode:
         return SelectedItemType::Database;
-    }
-    else
-    {
-        // table is selected
+    case SchemaModel::TableNode:
+    case SchemaModel::ViewNode:
         return SelectedItemType::Table;
+    default:
+        return SelectedItemType::Detail;
     }
 }
 
-// Accepts a local URL and returns the absolute file name
-QString SolutionTreeWidget::strippedName(const QString &path) const
-{
-    return QFileInfo(path).fileName();
-}
-
 // Fires whenever the selected item is changed
 void SolutionTreeWidget::OnItemSelectionChanged()
 {
     // Return if nothing has changed
-    auto changedItem = currentItem();
-    if (!changedItem)
+    const QModelIndex changedItem = currentIndex();
+    if (!changedItem.isValid())
         return;
 
-    // Make the changed item, selected item
-    changedItem->setSelected(true);
-
-    if (changedItem->parent() == nullptr)
-    {
-        // database is selected
-        emit selectedItemChanged(changedItem, SelectedItemType::Database);
-    }
-    else
-    {
-        // table is selected
-        emit selectedItemChanged(changedItem, SelectedItemType::Table);
-    }
+    emit selectedItemChanged(schemaModel->databasePath(changedItem), itemType(changedItem));
 }
 
 void SolutionTreeWidget::prepareMenu(const QPoint &pos)
 {
-    // Get the selected item type
+    // Get the selected item type, columns, indexes and triggers have no menu
     auto st = getSelectedItemType();
-    if (st == SelectedItemType::None)
+    if (st == SelectedItemType::None || st == SelectedItemType::Detail)
         return;
 
-    // Get a pointer to the selected item
-    QTreeWidgetItem* nd = itemAt(pos);
-    if (!nd) return;
+    // Make sure there is an item under the mouse
+    if (!indexAt(pos).isValid()) return;
 
     // Making actions depending on the type that is selected
     if (st == SelectedItemType::Database)
     {   
         QAction* actionRemoveDatabase = new QAction(tr("Remove File"));
         QAction* actionCreateNewTable = new QAction(tr("New Table"));
+        QAction* actionImportCsv = new QAction(tr("Import CSV..."));
+        QAction* actionBackup = new QAction(tr("Backup Database..."));
+        QAction* actionDump = new QAction(tr("Dump to SQL..."));
+        QAction* actionRestore = new QAction(tr("Restore from SQL..."));
+        QAction* actionConnectionSettings = new QAction(tr("Connection Settings..."));
+        QAction* actionAttach = new QAction(tr("Attach Database..."));
+        QAction* actionDetach = new QAction(tr("Detach Database..."));
         QAction* actionExpandAll = new QAction(tr("Expand"));
         QAction* actionCollapseAll = new QAction(tr("Collapse"));
 
         // Font
         actionRemoveDatabase->setFont(QFont("Calibri"));
         actionCreateNewTable->setFont(QFont("Calibri"));
+        actionImportCsv->setFont(QFont("Calibri"));
+        actionBackup->setFont(QFont("Calibri"));
+        actionDump->setFont(QFont("Calibri"));
+        actionRestore->setFont(QFont("Calibri"));
+        actionConnectionSettings->setFont(QFont("Calibri"));
+        actionAttach->setFont(QFont("Calibri"));
+        actionDetach->setFont(QFont("Calibri"));
         actionExpandAll->setFont(QFont("Calibri"));
         actionCollapseAll->setFont(QFont("Calibri"));
 
@@ -144,13 +133,18 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
         connect(actionRemoveDatabase, &QAction::triggered, [&](){
 
             // Delete the selected item
-            if (currentItem())
-                delete currentItem();
+            const int row = currentIndex().row();
+            const QString path = selectedDatabase();
+            schemaModel->removeDatabase(currentIndex());
+            emit databaseRemoved(path);
 
-            // If there are no items left we explicitly pass a nullptr to notity the consumer
+            // If there are no items left we explicitly pass an empty path to notity the consumer
             // It must be handled by consumer for null selected items
-            if (topLevelItemCount() == 0)
-                emit selectedItemChanged(nullptr, SelectedItemType::None);
+            const int count = schemaModel->rowCount();
+            if (count == 0)
+                emit selectedItemChanged(QString(), SelectedItemType::None);
+            else
+                setCurrentIndex(schemaModel->index(qMin(row, count - 1), 0));
 
         });
 
@@ -161,12 +155,61 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
                 emit tableGeneratorRequested();
         });
 
+        menu.addAction(actionImportCsv);
+        connect(actionImportCsv, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit csvImportRequested();
+        });
+
+        menu.addAction(actionBackup);
+        connect(actionBackup, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit backupRequested();
+        });
+
+        menu.addAction(actionDump);
+        connect(actionDump, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit dumpRequested();
+        });
+
+        menu.addAction(actionRestore);
+        connect(actionRestore, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit restoreRequested();
+        });
+
+        menu.addAction(actionConnectionSettings);
+        connect(actionConnectionSettings, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit connectionSettingsRequested();
+        });
+
+        menu.addAction(actionAttach);
+        connect(actionAttach, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit attachRequested();
+        });
+
+        menu.addAction(actionDetach);
+        connect(actionDetach, &QAction::triggered, [&](){
+
+            if (getSelectedItemType() == SelectedItemType::Database)
+                emit detachRequested();
+        });
+
         menu.addAction(actionExpandAll);
         connect(actionExpandAll, &QAction::triggered, [&](){
 
             // Expand only if the current item is a database
             if(getSelectedItemType() == SelectedItemType::Database)
-                expandItem(currentItem());
+                expand(currentIndex());
 
         });
 
@@ -175,7 +218,7 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
 
             // Collapse only if the current item is a database
             if (getSelectedItemType() == SelectedItemType::Database)
-                collapseItem(currentItem());
+                collapse(currentIndex());
 
         });
 
@@ -183,8 +226,8 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
     }
     else // table
     {
-        QAction* actionSelectAllCommand = new QAction(tr("Select top records"));
-        QAction* actionDropCommand = new QAction(tr("Drop table"));
+        QAction* actionSelectAllCommand = new QAction(tr("Browse records"));
+        QAction* actionDropCommand = new QAction(schemaModel->nodeType(currentIndex()) == SchemaModel::ViewNode ? tr("Drop view") : tr("Drop table"));
 
         // Font
         actionSelectAllCommand->setFont(QFont("Calibri"));
@@ -195,11 +238,9 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
         menu.addAction(actionSelectAllCommand);
         connect(actionSelectAllCommand, &QAction::triggered, [&](){
 
+            // the table is paged by key in the browser, a plain select would read every row of a huge table
             if (getSelectedItemType() == SelectedItemType::Table)
-            {
-                QString stmt = "Select * from " + currentItem()->text(0);
-                emit statementRequested(stmt);
-            }
+                emit tableBrowseRequested(selectedTable());
 
         });
 
@@ -208,7 +249,8 @@ void SolutionTreeWidget::prepareMenu(const QPoint &pos)
 
             if (getSelectedItemType() == SelectedItemType::Table)
             {
-                QString stmt = "Drop table " + currentItem()->text(0);
+                const bool isView = schemaModel->nodeType(currentIndex()) == SchemaModel::ViewNode;
+                QString stmt = (isView ? "Drop view " : "Drop table ") + selectedTable();
                 emit statementRequested(stmt);
             }
         });
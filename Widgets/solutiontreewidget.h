@@ -2,9 +2,11 @@
 #define SOLUTIONTREEWIDGET_H
 
 #include <QWidget>
-#include <QTreeWidget>
+#include <QTreeView>
 
-class SolutionTreeWidget : public QTreeWidget
+#include "Models/schemamodel.h"
+
+class SolutionTreeWidget : public QTreeView
 {
     Q_OBJECT
 
@@ -21,31 +23,53 @@ public:
         // database is selected
         Database,
 
-        // table
-        Table
+        // table or view
+        Table,
+
+        // column, index or trigger of a table, or one of their groups
+        Detail
     };
 
     void addItemTotheExplorar(const QString&);
-    void addItemToTheSelectedNode(const QString&);
     SelectedItemType getSelectedItemType();
 
+    // path of the database of the selected item, and the table or view it belongs to
+    QString selectedDatabase() const;
+    QString selectedTable() const;
+
+    // paths of every database in the explorar
+    QStringList databases() const;
+
+public slots:
+    void applySchema(const SchemaDelta& delta);
+
 signals:
-    void selectedItemChanged(QTreeWidgetItem*, SelectedItemType t);
+    void selectedItemChanged(const QString& databasePath, SelectedItemType t);
+    void databaseRemoved(const QString& databasePath);
 
     // Context Menu Related Signals
     void tableGeneratorRequested();
     void statementRequested(QString command);
     void statementAppendRequested(QString command);
+    void tableBrowseRequested(QString table);
+    void csvImportRequested();
+    void backupRequested();
+    void dumpRequested();
+    void restoreRequested();
+    void connectionSettingsRequested();
+
+    // another database of the explorar is to be attached to the selected one, or one attached to it detached
+    void attachRequested();
+    void detachRequested();
 
 private slots:
     void OnItemSelectionChanged();
     void prepareMenu(const QPoint& pos);
 
 private:
-    QTreeWidgetItem* currentlySelectedDatabase;
-    QTreeWidgetItem* currentlySelectedTable;
+    SchemaModel* schemaModel;
 
-    QString strippedName(const QString& path) const;
+    SelectedItemType itemType(const QModelIndex& index) const;
 };
 
 #endif // SOLUTIONTREEWIDGET_H
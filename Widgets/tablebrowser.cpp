@@ -0,0 +1,390 @@
+#include "tablebrowser.h"
+
+#include <QAbstractTableModel>
+#include <QTableView>
+#include <QHeaderView>
+#include <QToolButton>
+#include <QLineEdit>
+#include <QSlider>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+namespace
+{
+    // rows in a page of the browser
+    const int PageRows = 500;
+
+    // visited and read ahead pages that are kept
+    const int CachedPages = 32;
+
+    // resolution of the position slider
+    const int SliderSteps = 1000;
+
+    QString keyText(const QVariantList& key)
+    {
+        QStringList values;
+        foreach (const QVariant& v, key)
+            values << v.toString();
+        return values.join(", ");
+    }
+}
+
+/*
+ * Shows the rows of a single KeysetPage, with the key of every row in the vertical header.
+ */
+class KeysetPageModel : public QAbstractTableModel
+{
+public:
+    explicit KeysetPageModel(QObject* parent = nullptr) : QAbstractTableModel(parent) {}
+
+    void setPage(const KeysetPage& p)
+    {
+        beginResetModel();
+        page = p;
+        endResetModel();
+    }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE
+    {
+        return parent.isValid() ? 0 : page.rows.rowCount();
+    }
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const Q_DECL_OVERRIDE
+    {
+        return parent.isValid() ? 0 : page.columns.size();
+    }
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE
+    {
+        if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
+            return QVariant();
+        return page.rows.value(index.row(), index.column());
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE
+    {
+        if (role != Qt::DisplayRole)
+            return QVariant();
+
+        if (orientation == Qt::Horizontal)
+            return section < page.columns.size() ? page.columns.at(section) : QVariant();
+
+        return section < page.keys.size() ? keyText(page.keys.at(section)) : QVariant();
+    }
+
+private:
+    KeysetPage page;
+};
+
+TableBrowser::TableBrowser(QWidget *parent) : QWidget(parent), pages(CachedPages), model(new KeysetPageModel(this))
+{
+    auto toolButton = [&](const QString& text, const QString& tip)
+    {
+        auto button = new QToolButton(this);
+        button->setText(text);
+        button->setToolTip(tip);
+        button->setEnabled(false);
+        return button;
+    };
+
+    firstButton = toolButton(tr("First"), tr("Show the first rows of the table"));
+    previousButton = toolButton(tr("Previous"), tr("Show the previous rows"));
+    nextButton = toolButton(tr("Next"), tr("Show the next rows"));
+    lastButton = toolButton(tr("Last"), tr("Show the last rows of the table"));
+    refreshButton = toolButton(tr("Refresh"), tr("Read the visible rows again"));
+
+    keyEdit = new QLineEdit(this);
+    keyEdit->setPlaceholderText(tr("Go to key"));
+    keyEdit->setToolTip(tr("Shows the rows starting at a rowid or primary key, separate the values of a composite key by commas"));
+    keyEdit->setMaximumWidth(160);
+    keyEdit->setEnabled(false);
+
+    positionSlider = new QSlider(Qt::Horizontal, this);
+    positionSlider->setRange(0, SliderSteps);
+    positionSlider->setToolTip(tr("Position in the table"));
+    positionSlider->setEnabled(false);
+
+    statusLabel = new QLabel(this);
+
+    view = new QTableView(this);
+    view->setModel(model);
+
+    auto navigation = new QHBoxLayout;
+    navigation->setContentsMargins(0, 0, 0, 0);
+    navigation->addWidget(firstButton);
+    navigation->addWidget(previousButton);
+    navigation->addWidget(nextButton);
+    navigation->addWidget(lastButton);
+    navigation->addWidget(refreshButton);
+    navigation->addWidget(keyEdit);
+    navigation->addWidget(positionSlider, 1);
+    navigation->addWidget(statusLabel);
+
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(navigation);
+    layout->addWidget(view);
+
+    connect(firstButton, &QToolButton::clicked, this, &TableBrowser::first);
+    connect(previousButton, &QToolButton::clicked, this, &TableBrowser::previous);
+    connect(nextButton, &QToolButton::clicked, this, &TableBrowser::next);
+    connect(lastButton, &QToolButton::clicked, this, &TableBrowser::last);
+    connect(refreshButton, &QToolButton::clicked, this, &TableBrowser::refresh);
+    connect(keyEdit, &QLineEdit::returnPressed, this, &TableBrowser::goToKey);
+    connect(positionSlider, &QSlider::sliderReleased, this, &TableBrowser::seek);
+}
+
+QString TableBrowser::table() const
+{
+    return currentTable;
+}
+
+/*
+ * Starts browsing a table at its first rows.
+ */
+void TableBrowser::browse(const QString &table)
+{
+    currentTable = table;
+    firstKey.clear();
+    lastKey.clear();
+    first();
+}
+
+void TableBrowser::first()
+{
+    KeysetQuery query;
+    query.anchor = KeysetQuery::First;
+    request(query, true);
+}
+
+void TableBrowser::previous()
+{
+    if (firstKey.isEmpty())
+        return;
+
+    KeysetQuery query;
+    query.anchor = KeysetQuery::Before;
+    query.key = firstKey;
+    request(query, true);
+}
+
+void TableBrowser::next()
+{
+    if (lastKey.isEmpty())
+        return;
+
+    KeysetQuery query;
+    query.anchor = KeysetQuery::After;
+    query.key = lastKey;
+    request(query, true);
+}
+
+void TableBrowser::last()
+{
+    KeysetQuery query;
+    query.anchor = KeysetQuery::Last;
+    request(query, true);
+}
+
+/*
+ * Reads the visible page again, along with the pages around it.
+ */
+void TableBrowser::refresh()
+{
+    if (currentTable.isEmpty())
+        return;
+
+    invalidate();
+    request(current, true);
+}
+
+/*
+ * Shows the rows starting at the key typed by the user. Numbers are bound as numbers, so they compare the way the rowid and integer keys do.
+ */
+void TableBrowser::goToKey()
+{
+    const QString text = keyEdit->text().trimmed();
+    if (text.isEmpty())
+        return;
+
+    KeysetQuery query;
+    query.anchor = KeysetQuery::From;
+    foreach (const QString& part, text.split(QLatin1Char(',')))
+    {
+        const QString value = part.trimmed();
+        bool isInteger, isReal;
+        const qint64 integer = value.toLongLong(&isInteger);
+        const double real = value.toDouble(&isReal);
+
+        if (isInteger)
+            query.key << integer;
+        else if (isReal)
+            query.key << real;
+        else
+            query.key << value;
+    }
+
+    request(query, true);
+}
+
+void TableBrowser::seek()
+{
+    KeysetQuery query;
+    query.anchor = KeysetQuery::Fraction;
+    query.key << double(positionSlider->value()) / SliderSteps;
+    request(query, true);
+}
+
+/*
+ * Shows the page of a query from the cache, or asks for it. Pages that are only read ahead are requested once and kept for later.
+ */
+void TableBrowser::request(KeysetQuery query, bool show)
+{
+    if (currentTable.isEmpty())
+        return;
+
+    query.table = currentTable;
+    query.limit = PageRows;
+    query.cacheKey = cacheKeyFor(query);
+
+    if (show)
+    {
+        current = query;
+        awaitedKey.clear();
+
+        if (const KeysetPage* page = pages.object(query.cacheKey))
+        {
+            showPage(*page);
+            return;
+        }
+
+        awaitedKey = query.cacheKey;
+        statusLabel->setText(tr("Loading..."));
+    }
+    else if (pages.contains(query.cacheKey))
+    {
+        return;
+    }
+
+    if (pendingKeys.contains(query.cacheKey))
+        return;
+
+    pendingKeys.insert(query.cacheKey);
+    emit pageRequested(query);
+}
+
+/*
+ * Receives a page from the query engine. It is shown if the user is waiting for it, otherwise it only goes into the cache.
+ */
+void TableBrowser::addPage(const KeysetPage &page)
+{
+    // answers to requests from before invalidate() may hold rows that changed since
+    if (page.table != currentTable || !pendingKeys.remove(page.cacheKey))
+        return;
+
+    if (!page.error.isEmpty())
+    {
+        if (page.cacheKey == awaitedKey)
+        {
+            awaitedKey.clear();
+            statusLabel->setText(page.error);
+        }
+        return;
+    }
+
+    pages.insert(page.cacheKey, new KeysetPage(page));
+
+    if (page.cacheKey == awaitedKey)
+    {
+        awaitedKey.clear();
+        showPage(page);
+    }
+}
+
+/*
+ * Shows a page and reads its neighbours ahead, so that the next click on Previous or Next is answered from the cache.
+ */
+void TableBrowser::showPage(const KeysetPage &page)
+{
+    model->setPage(page);
+    view->scrollToTop();
+    firstKey = page.keys.isEmpty() ? QVariantList() : page.keys.first();
+    lastKey = page.keys.isEmpty() ? QVariantList() : page.keys.last();
+    updateControls(&page);
+
+    if (page.keys.isEmpty())
+        return;
+
+    if (!page.atEnd)
+    {
+        KeysetQuery after;
+        after.anchor = KeysetQuery::After;
+        after.key = page.keys.last();
+        request(after, false);
+    }
+
+    if (!page.atStart)
+    {
+        KeysetQuery before;
+        before.anchor = KeysetQuery::Before;
+        before.key = page.keys.first();
+        request(before, false);
+    }
+}
+
+void TableBrowser::updateControls(const KeysetPage *page)
+{
+    const bool browsing = !currentTable.isEmpty();
+    const bool hasRows = page && !page->keys.isEmpty();
+
+    firstButton->setEnabled(browsing && !(page && page->atStart));
+    previousButton->setEnabled(hasRows && !page->atStart);
+    nextButton->setEnabled(hasRows && !page->atEnd);
+    lastButton->setEnabled(browsing && !(page && page->atEnd));
+    refreshButton->setEnabled(browsing);
+    keyEdit->setEnabled(browsing);
+    positionSlider->setEnabled(page && page->seekable);
+
+    if (!page)
+        statusLabel->clear();
+    else if (!hasRows)
+        statusLabel->setText(tr("%1: no rows").arg(currentTable));
+    else
+        statusLabel->setText(tr("%1: %2 rows, keys %3 to %4").arg(currentTable).arg(page->keys.size())
+                             .arg(keyText(page->keys.first()), keyText(page->keys.last())));
+}
+
+/*
+ * Drops the cached pages. Requests on their way are still answered, but their pages are thrown away when they arrive.
+ */
+void TableBrowser::invalidate()
+{
+    pages.clear();
+    pendingKeys.clear();
+}
+
+void TableBrowser::clear()
+{
+    currentTable.clear();
+    current = KeysetQuery();
+    awaitedKey.clear();
+    firstKey.clear();
+    lastKey.clear();
+    invalidate();
+    model->setPage(KeysetPage());
+    updateControls(nullptr);
+}
+
+/*
+ * Cache keys identify a page by the query that reads it. The key values are tagged with their type, so that the integer 1 and the text '1',
+ * which sqlite orders differently, don't share a page.
+ */
+QString TableBrowser::cacheKeyFor(const KeysetQuery &query)
+{
+    QStringList values;
+    foreach (const QVariant& v, query.key)
+        values << QString::number(int(v.type())) + QLatin1Char(':') + v.toString();
+
+    return QString("%1\x1f%2\x1f%3").arg(query.table).arg(int(query.anchor)).arg(values.join(QLatin1Char('\x1f')));
+}
@@ -0,0 +1,91 @@
+#ifndef TABLEBROWSER_H
+#define TABLEBROWSER_H
+
+#include <QWidget>
+#include <QCache>
+#include <QSet>
+
+#include "Database/keyset.h"
+
+QT_BEGIN_NAMESPACE
+class QTableView;
+class QToolButton;
+class QLineEdit;
+class QSlider;
+class QLabel;
+QT_END_NAMESPACE
+
+class KeysetPageModel;
+
+/*
+ * Pages through a table one screen at a time. Pages are positioned by the rowid or primary key of their first and last rows (keyset pagination),
+ * so moving to any page is a single seek into the table's b-tree, wherever it is, instead of stepping over every row before it like OFFSET does.
+ * The pages right before and after the visible one are read ahead, and recently visited pages are kept, so paging back and forth is instant.
+ *
+ * The browser doesn't read the table itself, it asks for pages through pageRequested() and shows them once they arrive through addPage().
+ */
+class TableBrowser : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TableBrowser(QWidget* parent = nullptr);
+
+    QString table() const;
+
+public slots:
+    void browse(const QString& table);
+    void addPage(const KeysetPage& page);
+
+    // forgets the cached pages, to be called when the table may have changed
+    void invalidate();
+    void clear();
+
+    // reads the visible page again, to be called when the rows may have changed
+    void refresh();
+
+signals:
+    void pageRequested(const KeysetQuery& request);
+
+private slots:
+    void first();
+    void previous();
+    void next();
+    void last();
+    void goToKey();
+    void seek();
+
+private:
+    QString currentTable;
+
+    // the query of the visible page, and the one the user waits for if it has not arrived yet
+    KeysetQuery current;
+    QString awaitedKey;
+
+    // keys of the first and last visible rows, the anchors of Previous and Next
+    QVariantList firstKey;
+    QVariantList lastKey;
+
+    // recently visited and read ahead pages, by cache key
+    QCache<QString, KeysetPage> pages;
+    QSet<QString> pendingKeys;
+
+    KeysetPageModel* model;
+    QTableView* view;
+    QToolButton* firstButton;
+    QToolButton* previousButton;
+    QToolButton* nextButton;
+    QToolButton* lastButton;
+    QToolButton* refreshButton;
+    QLineEdit* keyEdit;
+    QSlider* positionSlider;
+    QLabel* statusLabel;
+
+    void request(KeysetQuery query, bool show);
+    void showPage(const KeysetPage& page);
+    void updateControls(const KeysetPage* page);
+
+    static QString cacheKeyFor(const KeysetQuery& query);
+};
+
+#endif // TABLEBROWSER_H
@@ -1,4 +1,5 @@
 #include "textedit.h"
+#include "Libraries/completionindex.h"
 
 #include <QCompleter>
 #include <QKeyEvent>
@@ -8,11 +9,39 @@
 #include <QModelIndex>
 #include <QAbstractItemModel>
 #include <QScrollBar>
+#include <QTextBlock>
+#include <QStringListModel>
+#include <QHelpEvent>
+#include <QToolTip>
 
-TextEdit::TextEdit(QWidget *parent) : QTextEdit(parent), c(0)
+#include <algorithm>
+
+namespace
+{
+    // suggestions shown in the popup at most
+    const int CompletionLimit = 200;
+
+    // blocks searched above and below the cursor for the ends of the statement it is in
+    const int MaxStatementBlocks = 2000;
+
+    // blocks above and below the visible ones whose statements are validated
+    const int VisibleStatementMargin = 50;
+
+    // state of the lexer at the start of a block; FormatStream keeps the state each block ends in in the low byte of its block state
+    SqlLexer::State stateBefore(const QTextBlock& block)
+    {
+        const int state = block.previous().isValid() ? block.previous().userState() : -1;
+        return state == -1 ? SqlLexer::Normal : SqlLexer::State(state & 0xff);
+    }
+}
+
+TextEdit::TextEdit(QWidget *parent) : QPlainTextEdit(parent), c(0), completionModel(new QStringListModel(this))
 {
     setFont(QFont("Courier New", 10));
     setTabStopWidth(25);
+
+    // scrolling, resizing and editing all end in an update request of the viewport
+    connect(this, &QPlainTextEdit::updateRequest, this, &TextEdit::updateVisibleBlocks);
 }
 
 TextEdit::~TextEdit()
@@ -29,8 +58,10 @@ void TextEdit::setCompleter(QCompleter *completer)
     if (!c)
         return;
 
+    // the editor works out the suggestions itself, the completer only shows them
     c->setWidget(this);
-    c->setCompletionMode(QCompleter::PopupCompletion);
+    c->setModel(completionModel);
+    c->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
     c->setCaseSensitivity(Qt::CaseInsensitive);
     QObject::connect(c, SIGNAL(activated(QString)), this, SLOT(insertCompletion(QString)));
 }
@@ -40,30 +71,424 @@ QCompleter *TextEdit::completer() const
     return c;
 }
 
+/*
+ * Sorts the words case insensitively, so that the ones starting with a prefix can be found by binary search.
+ */
+void TextEdit::setKeywords(const QStringList &words)
+{
+    keywords = words;
+    std::sort(keywords.begin(), keywords.end(), [](const QString& a, const QString& b)
+    {
+        return a.compare(b, Qt::CaseInsensitive) < 0;
+    });
+}
+
+void TextEdit::setCompletionIndex(const CompletionIndex *index)
+{
+    completionIndex = index;
+}
+
+void TextEdit::setAttachedIndexes(const QHash<QString, const CompletionIndex *> &indexes)
+{
+    attachedIndexes.clear();
+    schemaNames.clear();
+    for (auto i = indexes.constBegin(); i != indexes.constEnd(); ++i)
+    {
+        attachedIndexes.insert(i.key().toCaseFolded(), i.value());
+        schemaNames << i.key();
+    }
+    std::sort(schemaNames.begin(), schemaNames.end(), [](const QString& a, const QString& b)
+    {
+        return a.compare(b, Qt::CaseInsensitive) < 0;
+    });
+}
+
+/*
+ * The names of a schema of the selected database: the database itself for a name that isn't qualified or is qualified with main, otherwise
+ * the database attached under that schema name.
+ */
+const CompletionIndex *TextEdit::indexFor(const QString &schema) const
+{
+    if (schema.isEmpty() || schema.compare(QLatin1String("main"), Qt::CaseInsensitive) == 0)
+        return completionIndex;
+    return attachedIndexes.value(schema.toCaseFolded());
+}
+
+/*
+ * Finds the start of the statement a position is in, just after the semicolon that ends the statement before it. Only the blocks up to that
+ * semicolon are lexed, each from the state the block above it ended in, so the cost depends on the size of the statement and not on the size of
+ * the document. A semicolon inside the body of a trigger doesn't end the statement: as long as the pieces between the semicolons before the
+ * position could be statements of a trigger body the search goes on, and once it reaches a CREATE TRIGGER the trigger is followed forward with
+ * a SqlStatementTracker, the way splitStatements() does.
+ */
+int TextEdit::statementStart(int position) const
+{
+    struct HeadToken
+    {
+        QString text;
+        SqlToken token;
+    };
+
+    // the first tokens of the piece between two semicolons, enough to tell CREATE TEMP TRIGGER apart
+    QVector<HeadToken> head;
+    int candidate = -1;
+
+    // true when the piece that starts at pieceStart settles the search and sets the result, false when it could be a statement of a trigger body
+    auto pieceDecides = [&](int pieceStart, int& result)
+    {
+        auto is = [&](int i, const char* keyword)
+        {
+            return i < head.size() && head.at(i).token.type == SqlToken::Identifier
+                    && SqlLexer::equals(head.at(i).text.constData(), head.at(i).token, keyword);
+        };
+
+        const bool temporary = is(1, "TEMP") || is(1, "TEMPORARY");
+        if (is(0, "CREATE") && (is(1, "TRIGGER") || (temporary && is(2, "TRIGGER"))))
+        {
+            // the statements of the trigger end where the tracker says, up to the position
+            result = pieceStart;
+            for (int end = statementEnd(pieceStart); end < position && end + 1 > result; end = statementEnd(result))
+                result = end + 1;
+            return true;
+        }
+
+        const bool bodyLike = head.isEmpty() || is(0, "INSERT") || is(0, "UPDATE") || is(0, "DELETE") || is(0, "SELECT") || is(0, "WITH")
+                || is(0, "REPLACE") || is(0, "VALUES");
+        if (!bodyLike)
+            result = candidate;
+        return !bodyLike;
+    };
+
+    const QTextBlock cursorBlock = document()->findBlock(position);
+    QVector<SqlToken> tokens;
+    SqlToken token;
+
+    int count = 0;
+    for (QTextBlock block = cursorBlock; block.isValid(); block = block.previous())
+    {
+        const QString text = block.text();
+        const int end = block == cursorBlock ? position - block.position() : text.size();
+
+        tokens.clear();
+        SqlLexer lexer(text.constData(), end, stateBefore(block));
+        while (lexer.next(token))
+        {
+            if (token.isSignificant())
+                tokens << token;
+        }
+
+        // the pieces between the semicolons, from the position backwards
+        for (int i = tokens.size() - 1; i >= 0; --i)
+        {
+            if (tokens.at(i).type != SqlToken::Semicolon)
+            {
+                head.prepend({ text, tokens.at(i) });
+                if (head.size() > 3)
+                    head.removeLast();
+                continue;
+            }
+
+            const int after = block.position() + tokens.at(i).start + 1;
+            int result = 0;
+            if (candidate < 0)
+                candidate = after;
+            else if (pieceDecides(after, result))
+                return result;
+            head.clear();
+        }
+
+        if (++count == MaxStatementBlocks)
+            return candidate >= 0 ? candidate : block.position();
+    }
+
+    int result = 0;
+    if (candidate >= 0 && !pieceDecides(0, result))
+        return candidate;
+    return result;
+}
+
+/*
+ * Finds the end of the statement that starts at a position, the position of the semicolon that ends it or the end of the document. Semicolons
+ * inside the body of a trigger are skipped.
+ */
+int TextEdit::statementEnd(int start) const
+{
+    const QTextBlock startBlock = document()->findBlock(start);
+    SqlStatementTracker tracker;
+    SqlToken token;
+
+    int count = 0;
+    for (QTextBlock block = startBlock; block.isValid(); block = block.next())
+    {
+        const QString text = block.text();
+
+        // a statement starts outside of any string or comment, the blocks after the first one start in the state the one above ended in
+        const int from = block == startBlock ? start - block.position() : 0;
+        SqlLexer lexer(text.constData() + from, text.size() - from, block == startBlock ? SqlLexer::Normal : stateBefore(block));
+        while (lexer.next(token))
+        {
+            token.start += from;
+            if (token.isSignificant() && tracker.feed(text.constData(), token))
+                return block.position() + token.start;
+        }
+
+        if (++count == MaxStatementBlocks || !block.next().isValid())
+            return block.position() + text.size();
+    }
+    return start;
+}
+
+/*
+ * Returns the text between two positions of the document as plain sql.
+ */
+QString TextEdit::textBetween(int start, int end) const
+{
+    QTextCursor cursor(const_cast<QTextDocument*>(document()));
+    cursor.setPosition(start);
+    cursor.setPosition(qMax(start, end), QTextCursor::KeepAnchor);
+
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    return text;
+}
+
+/*
+ * Returns the statements of the blocks in view and of a margin around them, positioned in the document. Validation only looks at these, so
+ * its cost doesn't depend on the size of the document either.
+ */
+QVector<SqlStatement> TextEdit::visibleStatements() const
+{
+    const QTextBlock first = document()->findBlockByNumber(qMax(0, firstVisible - VisibleStatementMargin));
+    QTextBlock last = document()->findBlockByNumber(qMax(0, lastVisible + VisibleStatementMargin));
+    if (!last.isValid())
+        last = document()->lastBlock();
+
+    const int start = statementStart(first.position());
+    const int end = statementEnd(statementStart(last.position() + last.length() - 1));
+
+    QVector<SqlStatement> statements = SqlLexer::splitStatements(textBetween(start, end));
+    for (SqlStatement& statement : statements)
+        statement.start += start;
+    return statements;
+}
+
+SqlCompletionContext TextEdit::completionContext() const
+{
+    const int position = textCursor().position();
+    const int start = statementStart(position);
+    return SqlCompletionParser::parse(textBetween(start, statementEnd(start)), position - start);
+}
+
+/*
+ * Suggestions for the word being typed, depending on where it is: tables after FROM and the like, the columns of a table after its name or
+ * alias and a dot, and elsewhere the columns of the tables of the statement first, then every other name of the database and the keywords.
+ */
+QStringList TextEdit::completionsFor(const SqlCompletionContext &context) const
+{
+    const QString& prefix = context.prefix;
+    QStringList result;
+
+    auto addMatching = [&](const QStringList& names)
+    {
+        foreach (const QString& name, names)
+        {
+            if (result.size() < CompletionLimit && name.startsWith(prefix, Qt::CaseInsensitive) && !result.contains(name, Qt::CaseInsensitive))
+                result << name;
+        }
+    };
+
+    const bool qualifierIsSchema = context.qualifier.compare(QLatin1String("main"), Qt::CaseInsensitive) == 0
+            || attachedIndexes.contains(context.qualifier.toCaseFolded());
+
+    switch (context.expect)
+    {
+    case SqlCompletionContext::QualifiedColumn:
+        if (const CompletionIndex* index = indexFor(context.schema))
+            addMatching(index->columns(context.qualifier));
+
+        // a schema name and a dot are followed by the tables of that database
+        if (result.isEmpty() && context.schema.isEmpty() && qualifierIsSchema)
+        {
+            if (const CompletionIndex* index = indexFor(context.qualifier))
+                result = index->complete(prefix, CompletionIndex::Table | CompletionIndex::View, CompletionLimit);
+        }
+        return result;
+
+    case SqlCompletionContext::Table:
+        if (const CompletionIndex* index = indexFor(context.schema))
+            result = index->complete(prefix, CompletionIndex::Table | CompletionIndex::View, CompletionLimit);
+        if (context.schema.isEmpty())
+            addMatching(schemaNames);
+        return result;
+
+    case SqlCompletionContext::Column:
+        for (int i = 0; i < context.tables.size(); ++i)
+        {
+            if (const CompletionIndex* index = indexFor(context.schemas.at(i)))
+                addMatching(index->columns(context.tables.at(i)));
+        }
+        break;
+
+    case SqlCompletionContext::Anything:
+        break;
+    }
+
+    if (completionIndex)
+        addMatching(completionIndex->complete(prefix, CompletionIndex::AnyKind, CompletionLimit));
+    addMatching(schemaNames);
+
+    auto it = std::lower_bound(keywords.cbegin(), keywords.cend(), prefix, [](const QString& word, const QString& p)
+    {
+        return word.compare(p, Qt::CaseInsensitive) < 0;
+    });
+    for (; it != keywords.cend() && result.size() < CompletionLimit && it->startsWith(prefix, Qt::CaseInsensitive); ++it)
+    {
+        if (!result.contains(*it, Qt::CaseInsensitive))
+            result << *it;
+    }
+    return result;
+}
+
+/*
+ * Returns the statement the caret is in, positioned in the document. Its boundaries are found by statementStart() and statementEnd(), so semicolons
+ * in strings, comments and trigger bodies are skipped and only the blocks of the statement are read. Between two statements the caret belongs
+ * to the one before it, unless it left the line of its semicolon and the next one starts on the line of the caret.
+ */
+SqlStatement TextEdit::currentStatement() const
+{
+    auto statementFrom = [this](int start) -> SqlStatement
+    {
+        const int end = statementEnd(start);
+        const int stop = document()->characterAt(end) == QLatin1Char(';') ? end + 1 : end;
+        SqlStatement statement = SqlLexer::splitStatements(textBetween(start, stop)).value(0);
+        if (statement.text.isEmpty())
+            return SqlStatement();
+
+        statement.line += document()->findBlock(start).blockNumber();
+        statement.start += start;
+        return statement;
+    };
+
+    const int position = textCursor().position();
+    const int start = statementStart(position);
+    const SqlStatement next = statementFrom(start);
+    if (start == 0 || document()->characterAt(start - 1) != QLatin1Char(';') || (!next.text.isEmpty() && next.start < position))
+        return next;
+
+    const bool leftLine = textBetween(start, position).contains(QLatin1Char('\n'));
+    const bool sameLine = !next.text.isEmpty() && !textBetween(position, next.start).contains(QLatin1Char('\n'));
+    if (leftLine && sameLine)
+        return next;
+
+    const SqlStatement previous = statementFrom(statementStart(start - 1));
+    return previous.text.isEmpty() ? next : previous;
+}
+
+/*
+ * Returns the selected text as plain sql, QTextCursor separates the selected paragraphs with U+2029 instead of new lines.
+ */
+QString TextEdit::selectedSql() const
+{
+    QString text = textCursor().selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    return text;
+}
+
+/*
+ * Returns the line the selection starts at, starting at 1.
+ */
+int TextEdit::selectionFirstLine() const
+{
+    return document()->findBlock(textCursor().selectionStart()).blockNumber() + 1;
+}
+
+/*
+ * Works out which blocks are in view, from the first visible block down to the bottom of the viewport.
+ */
+void TextEdit::updateVisibleBlocks()
+{
+    QTextBlock block = firstVisibleBlock();
+    const int first = block.blockNumber();
+    int last = first;
+
+    const qreal bottom = viewport()->rect().bottom();
+    qreal top = blockBoundingGeometry(block).translated(contentOffset()).top();
+    while (block.isValid() && top <= bottom)
+    {
+        last = block.blockNumber();
+        top += blockBoundingRect(block).height();
+        block = block.next();
+    }
+
+    if (first != firstVisible || last != lastVisible)
+    {
+        firstVisible = first;
+        lastVisible = last;
+        emit visibleBlocksChanged(first, last);
+    }
+}
+
+/*
+ * Underlines the errors with a red wave. The extra selections keep their cursors, so an underline moves along with the text edited above it until
+ * the next validation replaces it.
+ */
+void TextEdit::setDiagnostics(const QVector<SqlDiagnostic> &diagnostics)
+{
+    QList<QTextEdit::ExtraSelection> selections;
+    foreach (const SqlDiagnostic& diagnostic, diagnostics)
+    {
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(qMin(diagnostic.start, document()->characterCount() - 1));
+        selection.cursor.setPosition(qMin(diagnostic.start + qMax(1, diagnostic.length), document()->characterCount() - 1), QTextCursor::KeepAnchor);
+        selection.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+        selection.format.setUnderlineColor(Qt::red);
+        selection.format.setToolTip(diagnostic.message);
+        selections.append(selection);
+    }
+    setExtraSelections(selections);
+}
+
+/*
+ * Shows the message of the error under the mouse.
+ */
+bool TextEdit::event(QEvent *e)
+{
+    if (e->type() == QEvent::ToolTip)
+    {
+        QHelpEvent* help = static_cast<QHelpEvent*>(e);
+        const int position = cursorForPosition(viewport()->mapFromGlobal(help->globalPos())).position();
+        foreach (const QTextEdit::ExtraSelection& selection, extraSelections())
+        {
+            if (position >= selection.cursor.selectionStart() && position <= selection.cursor.selectionEnd())
+            {
+                QToolTip::showText(help->globalPos(), selection.format.toolTip(), this);
+                return true;
+            }
+        }
+        QToolTip::hideText();
+        e->ignore();
+        return true;
+    }
+    return QPlainTextEdit::event(e);
+}
+
 void TextEdit::insertCompletion(const QString& completion)
 {
     if (c->widget() != this)
         return;
+    // the typed prefix is replaced, so that the name gets the case it has in the schema
     QTextCursor tc = textCursor();
-    int extra = completion.length() - c->completionPrefix().length();
-    tc.movePosition(QTextCursor::Left);
-    tc.movePosition(QTextCursor::EndOfWord);
-    tc.insertText(completion.right(extra));
+    tc.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor, c->completionPrefix().length());
+    tc.insertText(completion);
     setTextCursor(tc);
 }
 
-QString TextEdit::textUnderCursor() const
-{
-    QTextCursor tc = textCursor();
-    tc.select(QTextCursor::WordUnderCursor);
-    return tc.selectedText();
-}
-
 void TextEdit::focusInEvent(QFocusEvent *e)
 {
     if (c)
         c->setWidget(this);
-    QTextEdit::focusInEvent(e);
+    QPlainTextEdit::focusInEvent(e);
 }
 
 void TextEdit::keyPressEvent(QKeyEvent *e)
@@ -86,7 +511,7 @@ void TextEdit::keyPressEvent(QKeyEvent *e)
 
     bool isShortcut = ((e->modifiers() & Qt::ControlModifier) && e->key() == Qt::Key_Space);
     if (!c || !isShortcut)
-        QTextEdit::keyPressEvent(e);
+        QPlainTextEdit::keyPressEvent(e);
 
     const bool ctrlOrShift = e->modifiers() & (Qt::ControlModifier | Qt::ShiftModifier);
     if (!c || (ctrlOrShift && e->text().isEmpty()))
@@ -94,16 +519,33 @@ void TextEdit::keyPressEvent(QKeyEvent *e)
 
     static QString eow("~!@#$%^&*()_+{}|:\"<>?,./;'[]\\-=");
     bool hasModifier = (e->modifiers() != Qt::NoModifier) && !ctrlOrShift;
-    QString completionPrefix = textUnderCursor();
+    if (!isShortcut && (hasModifier || e->text().isEmpty()))
+    {
+        c->popup()->hide();
+        return;
+    }
 
-    if (!isShortcut && (hasModifier || e->text().isEmpty()|| completionPrefix.length() < 3 || eow.contains(e->text().right(1))))
+    // the columns of a table, or the tables of an attached database, are offered as soon as the dot after its name is typed
+    const SqlCompletionContext context = completionContext();
+    const QString completionPrefix = context.prefix;
+    const bool afterDot = (context.expect == SqlCompletionContext::QualifiedColumn || !context.schema.isEmpty()) && e->text() == QLatin1String(".");
+
+    if (!isShortcut && !afterDot && (completionPrefix.length() < 3 || eow.contains(e->text().right(1))))
     {
         c->popup()->hide();
         return;
     }
 
-    if (completionPrefix != c->completionPrefix())
+    if (completionPrefix != c->completionPrefix() || !c->popup()->isVisible())
     {
+        const QStringList completions = completionsFor(context);
+        if (completions.isEmpty())
+        {
+            c->popup()->hide();
+            return;
+        }
+
+        completionModel->setStringList(completions);
         c->setCompletionPrefix(completionPrefix);
         c->popup()->setCurrentIndex(c->completionModel()->index(0, 0));
     }
@@ -1,11 +1,21 @@
 #ifndef TEXTEDIT_H
 #define TEXTEDIT_H
-#include <QTextEdit>
+#include <QPlainTextEdit>
+#include "Libraries/sqllexer.h"
+#include "Libraries/sqlcompletion.h"
+#include "Database/validation.h"
 QT_BEGIN_NAMESPACE
 class QCompleter;
+class QStringListModel;
 QT_END_NAMESPACE
 
-class TextEdit : public QTextEdit
+class CompletionIndex;
+
+/*
+ * Sql editor. Built on the plain text, block layout QPlainTextEdit so that scripts of many megabytes stay responsive: only the blocks in view are
+ * laid out, and visibleBlocksChanged() tells the highlighter which blocks to highlight.
+ */
+class TextEdit : public QPlainTextEdit
 {
     Q_OBJECT
 
@@ -16,18 +26,56 @@ public:
     void setCompleter(QCompleter *c);
     QCompleter *completer() const;
 
+    // words offered whatever the database, such as keywords and built in functions
+    void setKeywords(const QStringList& words);
+
+    // names of the selected database, nullptr if none is selected; the index must outlive the editor or be replaced first
+    void setCompletionIndex(const CompletionIndex* index);
+
+    // names of the databases attached to the selected one by their schema name, nullptr for those that have no index yet
+    void setAttachedIndexes(const QHash<QString, const CompletionIndex*>& indexes);
+
+    // statements of the blocks in view and around them, with their position in the document
+    QVector<SqlStatement> visibleStatements() const;
+
+    SqlStatement currentStatement() const;
+    QString selectedSql() const;
+    int selectionFirstLine() const;
+
+public slots:
+    // underlines the errors found by the validator, their message is shown as the tool tip
+    void setDiagnostics(const QVector<SqlDiagnostic>& diagnostics);
+
+signals:
+    // the first and the last block in view, by block number
+    void visibleBlocksChanged(int first, int last);
+
 protected:
+    bool event(QEvent *e) Q_DECL_OVERRIDE;
     void keyPressEvent(QKeyEvent *e) Q_DECL_OVERRIDE;
     void focusInEvent(QFocusEvent *e) Q_DECL_OVERRIDE;
 
 private slots:
     void insertCompletion(const QString &completion);
+    void updateVisibleBlocks();
 
 private:
-    QString textUnderCursor() const;
+    int statementStart(int position) const;
+    int statementEnd(int start) const;
+    QString textBetween(int start, int end) const;
+    SqlCompletionContext completionContext() const;
+    QStringList completionsFor(const SqlCompletionContext& context) const;
+    const CompletionIndex* indexFor(const QString& schema) const;
 
 private:
     QCompleter *c;
+    QStringListModel* completionModel;
+    QStringList keywords;
+    const CompletionIndex* completionIndex = nullptr;
+    QHash<QString, const CompletionIndex*> attachedIndexes;
+    QStringList schemaNames;
+    int firstVisible = -1;
+    int lastVisible = -1;
 };
 
 #endif // TEXTEDIT_H
@@ -18,10 +18,13 @@
  **********************************************************************/
 
 #include "Views/mainwindow.h"
+#include "Formats/highlightbenchmark.h"
+#include "Database/sqlitehandle.h"
 
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QFile>
+#include <QMessageBox>
 
 int main(int argc, char *argv[])
 {
@@ -33,6 +36,21 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName("Firelite");
     QCoreApplication::setApplicationVersion(QT_VERSION_STR);
 
+    // measures the syntax highlighter on a script instead of opening the window
+    const int benchmark = a.arguments().indexOf("--benchmark-highlighting");
+    if (benchmark > 0 && benchmark + 1 < a.arguments().size())
+        return benchmarkHighlighting(a.arguments().at(benchmark + 1));
+
+    // the query engine calls sqlite directly on the connections of the Qt driver, both must use the one library Firelite is linked with
+    if (!sqliteLibraryShared())
+    {
+        QMessageBox::critical(nullptr, QObject::tr("Firelite"),
+                              QObject::tr("The SQLite driver of this Qt installation is missing or carries its own copy of sqlite.\n\n"
+                                          "Firelite needs a Qt configured with -system-sqlite, so that the driver uses the sqlite library "
+                                          "Firelite is linked with."));
+        return 1;
+    }
+
     QScopedPointer<QMainWindow> viewer(new MainWindow);
     const QRect availableGeometry = QApplication::desktop()->availableGeometry(viewer.data());
     viewer->resize(availableGeometry.width() / 2 - 50, (availableGeometry.height() * 2) / 3);